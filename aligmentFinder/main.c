@@ -4,11 +4,25 @@
  * find conjunctions (alignments).
  *
  * This program reads a CSV file generated by the planetary_logger, prompts
- * the user for an alignment threshold (in degrees), and then reports all
- * dates where two or more celestial bodies are within that threshold.
+ * the user for an alignment threshold (in degrees), and then reports every
+ * conjunction between two celestial bodies.
+ *
+ * Each conjunction is reported once, at the time the two longitudes cross,
+ * found by root finding between the daily samples (see common/events.h).
+ * Pairs that come within the threshold without crossing are reported once,
+ * at their closest approach. Position CSVs and binary ephemerides from
+ * kepler_sim_3d are accepted as well, using heliocentric longitudes.
+ *
+ * "-input FILE" and "-threshold DEGREES" (or a "-config FILE"; see
+ * common/cli.h) answer the prompts; "-input -" reads the data from stdin.
+ * "-from" and "-to" (YYYY-MM-DD or "YYYY-MM-DD HH:MM") limit the search to a
+ * slice of the file, and only that slice is read (see dataset_open_range
+ * in common/dataset.h).
+ *
+ * "-stats" prints load, parse and scan times at exit (see common/stats.h).
  *
  * Compilation:
- * gcc alignment_finder.c -o alignment_finder -lm
+ * gcc main.c ../common/events.c ../common/aspects.c ../common/cli.c ../common/frame_store.c ../common/dataset.c ../common/ephemeris.c ../common/timebase.c ../common/stats.c -I../common -o alignment_finder -lm
  */
 
 #define _GNU_SOURCE
@@ -16,98 +30,112 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include "dataset.h"
+#include "frame_store.h"
+#include "events.h"
+#include "cli.h"
+#include "stats.h"
 
 #define MAX_PLANETS 20
-#define MAX_LINE_LEN 1024
 
-int main(void) {
+static struct StatsEntry scan_time = STATS_ENTRY("detect.conjunctions", STATS_TIMER, "ns");
+
+// Stamps each event with the pair being scanned and collects it.
+struct PairScan {
+    struct EventList *events;
+    int body_a, body_b;
+    int failed;
+};
+
+static void collect_event(const struct SeparationEvent *event, void *userp) {
+    struct PairScan *scan = userp;
+    struct SeparationEvent stamped = *event;
+    stamped.body_a = scan->body_a;
+    stamped.body_b = scan->body_b;
+    if (event_list_push(scan->events, &stamped) != 0) scan->failed = 1;
+}
+
+int main(int argc, char *argv[]) {
     char input_filename[100];
     double threshold;
 
+    static const char *const param_names[] = {"input", "threshold", "from", "to", NULL};
+    struct CliParams params;
+    cli_init(&params, param_names);
+    for (int a = 1; a < argc; a++) {
+        int used = cli_parse_option(argc, argv, &a, &params);
+        if (used < 0) return 1;
+        if (!used && !stats_parse_option(argc, argv, &a)) {
+            fprintf(stderr, "Error: Unknown option '%s'.\n", argv[a]);
+            return 1;
+        }
+    }
+    cli_begin(&params);
+
     printf("--- Planetary Alignment Finder ---\n");
     printf("This tool will analyze a CSV file to find conjunctions.\n");
-    printf("Enter Input CSV Filename (e.g., data.csv): ");
-    scanf("%99s", input_filename);
-    printf("Enter Alignment Threshold in Degrees (e.g., 2.0): ");
-    scanf("%lf", &threshold);
-
-    FILE *infile = fopen(input_filename, "r");
-    if (infile == NULL) {
-        perror("Error opening input file");
+    if (cli_prompt_string(&params, "input", "Enter Input CSV Filename (e.g., data.csv): ",
+                          input_filename, sizeof(input_filename)) != 0 ||
+        cli_prompt_double(&params, "threshold", "Enter Alignment Threshold in Degrees (e.g., 2.0): ", &threshold) != 0) {
         return 1;
     }
 
-    char line[MAX_LINE_LEN];
-    char *planet_names[MAX_PLANETS];
-    int num_planets = 0;
-
-    // --- Read Header Line ---
-    if (fgets(line, sizeof(line), infile)) {
-        // Remove newline character
-        line[strcspn(line, "\n")] = 0;
-        
-        char *token = strtok(line, ","); // Skip "Date"
-        token = strtok(NULL, ",");
-        while (token != NULL && num_planets < MAX_PLANETS) {
-            planet_names[num_planets] = strdup(token);
-            num_planets++;
-            token = strtok(NULL, ",");
-        }
-    } else {
-        fprintf(stderr, "Could not read header from file.\n");
-        fclose(infile);
+    struct Dataset data;
+    int64_t from_t, to_t;
+    if (dataset_parse_range(cli_get(&params, "from"), cli_get(&params, "to"), &from_t, &to_t) != 0 ||
+        dataset_open_range(&data, input_filename, from_t, to_t) != 0) {
         return 1;
     }
+    int num_planets = data.num_bodies < MAX_PLANETS ? data.num_bodies : MAX_PLANETS;
 
-    printf("\n--- Found Conjunctions (Threshold: %.2f degrees) ---\n", threshold);
-
-    // --- Read Data Lines ---
-    while (fgets(line, sizeof(line), infile)) {
-        line[strcspn(line, "\n")] = 0;
-        
-        char *line_copy = strdup(line); // strtok modifies the string, so we use a copy
-        
-        char *date_str = strtok(line_copy, ",");
-        if (date_str == NULL) {
-            free(line_copy);
-            continue;
+    // --- Longitude Columns ---
+    struct FrameStore store;
+    const double *longitudes[MAX_PLANETS];
+    int have_positions = data.values_per_body == 3;
+    if (have_positions) frame_store_from_dataset(&store, &data);
+    for (int i = 0; i < num_planets; i++) {
+        longitudes[i] = have_positions ? frame_store_longitudes(&store, i) : dataset_column(&data, i, 0);
+        if (longitudes[i] == NULL) {
+            if (have_positions) frame_store_free(&store);
+            dataset_close(&data);
+            return 1;
         }
+    }
 
-        double longitudes[MAX_PLANETS];
-        int planet_idx = 0;
-        char *token = strtok(NULL, ",");
-        while (token != NULL && planet_idx < num_planets) {
-            longitudes[planet_idx] = atof(token);
-            planet_idx++;
-            token = strtok(NULL, ",");
-        }
+    printf("\n--- Found Conjunctions (Threshold: %.2f degrees) ---\n", threshold);
 
-        // --- Compare all planets to each other for this date ---
-        for (int i = 0; i < num_planets; i++) {
-            for (int j = i + 1; j < num_planets; j++) {
-                double angle_diff = fabs(longitudes[i] - longitudes[j]);
-                // Handle the wrap-around case (e.g., 359 degrees and 1 degree)
-                if (angle_diff > 180) {
-                    angle_diff = 360.0 - angle_diff;
-                }
-
-                if (angle_diff <= threshold) {
-                    printf("%s: %s and %s are in conjunction (%.2f° apart).\n",
-                           date_str, planet_names[i], planet_names[j], angle_diff);
-                }
-            }
+    // --- Scan Every Pair ---
+    struct AspectTable aspects;
+    aspect_table_init(&aspects);
+    aspect_table_add(&aspects, "Conjunction", 0.0, threshold);
+    struct EventList events = {0};
+    int failed = 0;
+    int64_t scan_start = STATS_START();
+    for (int i = 0; i < num_planets && !failed; i++) {
+        for (int j = i + 1; j < num_planets && !failed; j++) {
+            struct PairScan scan = {&events, i, j, 0};
+            event_scan_aspects(longitudes[i], longitudes[j], data.num_rows, &aspects, collect_event, &scan);
+            failed = scan.failed;
         }
-        
-        free(line_copy);
+    }
+    STATS_STOP(scan_time, scan_start);
+
+    // --- Report In Time Order ---
+    event_list_sort(&events);
+    for (size_t k = 0; k < events.count; k++) {
+        const struct SeparationEvent *event = &events.items[k];
+        char when[DATASET_TIME_LEN];
+        dataset_time_label(&data, event->row, when);
+        printf("%s: %s and %s are in conjunction (%.2f° apart).\n",
+               when, data.names[event->body_a], data.names[event->body_b], fabs(event->separation));
     }
 
     printf("--- Analysis Complete ---\n");
 
     // --- Cleanup ---
-    for (int i = 0; i < num_planets; i++) {
-        free(planet_names[i]);
-    }
-    fclose(infile);
+    event_list_free(&events);
+    if (have_positions) frame_store_free(&store);
+    dataset_close(&data);
 
-    return 0;
+    return failed ? 1 : 0;
 }
@@ -0,0 +1,563 @@
+/**
+ * @file planetary_bench.c
+ * @brief Reproducible benchmarks of the propagator, loader, detectors and
+ * CSV writer shared by the tools.
+ *
+ * Every benchmark runs on the same synthetic solar system: fixed elements
+ * for the nine planets (BENCH_ELEMENTS, close to their J2000 values),
+ * propagated once a day over BENCH_YEARS years. Nothing is fetched, so a
+ * result depends only on the build and the machine, and two builds can be
+ * compared run for run.
+ *
+ *  - KeplerSolve: the scalar solver behind kepler_sim's longitudes, one
+ *    solve per op.
+ *  - PropagateBatch: kepler_batch_propagate as kepler_sim_3d calls it,
+ *    ROWS_PER_BATCH rows at a time, one body position per op.
+ *  - Longitudes: the longitude columns of common/frame_store.h, computed
+ *    from the positions, one body position per op.
+ *  - ChebyshevPositions, ChebyshevPosition: the run fitted as kepler_sim_3d
+ *    -chebyshev writes it (common/chebyshev.h, a temporary file) and
+ *    evaluated at noon of every day, every body from one record or one body
+ *    per call, one body position per op: the cost of a lookup against
+ *    PropagateBatch's.
+ *  - CsvLoad: dataset_open of the run written out as a kepler_sim_3d
+ *    position CSV (a temporary file, removed at exit), one row per op.
+ *  - CsvWrite: rows formatted as kepler_sim_3d writes them, through a
+ *    CsvWriter into /dev/null, one row per op.
+ *  - DetectAlignments, DetectAspects, DetectApproaches: the detectors
+ *    multi_alignment_finder runs (common/groups.h, events.h and
+ *    approaches.h), over every body, one frame per op.
+ *
+ * Each benchmark runs "-repeat N" times (default BENCH_DEFAULT_REPEAT) and
+ * the fastest run is reported: warm caches, least noise. "-only
+ * NAME[,NAME...]" runs just those, e.g. "-only CsvLoad,CsvWrite". Results
+ * are one line per benchmark in Go's benchmark format, so benchstat can
+ * compare two runs:
+ *
+ *     BenchmarkPropagateBatch  657450  21.30 ns/op  5219282 frames/s
+ *
+ * that is "Benchmark" and the name, ops per run, nanoseconds per op and,
+ * for benchmarks that walk frames (a row of every body), frames per second.
+ * Lines starting with '#' describe the run. "-output FILE" writes the results to FILE.
+ * The visualizer's frame time comes from "sdl_visualizer -bench N" in the
+ * same format (see sdlVisualiser/visualizer.c); "make bench" at the top of
+ * the tree runs both.
+ *
+ * Compilation:
+ * gcc planetary_bench.c ../common/kepler.c ../common/csv_writer.c ../common/frame_store.c ../common/dataset.c ../common/ephemeris.c ../common/timebase.c ../common/groups.c ../common/clusters.c ../common/events.c ../common/aspects.c ../common/approaches.c ../common/cli.c ../common/chebyshev.c ../common/stats.c -I../common -fopenmp-simd -o planetary_bench -lm
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "kepler.h"
+#include "csv_writer.h"
+#include "frame_store.h"
+#include "dataset.h"
+#include "timebase.h"
+#include "groups.h"
+#include "events.h"
+#include "aspects.h"
+#include "approaches.h"
+#include "cli.h"
+#include "chebyshev.h"
+
+// --- Constants ---
+#define BENCH_NUM_BODIES 9
+#define BENCH_YEARS 200
+#define BENCH_START_DAY 10957.0     // 2000-01-01, days since 1970-01-01
+#define BENCH_DEFAULT_REPEAT 5
+#define ROWS_PER_BATCH 1024         // As kepler_sim_3d propagates
+#define ALIGNMENT_THRESHOLD 5.0     // Degrees, as a typical multi_alignment_finder run
+#define ALIGNMENT_MIN_BODIES 3
+#define ASPECT_ORB 5.0
+#define APPROACH_COUNT 20
+#define CHEBYSHEV_SEGMENT_DAYS 32   // As kepler_sim_3d -chebyshev writes by default
+#define CHEBYSHEV_COEFFS 16
+#define TEMP_PATH_LEN 64
+
+static const char *const BENCH_NAMES[BENCH_NUM_BODIES] = {
+    "Mercury", "Venus", "Earth", "Mars", "Jupiter", "Saturn", "Uranus", "Neptune", "Pluto"
+};
+
+// Mercury to Pluto, near their J2000 elements. Fixed, so every run scans the
+// same sky.
+static const struct KeplerElements BENCH_ELEMENTS[BENCH_NUM_BODIES] = {
+    {0.205630, 0.387098, 7.005, 48.331, 29.124, 174.796, 10957.5},
+    {0.006772, 0.723332, 3.395, 76.680, 54.884, 50.115, 10957.5},
+    {0.016709, 1.000001, 0.000, -11.261, 114.208, 358.617, 10957.5},
+    {0.093400, 1.523679, 1.850, 49.558, 286.502, 19.412, 10957.5},
+    {0.048900, 5.204400, 1.303, 100.464, 273.867, 20.020, 10957.5},
+    {0.056500, 9.582600, 2.485, 113.665, 339.392, 317.020, 10957.5},
+    {0.046381, 19.218400, 0.773, 74.006, 96.999, 142.239, 10957.5},
+    {0.008678, 30.070000, 1.770, 131.783, 273.187, 256.228, 10957.5},
+    {0.248800, 39.482000, 17.160, 110.299, 113.834, 14.530, 10957.5},
+};
+
+// The synthetic run every benchmark reads: per-body columns of daily
+// positions, x[body * num_rows + row], and their longitudes.
+struct BenchData {
+    struct KeplerBatch batch;
+    long num_rows;
+    double *days;
+    double *x, *y, *z;
+    struct FrameStore store;    // Over the columns, longitudes computed
+    char csv_path[TEMP_PATH_LEN];          // The run as a position CSV, for CsvLoad ("" if not written)
+    char chebyshev_path[TEMP_PATH_LEN];    // The run as Chebyshev segments ("" if not written)
+    struct ChebyshevFile chebyshev;        // chebyshev_path, mapped
+};
+
+// Work one run did: `ops` as reported, `frames` (0 if not frame-based).
+struct BenchCount {
+    long ops;
+    long frames;
+};
+
+struct BenchCase {
+    const char *name;
+    int (*run)(struct BenchData *data, struct BenchCount *count);
+};
+
+static volatile double bench_sink;   // Keeps results the compiler could otherwise drop
+
+// --- Function Prototypes ---
+static int bench_data_init(struct BenchData *data);
+static int write_rows(const struct BenchData *data, FILE *file);
+static int write_chebyshev(const struct BenchData *data, const char *path);
+static FILE *open_temp(char *path, const char *stem);
+static void bench_data_free(struct BenchData *data);
+static int name_listed(const char *list, const char *name);
+static double now_ns(void);
+
+// --- Benchmarks ---
+
+static int bench_kepler_solve(struct BenchData *data, struct BenchCount *count) {
+    const struct KeplerBatch *batch = &data->batch;
+    double sum = 0;
+    for (int i = 0; i < batch->count; i++) {
+        for (long r = 0; r < data->num_rows; r++) {
+            sum += kepler_solve(batch->m0[i] + batch->n[i] * (double)r, batch->e[i], NULL);
+        }
+    }
+    bench_sink = sum;
+    count->ops = (long)batch->count * data->num_rows;
+    count->frames = data->num_rows;
+    return 0;
+}
+
+static int bench_propagate_batch(struct BenchData *data, struct BenchCount *count) {
+    int n = data->batch.count;
+    double *xs = malloc((size_t)n * ROWS_PER_BATCH * 3 * sizeof(double));
+    if (xs == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    double *ys = xs + (size_t)n * ROWS_PER_BATCH, *zs = ys + (size_t)n * ROWS_PER_BATCH;
+    double sum = 0;
+    for (long first = 0; first < data->num_rows; first += ROWS_PER_BATCH) {
+        int rows = data->num_rows - first < ROWS_PER_BATCH ? (int)(data->num_rows - first) : ROWS_PER_BATCH;
+        kepler_batch_propagate(&data->batch, data->days + first, rows, xs, ys, zs);
+        sum += xs[0] + ys[rows - 1] + zs[(size_t)n * rows - 1];
+    }
+    bench_sink = sum;
+    free(xs);
+    count->ops = (long)n * data->num_rows;
+    count->frames = data->num_rows;
+    return 0;
+}
+
+static int bench_longitudes(struct BenchData *data, struct BenchCount *count) {
+    struct FrameStore store = data->store;
+    memset(store.longitudes, 0, sizeof(store.longitudes));
+    int status = 0;
+    for (int i = 0; i < store.num_bodies && status == 0; i++) {
+        if (frame_store_longitudes(&store, i) == NULL) status = -1;
+    }
+    bench_sink = store.longitudes[0] ? store.longitudes[0][data->num_rows - 1] : 0;
+    frame_store_free(&store);
+    count->ops = (long)data->store.num_bodies * data->num_rows;
+    count->frames = data->num_rows;
+    return status;
+}
+
+static int bench_chebyshev_positions(struct BenchData *data, struct BenchCount *count) {
+    double xyz[3 * BENCH_NUM_BODIES], sum = 0;
+    double t = BENCH_START_DAY * TIMEBASE_SECONDS_PER_DAY + TIMEBASE_SECONDS_PER_DAY / 2;
+    for (long r = 0; r < data->num_rows - 1; r++, t += TIMEBASE_SECONDS_PER_DAY) {
+        if (chebyshev_positions(&data->chebyshev, t, xyz) != 0) return -1;
+        sum += xyz[0] + xyz[3 * BENCH_NUM_BODIES - 1];
+    }
+    bench_sink = sum;
+    count->ops = (long)BENCH_NUM_BODIES * (data->num_rows - 1);
+    count->frames = data->num_rows - 1;
+    return 0;
+}
+
+static int bench_chebyshev_position(struct BenchData *data, struct BenchCount *count) {
+    int bodies[BENCH_NUM_BODIES];
+    for (int i = 0; i < BENCH_NUM_BODIES; i++) {
+        bodies[i] = chebyshev_find_body(&data->chebyshev, BENCH_NAMES[i]);
+        if (bodies[i] < 0) return -1;
+    }
+    double position[3], sum = 0;
+    double t = BENCH_START_DAY * TIMEBASE_SECONDS_PER_DAY + TIMEBASE_SECONDS_PER_DAY / 2;
+    for (long r = 0; r < data->num_rows - 1; r++, t += TIMEBASE_SECONDS_PER_DAY) {
+        for (int i = 0; i < BENCH_NUM_BODIES; i++) {
+            if (chebyshev_position(&data->chebyshev, bodies[i], t, position) != 0) return -1;
+            sum += position[0];
+        }
+    }
+    bench_sink = sum;
+    count->ops = (long)BENCH_NUM_BODIES * (data->num_rows - 1);
+    count->frames = data->num_rows - 1;
+    return 0;
+}
+
+static int bench_csv_load(struct BenchData *data, struct BenchCount *count) {
+    struct Dataset dataset;
+    if (dataset_open(&dataset, data->csv_path) != 0) return -1;
+    bench_sink = dataset.num_rows > 0 ? dataset_column(&dataset, 0, 0)[dataset.num_rows - 1] : 0;
+    count->ops = count->frames = dataset.num_rows;
+    dataset_close(&dataset);
+    return 0;
+}
+
+static int bench_csv_write(struct BenchData *data, struct BenchCount *count) {
+    FILE *file = fopen("/dev/null", "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Cannot open /dev/null for writing.\n");
+        return -1;
+    }
+    int status = write_rows(data, file);
+    fclose(file);
+    count->ops = count->frames = data->num_rows;
+    return status;
+}
+
+static int count_group(const struct GroupEvent *event, void *userp) {
+    (void)event;
+    (*(long *)userp)++;
+    return 0;
+}
+
+static int bench_detect_alignments(struct BenchData *data, struct BenchCount *count) {
+    struct GroupTracker tracker;
+    if (group_tracker_init(&tracker, data->store.num_bodies, ALIGNMENT_THRESHOLD, ALIGNMENT_MIN_BODIES) != 0) {
+        return -1;
+    }
+    const double *columns[FRAME_STORE_MAX_BODIES];
+    for (int i = 0; i < data->store.num_bodies; i++) columns[i] = data->store.longitudes[i];
+    long found = 0;
+    int status = group_tracker_feed(&tracker, columns, data->num_rows, count_group, &found);
+    if (status == 0) status = group_tracker_finish(&tracker, count_group, &found);
+    group_tracker_free(&tracker);
+    bench_sink = (double)found;
+    count->ops = count->frames = data->num_rows;
+    return status;
+}
+
+static void count_event(const struct SeparationEvent *event, void *userp) {
+    (void)event;
+    (*(long *)userp)++;
+}
+
+static int bench_detect_aspects(struct BenchData *data, struct BenchCount *count) {
+    struct AspectTable table;
+    aspect_table_init(&table);
+    if (aspect_table_parse(&table, "major", ASPECT_ORB) != 0) return -1;
+    long found = 0;
+    for (int i = 0; i < data->store.num_bodies; i++) {
+        for (int j = i + 1; j < data->store.num_bodies; j++) {
+            event_scan_aspects(data->store.longitudes[i], data->store.longitudes[j], data->num_rows, &table,
+                               count_event, &found);
+        }
+    }
+    bench_sink = (double)found;
+    count->ops = count->frames = data->num_rows;
+    return 0;
+}
+
+static int bench_detect_approaches(struct BenchData *data, struct BenchCount *count) {
+    struct ApproachHeap heap;
+    if (approach_heap_init(&heap, APPROACH_COUNT) != 0) return -1;
+    int bodies[FRAME_STORE_MAX_BODIES];
+    for (int i = 0; i < data->store.num_bodies; i++) bodies[i] = i;
+    long found = approach_scan(&data->store, bodies, data->store.num_bodies, &heap);
+    approach_heap_free(&heap);
+    bench_sink = (double)found;
+    count->ops = count->frames = data->num_rows;
+    return found < 0 ? -1 : 0;
+}
+
+static const struct BenchCase BENCH_CASES[] = {
+    {"KeplerSolve", bench_kepler_solve},
+    {"PropagateBatch", bench_propagate_batch},
+    {"Longitudes", bench_longitudes},
+    {"ChebyshevPositions", bench_chebyshev_positions},
+    {"ChebyshevPosition", bench_chebyshev_position},
+    {"CsvLoad", bench_csv_load},
+    {"CsvWrite", bench_csv_write},
+    {"DetectAlignments", bench_detect_alignments},
+    {"DetectAspects", bench_detect_aspects},
+    {"DetectApproaches", bench_detect_approaches},
+};
+
+// --- Main ---
+int main(int argc, char *argv[]) {
+    static const char *const param_names[] = {"output", "repeat", "only", NULL};
+    struct CliParams params;
+    cli_init(&params, param_names);
+    for (int a = 1; a < argc; a++) {
+        int used = cli_parse_option(argc, argv, &a, &params);
+        if (used < 0) return 1;
+        if (!used) {
+            fprintf(stderr, "Error: Unknown option '%s'.\n", argv[a]);
+            return 1;
+        }
+    }
+    cli_begin(&params);
+
+    int repeat = BENCH_DEFAULT_REPEAT;
+    if (cli_get(&params, "repeat")) {
+        char *end;
+        repeat = (int)strtol(cli_get(&params, "repeat"), &end, 10);
+        if (*end != '\0' || repeat < 1) {
+            fprintf(stderr, "Error: -repeat must be a positive count.\n");
+            return 1;
+        }
+    }
+    const char *only = cli_get(&params, "only");
+    const char *output = cli_get(&params, "output");
+    FILE *out = output ? cli_open_output(output, "w") : stdout;
+    if (out == NULL) {
+        fprintf(stderr, "Error: Cannot open '%s' for writing.\n", output);
+        return 1;
+    }
+
+    struct BenchData data;
+    if (bench_data_init(&data) != 0) return 1;
+    fprintf(out, "# planetary_bench: %d bodies, %ld frames (%d years daily), fastest of %d runs\n",
+            data.batch.count, data.num_rows, BENCH_YEARS, repeat);
+
+    int status = 0;
+    for (size_t k = 0; k < sizeof(BENCH_CASES) / sizeof(BENCH_CASES[0]); k++) {
+        const struct BenchCase *bench = &BENCH_CASES[k];
+        if (only && !name_listed(only, bench->name)) continue;
+        struct BenchCount count = {0, 0};
+        double best = -1;
+        for (int r = 0; r < repeat; r++) {
+            double start = now_ns();
+            if (bench->run(&data, &count) != 0) break;
+            double elapsed = now_ns() - start;
+            if (best < 0 || elapsed < best) best = elapsed;
+        }
+        if (best < 0 || count.ops <= 0) {
+            fprintf(stderr, "Error: Benchmark %s failed.\n", bench->name);
+            status = 1;
+            continue;
+        }
+        fprintf(out, "Benchmark%s\t%ld\t%.2f ns/op", bench->name, count.ops, best / (double)count.ops);
+        if (count.frames > 0) fprintf(out, "\t%.0f frames/s", (double)count.frames * 1e9 / best);
+        fprintf(out, "\n");
+        fflush(out);
+    }
+
+    bench_data_free(&data);
+    if (out != stdout) fclose(out);
+    return status;
+}
+
+// --- Setup ---
+
+// Propagates the synthetic run and writes it to a temporary CSV. Returns 0,
+// or -1 on failure.
+static int bench_data_init(struct BenchData *data) {
+    memset(data, 0, sizeof(*data));
+    data->num_rows = (long)(BENCH_YEARS * 365.25);
+    if (kepler_batch_init(&data->batch, BENCH_ELEMENTS, BENCH_NUM_BODIES) != 0) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    size_t n = (size_t)BENCH_NUM_BODIES * data->num_rows;
+    data->days = malloc(data->num_rows * sizeof(double));
+    data->x = malloc(n * sizeof(double));
+    data->y = malloc(n * sizeof(double));
+    data->z = malloc(n * sizeof(double));
+    if (data->days == NULL || data->x == NULL || data->y == NULL || data->z == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        bench_data_free(data);
+        return -1;
+    }
+    for (long r = 0; r < data->num_rows; r++) data->days[r] = BENCH_START_DAY + (double)r;
+    kepler_batch_propagate(&data->batch, data->days, (int)data->num_rows, data->x, data->y, data->z);
+
+    const double *xs[BENCH_NUM_BODIES], *ys[BENCH_NUM_BODIES], *zs[BENCH_NUM_BODIES];
+    for (int i = 0; i < BENCH_NUM_BODIES; i++) {
+        xs[i] = data->x + (size_t)i * data->num_rows;
+        ys[i] = data->y + (size_t)i * data->num_rows;
+        zs[i] = data->z + (size_t)i * data->num_rows;
+    }
+    frame_store_init(&data->store, BENCH_NUM_BODIES, data->num_rows, xs, ys, zs);
+    for (int i = 0; i < BENCH_NUM_BODIES; i++) {
+        if (frame_store_longitudes(&data->store, i) == NULL) {
+            bench_data_free(data);
+            return -1;
+        }
+    }
+
+    // The CSV CsvLoad reads, laid out as kepler_sim_3d writes it.
+    FILE *file = open_temp(data->csv_path, "csv");
+    if (file == NULL) {
+        bench_data_free(data);
+        return -1;
+    }
+    fprintf(file, "Date");
+    for (int i = 0; i < BENCH_NUM_BODIES; i++) {
+        fprintf(file, ",%s_x,%s_y,%s_z", BENCH_NAMES[i], BENCH_NAMES[i], BENCH_NAMES[i]);
+    }
+    fprintf(file, "\n");
+    int status = write_rows(data, file);
+    if (fclose(file) != 0 || status != 0) {
+        fprintf(stderr, "Error: Cannot write the temporary CSV '%s'.\n", data->csv_path);
+        bench_data_free(data);
+        return -1;
+    }
+
+    // The segments the Chebyshev benchmarks evaluate.
+    file = open_temp(data->chebyshev_path, "cheb");
+    if (file == NULL) {
+        bench_data_free(data);
+        return -1;
+    }
+    fclose(file);
+    if (write_chebyshev(data, data->chebyshev_path) != 0 ||
+        chebyshev_open(&data->chebyshev, data->chebyshev_path) != 0) {
+        bench_data_free(data);
+        return -1;
+    }
+    return 0;
+}
+
+// Fits the run into CHEBYSHEV_SEGMENT_DAYS segments through the propagator
+// at each segment's Chebyshev nodes, as kepler_sim_3d -chebyshev does.
+// Returns 0 on success.
+static int write_chebyshev(const struct BenchData *data, const char *path) {
+    const struct KeplerBatch *batch = &data->batch;
+    int n = batch->count;
+    int64_t start_t = (int64_t)BENCH_START_DAY * TIMEBASE_SECONDS_PER_DAY;
+    int64_t segment_seconds = (int64_t)CHEBYSHEV_SEGMENT_DAYS * TIMEBASE_SECONDS_PER_DAY;
+    int64_t span = (int64_t)(data->num_rows - 1) * TIMEBASE_SECONDS_PER_DAY;
+    long num_segments = (long)((span + segment_seconds - 1) / segment_seconds);
+    struct ChebyshevWriter writer;
+    if (chebyshev_writer_open(&writer, path, BENCH_NAMES, n, CHEBYSHEV_COEFFS, CHEBYSHEV_CENTRE_SUN,
+                              num_segments, start_t, segment_seconds, start_t + span) != 0) {
+        return -1;
+    }
+    double nodes[CHEBYSHEV_COEFFS], days[CHEBYSHEV_COEFFS];
+    double xyz[3 * BENCH_NUM_BODIES * CHEBYSHEV_COEFFS], record[3 * BENCH_NUM_BODIES * CHEBYSHEV_COEFFS];
+    size_t plane = (size_t)n * CHEBYSHEV_COEFFS;
+    chebyshev_nodes(CHEBYSHEV_COEFFS, nodes);
+    int status = 0;
+    for (long s = 0; s < num_segments && status == 0; s++) {
+        double segment_start = (double)start_t + (double)s * segment_seconds;
+        for (int k = 0; k < CHEBYSHEV_COEFFS; k++) {
+            days[k] = (segment_start + 0.5 * (nodes[k] + 1.0) * segment_seconds) / TIMEBASE_SECONDS_PER_DAY;
+        }
+        kepler_batch_propagate(batch, days, CHEBYSHEV_COEFFS, xyz, xyz + plane, xyz + 2 * plane);
+        for (int i = 0; i < n; i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                chebyshev_fit_nodes(xyz + axis * plane + (size_t)i * CHEBYSHEV_COEFFS, CHEBYSHEV_COEFFS,
+                                    record + ((size_t)i * 3 + axis) * CHEBYSHEV_COEFFS);
+            }
+        }
+        status = chebyshev_writer_put(&writer, record);
+    }
+    if (chebyshev_writer_close(&writer) != 0) status = -1;
+    return status;
+}
+
+// Writes the run's rows as kepler_sim_3d formats them, through a CsvWriter.
+// Returns 0, or -1 on a write error.
+static int write_rows(const struct BenchData *data, FILE *file) {
+    struct CsvWriter writer;
+    if (csv_writer_init(&writer, file, 0) != 0) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    int n = data->batch.count;
+    struct TimeLabel date;
+    time_label_init(&date, (int64_t)BENCH_START_DAY * TIMEBASE_SECONDS_PER_DAY, 0);
+    size_t row_max = sizeof(date.text) + (size_t)n * 3 * (1 + CSV_FIXED_MAX_LEN) + 1;
+    for (long r = 0; r < data->num_rows; r++) {
+        char *p = csv_writer_reserve(&writer, row_max);
+        for (const char *t = date.text; *t; t++) *p++ = *t;
+        for (int i = 0; i < n; i++) {
+            size_t idx = (size_t)i * data->num_rows + r;
+            *p++ = ',';
+            p = csv_put_fixed(p, data->x[idx], 6);
+            *p++ = ',';
+            p = csv_put_fixed(p, data->y[idx], 6);
+            *p++ = ',';
+            p = csv_put_fixed(p, data->z[idx], 6);
+        }
+        *p++ = '\n';
+        csv_writer_commit(&writer, p);
+        time_label_advance(&date, TIMEBASE_SECONDS_PER_DAY);
+    }
+    return csv_writer_finish(&writer);
+}
+
+static void bench_data_free(struct BenchData *data) {
+    chebyshev_close(&data->chebyshev);
+    if (data->chebyshev_path[0]) remove(data->chebyshev_path);
+    if (data->csv_path[0]) remove(data->csv_path);
+    frame_store_free(&data->store);
+    kepler_batch_free(&data->batch);
+    free(data->days);
+    free(data->x);
+    free(data->y);
+    free(data->z);
+}
+
+// --- Helpers ---
+
+// Creates an empty temporary file, planetary_bench_<stem>_XXXXXX in $TMPDIR
+// (or /tmp), and opens it for writing. Its name is kept in `path`
+// (TEMP_PATH_LEN bytes) so it can be removed. Returns NULL, with `path`
+// empty, on failure.
+static FILE *open_temp(char *path, const char *stem) {
+    const char *dir = getenv("TMPDIR");
+    if (dir == NULL || *dir == '\0' || strlen(dir) + strlen(stem) + 24 > TEMP_PATH_LEN) dir = "/tmp";
+    snprintf(path, TEMP_PATH_LEN, "%s/planetary_bench_%s_XXXXXX", dir, stem);
+    int fd = mkstemp(path);
+    FILE *file = fd >= 0 ? fdopen(fd, "w") : NULL;
+    if (file == NULL) {
+        fprintf(stderr, "Error: Cannot create a temporary file in '%s'.\n", dir);
+        if (fd >= 0) close(fd);
+        path[0] = '\0';
+    }
+    return file;
+}
+
+// Returns 1 if `name` is one of the comma-separated names in `list`.
+static int name_listed(const char *list, const char *name) {
+    size_t len = strlen(name);
+    for (const char *p = list; *p; ) {
+        const char *comma = strchr(p, ',');
+        size_t item = comma ? (size_t)(comma - p) : strlen(p);
+        if (item == len && strncmp(p, name, len) == 0) return 1;
+        if (!comma) break;
+        p = comma + 1;
+    }
+    return 0;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file approaches.c
+ * @brief Closest-approach search implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "approaches.h"
+#include "events.h"
+
+// --- Top-K Heap ---
+
+int approach_heap_init(struct ApproachHeap *heap, int capacity) {
+    memset(heap, 0, sizeof(*heap));
+    if (capacity < 1) capacity = 1;
+    heap->items = malloc((size_t)capacity * sizeof(*heap->items));
+    if (heap->items == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    heap->capacity = capacity;
+    return 0;
+}
+
+static void sift_down(struct Approach *items, int count, int i) {
+    for (;;) {
+        int largest = i, left = 2 * i + 1, right = left + 1;
+        if (left < count && items[left].distance > items[largest].distance) largest = left;
+        if (right < count && items[right].distance > items[largest].distance) largest = right;
+        if (largest == i) return;
+        struct Approach swap = items[i];
+        items[i] = items[largest];
+        items[largest] = swap;
+        i = largest;
+    }
+}
+
+void approach_heap_push(struct ApproachHeap *heap, const struct Approach *approach) {
+    struct Approach *items = heap->items;
+    if (heap->count < heap->capacity) {
+        int i = heap->count++;
+        while (i > 0 && items[(i - 1) / 2].distance < approach->distance) {
+            items[i] = items[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        items[i] = *approach;
+    } else if (approach->distance < items[0].distance) {
+        items[0] = *approach;   // Replace the farthest kept approach
+        sift_down(items, heap->count, 0);
+    }
+}
+
+static int compare_approaches(const void *pa, const void *pb) {
+    const struct Approach *a = pa, *b = pb;
+    if (a->distance != b->distance) return a->distance < b->distance ? -1 : 1;
+    return (a->row > b->row) - (a->row < b->row);
+}
+
+void approach_heap_sort(struct ApproachHeap *heap) {
+    qsort(heap->items, (size_t)heap->count, sizeof(*heap->items), compare_approaches);
+}
+
+void approach_heap_free(struct ApproachHeap *heap) {
+    free(heap->items);
+    memset(heap, 0, sizeof(*heap));
+}
+
+// --- Blocked Scan ---
+
+// The two previous squared distances of a pair, carried across blocks.
+struct PairTrail {
+    double before, last;
+};
+
+int approach_scan_init(struct ApproachScan *scan, const int *bodies, int num_bodies) {
+    memset(scan, 0, sizeof(*scan));
+    if (num_bodies > FRAME_STORE_MAX_BODIES) num_bodies = FRAME_STORE_MAX_BODIES;
+    memcpy(scan->bodies, bodies, (size_t)num_bodies * sizeof(int));
+    scan->num_bodies = num_bodies;
+    int num_pairs = num_bodies * (num_bodies - 1) / 2;
+    scan->trails = calloc(num_pairs > 0 ? (size_t)num_pairs : 1, sizeof(*scan->trails));
+    if (scan->trails == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    return 0;
+}
+
+void approach_scan_feed(struct ApproachScan *scan, const struct FrameStore *store, struct ApproachHeap *heap) {
+    const int *bodies = scan->bodies;
+    int num_bodies = scan->num_bodies;
+    for (long start = 0; start < store->num_rows; start += APPROACH_BLOCK_ROWS) {
+        long end = start + APPROACH_BLOCK_ROWS;
+        if (end > store->num_rows) end = store->num_rows;
+
+        int pair = 0;
+        for (int a = 0; a < num_bodies; a++) {
+            int i = bodies[a];
+            const double *x1 = store->x[i], *y1 = store->y[i], *z1 = store->z[i];
+            for (int b = a + 1; b < num_bodies; b++, pair++) {
+                int j = bodies[b];
+                const double *x2 = store->x[j], *y2 = store->y[j], *z2 = store->z[j];
+                struct PairTrail trail = scan->trails[pair];
+                for (long r = start; r < end; r++) {
+                    double dx = x1[r] - x2[r], dy = y1[r] - y2[r], dz = z1[r] - z2[r];
+                    double d2 = dx * dx + dy * dy + dz * dz;
+                    // A minimum at r - 1: strictly below the sample before it
+                    // (so plateaus count once) and not above the one after.
+                    long row = scan->row + r;
+                    if (row - scan->origin >= 2 && trail.last < trail.before && trail.last <= d2) {
+                        struct Approach approach = {(double)(row - 1), sqrt(trail.last), i, j};
+                        double offset, value;
+                        if (event_parabolic_vertex(trail.before, trail.last, d2, &offset, &value) == 0 && value >= 0) {
+                            approach.row += offset;
+                            approach.distance = sqrt(value);
+                        }
+                        approach_heap_push(heap, &approach);
+                        scan->found++;
+                    }
+                    trail.before = trail.last;
+                    trail.last = d2;
+                }
+                scan->trails[pair] = trail;
+            }
+        }
+    }
+    scan->row += store->num_rows;
+}
+
+void approach_scan_set_origin(struct ApproachScan *scan, long row) {
+    scan->origin = scan->row = row;
+}
+
+void approach_scan_free(struct ApproachScan *scan) {
+    free(scan->trails);
+    scan->trails = NULL;
+}
+
+long approach_scan(const struct FrameStore *store, const int *bodies, int num_bodies, struct ApproachHeap *heap) {
+    if (num_bodies < 2 || store->num_rows < 3) return 0;
+    struct ApproachScan scan;
+    if (approach_scan_init(&scan, bodies, num_bodies) != 0) return -1;
+    approach_scan_feed(&scan, store, heap);
+    approach_scan_free(&scan);
+    return scan.found;
+}
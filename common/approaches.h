@@ -0,0 +1,86 @@
+/**
+ * @file approaches.h
+ * @brief Closest-approach search over every pair of bodies.
+ *
+ * Walks the position columns of a FrameStore in blocks of rows. Each block
+ * is scanned for every pair before moving on, so the whole search is one
+ * pass over the columns. A local minimum of the squared distance between
+ * two samples is refined with a parabola through its neighbours. This gives
+ * the time and distance of the approach between samples, where the old
+ * search was limited to the nearest day.
+ *
+ * Results are collected in a bounded max-heap that keeps the K closest.
+ *
+ * An ApproachScan runs the same search over positions that arrive in
+ * batches, carrying the last two distances of each pair from one batch to
+ * the next; its results match a single approach_scan over all the rows.
+ */
+
+#ifndef APPROACHES_H
+#define APPROACHES_H
+
+#include "frame_store.h"
+
+#define APPROACH_BLOCK_ROWS 2048   // Rows per block: a few hundred KiB of columns
+#define APPROACH_SCAN_LEAD_ROWS 2  // Rows after which a scan no longer depends on where it started
+
+// One refined local minimum of the distance between two bodies.
+struct Approach {
+    double row;        // Fractional row index (see dataset_time_label)
+    double distance;   // Same units as the positions (AU)
+    int body_a, body_b;
+};
+
+// Keeps the `capacity` smallest approaches pushed into it.
+struct ApproachHeap {
+    struct Approach *items;   // Max-heap on distance until approach_heap_sort
+    int count;
+    int capacity;
+};
+
+// Allocates a heap for the `capacity` closest approaches. Returns 0, or -1 if
+// out of memory.
+int approach_heap_init(struct ApproachHeap *heap, int capacity);
+
+// Offers an approach; it is kept if it is among the closest so far.
+void approach_heap_push(struct ApproachHeap *heap, const struct Approach *approach);
+
+// Sorts the kept approaches closest first. The heap is then only fit for
+// reading.
+void approach_heap_sort(struct ApproachHeap *heap);
+
+// Releases the heap.
+void approach_heap_free(struct ApproachHeap *heap);
+
+struct PairTrail;
+
+// Incremental search state over a fixed set of bodies.
+struct ApproachScan {
+    int bodies[FRAME_STORE_MAX_BODIES];
+    int num_bodies;
+    long origin;               // Row the data starts at
+    long row;                  // Next row to consume
+    long found;                // Minima found so far
+    struct PairTrail *trails;  // One per pair
+};
+
+// Starts an incremental search over `bodies`. Returns 0, or -1 if out of
+// memory.
+int approach_scan_init(struct ApproachScan *scan, const int *bodies, int num_bodies);
+
+// Numbers the rows from `row` instead of 0, for a search over data that
+// starts part-way through a run (see chunk_scan.h). Call before feeding.
+void approach_scan_set_origin(struct ApproachScan *scan, long row);
+
+// Scans the rows of `store`, which continue where the previous batch ended,
+// and offers the minima found to `heap`. Row numbers run across batches.
+void approach_scan_feed(struct ApproachScan *scan, const struct FrameStore *store, struct ApproachHeap *heap);
+
+// Releases the search state.
+void approach_scan_free(struct ApproachScan *scan);
+
+// Finds the local distance minima of every pair among `bodies` and offers
+// them to `heap`. Returns the number of minima found, or -1 if out of memory.
+long approach_scan(const struct FrameStore *store, const int *bodies, int num_bodies, struct ApproachHeap *heap);
+
+#endif // APPROACHES_H
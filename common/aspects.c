@@ -0,0 +1,150 @@
+/**
+ * @file aspects.c
+ * @brief Aspect table implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include "aspects.h"
+
+#define SPEC_ITEM_LEN 96
+
+static const struct Aspect STANDARD_ASPECTS[] = {
+    {"Conjunction", 0.0, 0.0},
+    {"Sextile", 60.0, 0.0},
+    {"Square", 90.0, 0.0},
+    {"Trine", 120.0, 0.0},
+    {"Opposition", 180.0, 0.0},
+};
+#define NUM_STANDARD (sizeof(STANDARD_ASPECTS) / sizeof(STANDARD_ASPECTS[0]))
+
+int aspect_bin(double separation) {
+    int bin = (int)floor(separation + 180.0);
+    bin %= ASPECT_BINS;
+    return bin < 0 ? bin + ASPECT_BINS : bin;
+}
+
+// Rebuilds both bin indexes from the target list.
+static void build_bins(struct AspectTable *table) {
+    int exact_len = 0, orb_len = 0;
+    for (int b = 0; b < ASPECT_BINS; b++) {
+        table->exact_start[b] = (short)exact_len;
+        table->orb_start[b] = (short)orb_len;
+        double low = b - 180.0, high = low + 1.0;
+        for (int t = 0; t < table->num_targets; t++) {
+            double angle = table->target_angle[t];
+            if (aspect_bin(angle) == b) table->exact[exact_len++] = (unsigned char)t;
+
+            // Does [angle - orb, angle + orb] overlap this bin, modulo 360?
+            double orb = table->aspects[table->target_aspect[t]].orb;
+            for (int lap = -1; lap <= 1; lap++) {
+                double centre = angle + lap * 360.0;
+                if (centre - orb < high && centre + orb >= low) {
+                    table->orb[orb_len++] = (unsigned char)t;
+                    break;
+                }
+            }
+        }
+    }
+    table->exact_start[ASPECT_BINS] = (short)exact_len;
+    table->orb_start[ASPECT_BINS] = (short)orb_len;
+}
+
+void aspect_table_init(struct AspectTable *table) {
+    memset(table, 0, sizeof(*table));
+}
+
+int aspect_table_add(struct AspectTable *table, const char *name, double angle, double orb) {
+    if (table->count >= ASPECT_MAX) {
+        fprintf(stderr, "Error: At most %d aspects can be searched at once.\n", ASPECT_MAX);
+        return -1;
+    }
+    if (!(angle >= 0 && angle <= 180)) {
+        fprintf(stderr, "Error: Aspect angle %g is outside 0-180 degrees.\n", angle);
+        return -1;
+    }
+    if (!(orb >= 0)) orb = 0;
+    if (orb > 180) orb = 180;
+
+    int index = table->count++;
+    struct Aspect *aspect = &table->aspects[index];
+    snprintf(aspect->name, sizeof(aspect->name), "%s", name);
+    aspect->angle = angle;
+    aspect->orb = orb;
+
+    table->target_angle[table->num_targets] = angle;
+    table->target_aspect[table->num_targets++] = index;
+    if (angle > 0 && angle < 180) {
+        table->target_angle[table->num_targets] = -angle;
+        table->target_aspect[table->num_targets++] = index;
+    }
+    build_bins(table);
+    return 0;
+}
+
+// Adds one "Name", "major" or "Name:Angle[:Orb]" item.
+static int parse_item(struct AspectTable *table, char *item, double default_orb) {
+    char *angle_text = strchr(item, ':');
+    if (angle_text == NULL) {
+        if (strcasecmp(item, "major") == 0) {
+            for (size_t k = 0; k < NUM_STANDARD; k++) {
+                if (aspect_table_add(table, STANDARD_ASPECTS[k].name, STANDARD_ASPECTS[k].angle, default_orb) != 0) return -1;
+            }
+            return 0;
+        }
+        for (size_t k = 0; k < NUM_STANDARD; k++) {
+            if (strcasecmp(item, STANDARD_ASPECTS[k].name) == 0) {
+                return aspect_table_add(table, STANDARD_ASPECTS[k].name, STANDARD_ASPECTS[k].angle, default_orb);
+            }
+        }
+        fprintf(stderr, "Error: Unknown aspect '%s' (expected %s).\n", item, ASPECT_SPEC_HELP);
+        return -1;
+    }
+
+    char original[SPEC_ITEM_LEN];
+    snprintf(original, sizeof(original), "%s", item);
+    *angle_text++ = '\0';
+    char *end;
+    double angle = strtod(angle_text, &end);
+    double orb = default_orb;
+    int ok = end != angle_text;
+    if (ok && *end == ':') {
+        char *orb_text = end + 1;
+        orb = strtod(orb_text, &end);
+        ok = end != orb_text;
+    }
+    if (!ok || *end != '\0' || item[0] == '\0') {
+        fprintf(stderr, "Error: Bad aspect '%s' (expected Name:Angle[:Orb]).\n", original);
+        return -1;
+    }
+    return aspect_table_add(table, item, angle, orb);
+}
+
+int aspect_table_parse(struct AspectTable *table, const char *spec, double default_orb) {
+    const char *p = spec;
+    while (*p) {
+        const char *stop = strchr(p, ',');
+        size_t len = stop ? (size_t)(stop - p) : strlen(p);
+        if (len > 0) {
+            char item[SPEC_ITEM_LEN];
+            if (len >= sizeof(item)) {
+                fprintf(stderr, "Error: Aspect '%.*s...' is too long.\n", 16, p);
+                return -1;
+            }
+            memcpy(item, p, len);
+            item[len] = '\0';
+            if (parse_item(table, item, default_orb) != 0) return -1;
+        }
+        if (stop == NULL) break;
+        p = stop + 1;
+    }
+    if (table->count == 0) {
+        fprintf(stderr, "Error: No aspects given.\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file aspects.h
+ * @brief Configurable table of angular aspects (conjunction, square, ...).
+ *
+ * Each aspect is an angle in [0, 180] with its own orb. An aspect of angle A
+ * is met when the signed separation of two longitudes reaches +A or -A, so
+ * the table expands it into one or two signed targets.
+ *
+ * The targets are also binned by degree of signed separation. Each bin
+ * lists the targets whose exact angle lies in it and those whose orb window
+ * overlaps it. A single pass over the data can then classify every sample
+ * against every aspect at once with a lookup, instead of scanning once per
+ * aspect (see event_scan_aspects).
+ */
+
+#ifndef ASPECTS_H
+#define ASPECTS_H
+
+#define ASPECT_MAX 16
+#define ASPECT_NAME_LEN 32
+#define ASPECT_MAX_TARGETS (2 * ASPECT_MAX)
+#define ASPECT_BINS 360                     // One per degree of (-180, 180]
+#define ASPECT_SPEC_HELP "conjunction,sextile,square,trine,opposition, major, or Name:Angle[:Orb]"
+
+struct Aspect {
+    char name[ASPECT_NAME_LEN];
+    double angle;   // Degrees, 0-180
+    double orb;     // Degrees either side of the angle
+};
+
+struct AspectTable {
+    int count;
+    struct Aspect aspects[ASPECT_MAX];
+
+    // Derived by aspect_table_add.
+    int num_targets;
+    double target_angle[ASPECT_MAX_TARGETS];   // Signed, in (-180, 180]
+    int target_aspect[ASPECT_MAX_TARGETS];     // Index into aspects
+    short exact_start[ASPECT_BINS + 1];        // Bin b's exact targets are
+    unsigned char exact[ASPECT_MAX_TARGETS];   //   exact[exact_start[b] .. exact_start[b + 1])
+    short orb_start[ASPECT_BINS + 1];          // Likewise for orb windows
+    unsigned char orb[ASPECT_MAX_TARGETS * ASPECT_BINS];
+};
+
+// Empties the table.
+void aspect_table_init(struct AspectTable *table);
+
+// Adds an aspect. Returns 0, or -1 if the table is full or the angle is
+// outside [0, 180].
+int aspect_table_add(struct AspectTable *table, const char *name, double angle, double orb);
+
+// Adds the aspects in a comma-separated `spec`: the standard names
+// (case-insensitive), "major" for all five, or "Name:Angle[:Orb]" for a custom
+// angle. Aspects without an orb get `default_orb`. Returns 0, or -1 with a
+// message on stderr.
+int aspect_table_parse(struct AspectTable *table, const char *spec, double default_orb);
+
+// Returns the bin of a signed separation in (-180, 180].
+int aspect_bin(double separation);
+
+#endif // ASPECTS_H
@@ -0,0 +1,242 @@
+/**
+ * @file cache.c
+ * @brief On-disk Horizons response cache implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "cache.h"
+
+#define CACHE_DIR_LEN 512
+#define CACHE_URL_LEN 2048
+#define CACHE_MAX_PARAMS 32
+#define CACHE_SUFFIX ".hzc"
+
+static char cache_dir[CACHE_DIR_LEN] = "";
+static long cache_ttl = -1;     // -1 = not set on the command line
+static int offline_mode = -1;   // -1 = not set on the command line
+static int cache_disabled = 0;
+static int clear_requested = 0;
+
+int cache_parse_option(int argc, char *argv[], int *index) {
+    const char *arg = argv[*index];
+    if (strcmp(arg, "-offline") == 0) {
+        offline_mode = 1;
+    } else if (strcmp(arg, "-no-cache") == 0) {
+        cache_disabled = 1;
+    } else if (strcmp(arg, "-cache-clear") == 0) {
+        clear_requested = 1;
+    } else if (strcmp(arg, "-cache-dir") == 0 && *index + 1 < argc) {
+        snprintf(cache_dir, sizeof(cache_dir), "%s", argv[++(*index)]);
+    } else if (strcmp(arg, "-cache-ttl") == 0 && *index + 1 < argc) {
+        cache_ttl = atol(argv[++(*index)]);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// Creates `path` and any missing parents.
+static int make_dirs(const char *path) {
+    char tmp[CACHE_DIR_LEN];
+    snprintf(tmp, sizeof(tmp), "%s", path);
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return -1;
+        *p = '/';
+    }
+    if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return -1;
+    return 0;
+}
+
+int cache_init(void) {
+    const char *env;
+    if (offline_mode < 0) {
+        env = getenv("HORIZONS_OFFLINE");
+        offline_mode = (env && strcmp(env, "1") == 0) ? 1 : 0;
+    }
+    if (cache_ttl < 0) {
+        env = getenv("HORIZONS_CACHE_TTL");
+        cache_ttl = env ? atol(env) : 0;
+    }
+    if (cache_dir[0] == '\0') {
+        if ((env = getenv("HORIZONS_CACHE_DIR")) && *env) {
+            snprintf(cache_dir, sizeof(cache_dir), "%s", env);
+        } else if ((env = getenv("XDG_CACHE_HOME")) && *env) {
+            snprintf(cache_dir, sizeof(cache_dir), "%s/planetary_logger", env);
+        } else if ((env = getenv("HOME")) && *env) {
+            snprintf(cache_dir, sizeof(cache_dir), "%s/.cache/planetary_logger", env);
+        } else {
+            snprintf(cache_dir, sizeof(cache_dir), ".horizons_cache");
+        }
+    }
+    // Cleared even under -no-cache, which only stops the cache being used.
+    if (clear_requested) {
+        int removed = cache_invalidate(NULL);
+        printf("Cleared %d cached response(s) from '%s'.\n", removed, cache_dir);
+        clear_requested = 0;
+    }
+    if (cache_disabled) return 0;
+
+    if (make_dirs(cache_dir) != 0) {
+        fprintf(stderr, "Warning: Could not create cache directory '%s'; caching disabled.\n", cache_dir);
+        cache_disabled = 1;
+    }
+    return 0;
+}
+
+int cache_offline(void) {
+    return offline_mode == 1;
+}
+
+static int compare_params(const void *a, const void *b) {
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+// Produces the cache key for a URL: scheme and host are kept as-is and the
+// query parameters are sorted so parameter order does not matter.
+static void normalize_url(const char *url, char *out, size_t out_len) {
+    char query[CACHE_URL_LEN];
+    const char *q = strchr(url, '?');
+    if (!q) {
+        snprintf(out, out_len, "%s", url);
+        return;
+    }
+    snprintf(query, sizeof(query), "%s", q + 1);
+
+    char *params[CACHE_MAX_PARAMS];
+    int count = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(query, "&", &save); tok && count < CACHE_MAX_PARAMS;
+         tok = strtok_r(NULL, "&", &save)) {
+        params[count++] = tok;
+    }
+    qsort(params, count, sizeof(params[0]), compare_params);
+
+    size_t len = (size_t)(q - url) + 1;
+    if (len >= out_len) len = out_len - 1;
+    memcpy(out, url, len);
+    out[len] = '\0';
+    for (int i = 0; i < count && len < out_len; i++) {
+        len += snprintf(out + len, out_len - len, "%s%s", i ? "&" : "", params[i]);
+    }
+}
+
+// FNV-1a, 64-bit.
+static uint64_t hash_key(const char *key) {
+    uint64_t h = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static void entry_path(const char *key, char *path, size_t path_len) {
+    snprintf(path, path_len, "%s/%016llx" CACHE_SUFFIX, cache_dir,
+             (unsigned long long)hash_key(key));
+}
+
+FILE *cache_open(const char *url) {
+    if (cache_disabled || cache_dir[0] == '\0') return NULL;
+
+    char key[CACHE_URL_LEN], path[CACHE_PATH_LEN];
+    normalize_url(url, key, sizeof(key));
+    entry_path(key, path, sizeof(path));
+
+    struct stat st;
+    if (stat(path, &st) != 0) return NULL;
+    if (cache_ttl > 0 && difftime(time(NULL), st.st_mtime) > cache_ttl) {
+        unlink(path);
+        return NULL;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+
+    // First line is the full key; a mismatch means a hash collision.
+    size_t key_len = strlen(key);
+    char *stored_key = malloc(key_len + 2);
+    int ok = stored_key && fgets(stored_key, (int)key_len + 2, f) &&
+             strncmp(stored_key, key, key_len) == 0 && stored_key[key_len] == '\n';
+    free(stored_key);
+    if (!ok) { fclose(f); return NULL; }
+    return f;
+}
+
+int cache_writer_open(struct CacheWriter *writer, const char *url) {
+    writer->file = NULL;
+    if (cache_disabled || cache_dir[0] == '\0') return -1;
+
+    char key[CACHE_URL_LEN];
+    normalize_url(url, key, sizeof(key));
+    entry_path(key, writer->path, sizeof(writer->path));
+    snprintf(writer->tmp_path, sizeof(writer->tmp_path), "%s.%ld.tmp", writer->path, (long)getpid());
+
+    // Write to a temporary file and rename so readers never see a partial entry.
+    writer->file = fopen(writer->tmp_path, "wb");
+    if (!writer->file) return -1;
+    if (fprintf(writer->file, "%s\n", key) < 0) {
+        cache_writer_abort(writer);
+        return -1;
+    }
+    return 0;
+}
+
+int cache_writer_write(struct CacheWriter *writer, const void *data, size_t size) {
+    if (!writer->file) return -1;
+    return fwrite(data, 1, size, writer->file) == size ? 0 : -1;
+}
+
+int cache_writer_commit(struct CacheWriter *writer) {
+    if (!writer->file) return -1;
+    int ok = fclose(writer->file) == 0;
+    writer->file = NULL;
+    if (!ok || rename(writer->tmp_path, writer->path) != 0) {
+        unlink(writer->tmp_path);
+        return -1;
+    }
+    return 0;
+}
+
+void cache_writer_abort(struct CacheWriter *writer) {
+    if (!writer->file) return;
+    fclose(writer->file);
+    writer->file = NULL;
+    unlink(writer->tmp_path);
+}
+
+int cache_invalidate(const char *url) {
+    if (cache_dir[0] == '\0') return 0;
+
+    char path[CACHE_PATH_LEN];
+    if (url) {
+        char key[CACHE_URL_LEN];
+        normalize_url(url, key, sizeof(key));
+        entry_path(key, path, sizeof(path));
+        return unlink(path) == 0 ? 1 : 0;
+    }
+
+    DIR *dir = opendir(cache_dir);
+    if (!dir) return 0;
+    int removed = 0;
+    size_t suffix_len = strlen(CACHE_SUFFIX);
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if (len <= suffix_len || strcmp(ent->d_name + len - suffix_len, CACHE_SUFFIX) != 0) continue;
+        snprintf(path, sizeof(path), "%s/%s", cache_dir, ent->d_name);
+        if (unlink(path) == 0) removed++;
+    }
+    closedir(dir);
+    return removed;
+}
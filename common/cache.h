@@ -0,0 +1,71 @@
+/**
+ * @file cache.h
+ * @brief On-disk, content-addressed cache for Horizons responses.
+ *
+ * Responses are stored under the cache directory in a file named after a
+ * hash of the normalized request URL (query parameters sorted), so the same
+ * (body, epoch, center, table) query is only ever fetched once. The first
+ * line of each entry holds the normalized URL and is checked on lookup.
+ *
+ * Configuration comes from the command line (see cache_parse_option) or the
+ * environment:
+ *   HORIZONS_CACHE_DIR  cache directory (default $XDG_CACHE_HOME/planetary_logger
+ *                       or ~/.cache/planetary_logger)
+ *   HORIZONS_CACHE_TTL  entry lifetime in seconds, 0 = never expire (default)
+ *   HORIZONS_OFFLINE    if set to 1, never touch the network
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define CACHE_PATH_LEN 1024
+
+// Struct to hold an entry being written incrementally while a response
+// streams in. Nothing is visible to readers until cache_writer_commit().
+struct CacheWriter {
+    FILE *file;
+    char path[CACHE_PATH_LEN];
+    char tmp_path[CACHE_PATH_LEN + 16];
+};
+
+// Consumes a cache option at argv[*index] if it is one of
+//   -offline            fail fast on a cache miss instead of fetching
+//   -no-cache           bypass the cache entirely
+//   -cache-dir DIR      use DIR as the cache directory
+//   -cache-ttl SECONDS  treat entries older than SECONDS as misses
+//   -cache-clear        remove every cached entry at startup
+// Returns 1 (advancing *index past any value) if consumed, 0 otherwise.
+int cache_parse_option(int argc, char *argv[], int *index);
+
+// Applies environment defaults, creates the cache directory and performs a
+// pending -cache-clear. Called by fetch_init(). Returns 0 on success.
+int cache_init(void);
+
+// Returns 1 if the network must not be used.
+int cache_offline(void);
+
+// Opens the fresh entry for `url` positioned at the start of the body, so
+// it can be read in pieces. Returns NULL on a miss.
+FILE *cache_open(const char *url);
+
+// Starts an incremental entry for `url`. Returns 0 on success; on failure
+// the writer is left inert and the other writer calls do nothing.
+int cache_writer_open(struct CacheWriter *writer, const char *url);
+
+// Appends body data. Returns 0 on success.
+int cache_writer_write(struct CacheWriter *writer, const void *data, size_t size);
+
+// Publishes the entry. Returns 0 on success.
+int cache_writer_commit(struct CacheWriter *writer);
+
+// Discards the entry (e.g. the response was incomplete).
+void cache_writer_abort(struct CacheWriter *writer);
+
+// Removes the entry for `url`, or every entry if `url` is NULL. Returns the
+// number of entries removed.
+int cache_invalidate(const char *url);
+
+#endif // CACHE_H
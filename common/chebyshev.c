@@ -0,0 +1,319 @@
+/**
+ * @file chebyshev.c
+ * @brief Chebyshev ephemeris fitting, writer and evaluator.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "chebyshev.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+#define CHEBYSHEV_ALIGN 64
+
+// --- Fitting ---
+
+void chebyshev_nodes(int n, double *nodes) {
+    for (int k = 0; k < n; k++) nodes[k] = cos(M_PI * (k + 0.5) / n);
+}
+
+void chebyshev_fit_nodes(const double *values, int n, double *coeffs) {
+    for (int j = 0; j < n; j++) {
+        double sum = 0;
+        for (int k = 0; k < n; k++) sum += values[k] * cos(M_PI * j * (k + 0.5) / n);
+        coeffs[j] = 2.0 * sum / n;
+    }
+    coeffs[0] *= 0.5;
+}
+
+int chebyshev_fit_points(const double *tau, const double *values, int num_points, int n, double *coeffs) {
+    if (n < 1 || n > CHEBYSHEV_MAX_COEFFS || num_points < n) return -1;
+
+    // Householder QR of the design matrix a[i][j] = T_j(tau_i), with the
+    // values carried along as an extra column.
+    int cols = n + 1;
+    double *a = malloc((size_t)num_points * cols * sizeof(double));
+    if (a == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    for (int i = 0; i < num_points; i++) {
+        double *row = a + (size_t)i * cols;
+        double t0 = 1.0, t1 = tau[i];
+        for (int j = 0; j < n; j++) {
+            row[j] = j == 0 ? t0 : t1;
+            if (j >= 1) {
+                double t2 = 2.0 * tau[i] * t1 - t0;
+                t0 = t1;
+                t1 = t2;
+            }
+        }
+        row[n] = values[i];
+    }
+
+    int status = 0;
+    for (int j = 0; j < n && status == 0; j++) {
+        double norm = 0;
+        for (int i = j; i < num_points; i++) norm += a[(size_t)i * cols + j] * a[(size_t)i * cols + j];
+        norm = sqrt(norm);
+        if (norm < 1e-12 * sqrt((double)num_points)) {
+            status = -1;   // Column j is (nearly) dependent on the ones before
+            break;
+        }
+        double diag = a[(size_t)j * cols + j];
+        double alpha = diag > 0 ? -norm : norm;
+        a[(size_t)j * cols + j] = diag - alpha;   // v = x - alpha e1, stored in place
+        double vnorm2 = norm * norm - diag * diag + (diag - alpha) * (diag - alpha);
+        for (int c = j + 1; c < cols; c++) {
+            double dot = 0;
+            for (int i = j; i < num_points; i++) dot += a[(size_t)i * cols + j] * a[(size_t)i * cols + c];
+            double f = 2.0 * dot / vnorm2;
+            for (int i = j; i < num_points; i++) a[(size_t)i * cols + c] -= f * a[(size_t)i * cols + j];
+        }
+        a[(size_t)j * cols + j] = alpha;   // R's diagonal
+    }
+
+    // Back-substitute R c = Q^T values.
+    for (int j = n - 1; j >= 0 && status == 0; j--) {
+        double sum = a[(size_t)j * cols + n];
+        for (int k = j + 1; k < n; k++) sum -= a[(size_t)j * cols + k] * coeffs[k];
+        coeffs[j] = sum / a[(size_t)j * cols + j];
+    }
+    free(a);
+    return status;
+}
+
+double chebyshev_value(const double *coeffs, int n, double tau) {
+    // Clenshaw's recurrence.
+    double b1 = 0, b2 = 0, twice = 2.0 * tau;
+    for (int j = n - 1; j >= 1; j--) {
+        double b0 = coeffs[j] + twice * b1 - b2;
+        b2 = b1;
+        b1 = b0;
+    }
+    return coeffs[0] + tau * b1 - b2;
+}
+
+// --- Header Encoding ---
+
+static void put_u32(unsigned char *p, uint32_t v) { memcpy(p, &v, 4); }
+static void put_i64(unsigned char *p, int64_t v) { memcpy(p, &v, 8); }
+static uint32_t get_u32(const unsigned char *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static int64_t get_i64(const unsigned char *p) { int64_t v; memcpy(&v, p, 8); return v; }
+
+static long data_offset_for(int num_bodies) {
+    long end = CHEBYSHEV_HEADER_LEN + (long)num_bodies * CHEBYSHEV_NAME_LEN;
+    return (end + CHEBYSHEV_ALIGN - 1) / CHEBYSHEV_ALIGN * CHEBYSHEV_ALIGN;
+}
+
+static size_t record_len(const struct ChebyshevInfo *info) {
+    return (size_t)info->num_bodies * 3 * info->num_coeffs;
+}
+
+static void encode_header(const struct ChebyshevInfo *info, unsigned char *h) {
+    memset(h, 0, CHEBYSHEV_HEADER_LEN);
+    memcpy(h, CHEBYSHEV_MAGIC, 8);
+    put_u32(h + 8, CHEBYSHEV_VERSION);
+    put_u32(h + 12, CHEBYSHEV_BYTE_ORDER);
+    put_u32(h + 16, (uint32_t)info->num_bodies);
+    put_u32(h + 20, (uint32_t)info->num_coeffs);
+    put_i64(h + 24, (int64_t)info->num_segments);
+    put_i64(h + 32, info->start_unix);
+    put_i64(h + 40, info->segment_seconds);
+    put_i64(h + 48, info->end_unix);
+    put_u32(h + 56, (uint32_t)info->centre);
+    put_u32(h + 60, (uint32_t)info->data_offset);
+}
+
+static int decode_header(struct ChebyshevInfo *info, const unsigned char *h, const char *path) {
+    if (memcmp(h, CHEBYSHEV_MAGIC, 8) != 0) {
+        fprintf(stderr, "Error: %s is not a Chebyshev ephemeris.\n", path);
+        return -1;
+    }
+    if (get_u32(h + 12) != CHEBYSHEV_BYTE_ORDER) {
+        fprintf(stderr, "Error: %s was written on a machine with a different byte order.\n", path);
+        return -1;
+    }
+    if (get_u32(h + 8) != CHEBYSHEV_VERSION) {
+        fprintf(stderr, "Error: %s uses Chebyshev format version %u; this build reads version %d.\n",
+                path, get_u32(h + 8), CHEBYSHEV_VERSION);
+        return -1;
+    }
+    info->num_bodies = (int)get_u32(h + 16);
+    info->num_coeffs = (int)get_u32(h + 20);
+    info->num_segments = (long)get_i64(h + 24);
+    info->start_unix = get_i64(h + 32);
+    info->segment_seconds = get_i64(h + 40);
+    info->end_unix = get_i64(h + 48);
+    info->centre = (int)get_u32(h + 56);
+    info->data_offset = (long)get_u32(h + 60);
+    if (info->num_bodies < 1 || info->num_bodies > CHEBYSHEV_MAX_BODIES ||
+        info->num_coeffs < 1 || info->num_coeffs > CHEBYSHEV_MAX_COEFFS ||
+        info->num_segments < 1 || info->segment_seconds < 1 ||
+        info->end_unix < info->start_unix ||
+        info->end_unix > info->start_unix + info->num_segments * info->segment_seconds ||
+        info->data_offset < CHEBYSHEV_HEADER_LEN + (long)info->num_bodies * CHEBYSHEV_NAME_LEN) {
+        fprintf(stderr, "Error: %s has a corrupt Chebyshev header.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// --- Writer ---
+
+int chebyshev_writer_open(struct ChebyshevWriter *writer, const char *path,
+                          const char *const names[], int num_bodies, int num_coeffs, int centre,
+                          long num_segments, int64_t start_unix, int64_t segment_seconds, int64_t end_unix) {
+    if (num_bodies < 1 || num_bodies > CHEBYSHEV_MAX_BODIES || num_coeffs < 1 ||
+        num_coeffs > CHEBYSHEV_MAX_COEFFS || num_segments < 1 || segment_seconds < 1) {
+        fprintf(stderr, "Error: Unsupported Chebyshev layout.\n");
+        return -1;
+    }
+    struct ChebyshevInfo *info = &writer->info;
+    memset(info, 0, sizeof(*info));
+    info->num_bodies = num_bodies;
+    for (int i = 0; i < num_bodies; i++) {
+        snprintf(info->names[i], CHEBYSHEV_NAME_LEN, "%s", names[i]);
+    }
+    info->num_coeffs = num_coeffs;
+    info->num_segments = num_segments;
+    info->start_unix = start_unix;
+    info->segment_seconds = segment_seconds;
+    info->end_unix = end_unix;
+    info->centre = centre;
+    info->data_offset = data_offset_for(num_bodies);
+    writer->segments_written = 0;
+
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        perror("Error opening output file");
+        return -1;
+    }
+    unsigned char header[CHEBYSHEV_HEADER_LEN];
+    encode_header(info, header);
+    fwrite(header, 1, sizeof(header), writer->file);
+    fwrite(info->names, CHEBYSHEV_NAME_LEN, num_bodies, writer->file);
+    long pad = info->data_offset - (CHEBYSHEV_HEADER_LEN + (long)num_bodies * CHEBYSHEV_NAME_LEN);
+    static const char zeros[CHEBYSHEV_ALIGN];
+    fwrite(zeros, 1, (size_t)pad, writer->file);
+    return ferror(writer->file) ? -1 : 0;
+}
+
+int chebyshev_writer_put(struct ChebyshevWriter *writer, const double *record) {
+    if (writer->segments_written >= writer->info.num_segments) return -1;
+    size_t n = record_len(&writer->info);
+    if (fwrite(record, sizeof(double), n, writer->file) != n) {
+        perror("Error writing output file");
+        return -1;
+    }
+    writer->segments_written++;
+    return 0;
+}
+
+int chebyshev_writer_close(struct ChebyshevWriter *writer) {
+    if (writer->file == NULL) return -1;
+    int status = ferror(writer->file) ? -1 : 0;
+    if (writer->segments_written != writer->info.num_segments) {
+        fprintf(stderr, "Error: Chebyshev file has %ld of %ld segments.\n",
+                writer->segments_written, writer->info.num_segments);
+        status = -1;
+    }
+    if (fclose(writer->file) != 0) status = -1;
+    writer->file = NULL;
+    return status;
+}
+
+// --- Reader ---
+
+int chebyshev_open(struct ChebyshevFile *file, const char *path) {
+    memset(file, 0, sizeof(*file));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening input file");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < CHEBYSHEV_HEADER_LEN) {
+        fprintf(stderr, "Error: %s is truncated or unreadable.\n", path);
+        close(fd);
+        return -1;
+    }
+    file->map_len = (size_t)st.st_size;
+    void *map = mmap(NULL, file->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error mapping input file");
+        file->map_len = 0;
+        return -1;
+    }
+    file->map = map;
+
+    struct ChebyshevInfo *info = &file->info;
+    if (decode_header(info, file->map, path) != 0) {
+        chebyshev_close(file);
+        return -1;
+    }
+    size_t needed = (size_t)info->data_offset + (size_t)info->num_segments * record_len(info) * sizeof(double);
+    if (file->map_len < needed) {
+        fprintf(stderr, "Error: %s is truncated.\n", path);
+        chebyshev_close(file);
+        return -1;
+    }
+    for (int i = 0; i < info->num_bodies; i++) {
+        memcpy(info->names[i], file->map + CHEBYSHEV_HEADER_LEN + (size_t)i * CHEBYSHEV_NAME_LEN, CHEBYSHEV_NAME_LEN);
+        info->names[i][CHEBYSHEV_NAME_LEN - 1] = '\0';
+    }
+    file->records = (const double *)(file->map + info->data_offset);
+    return 0;
+}
+
+void chebyshev_close(struct ChebyshevFile *file) {
+    if (file->map) munmap((void *)file->map, file->map_len);
+    memset(file, 0, sizeof(*file));
+}
+
+int chebyshev_find_body(const struct ChebyshevFile *file, const char *name) {
+    for (int i = 0; i < file->info.num_bodies; i++) {
+        if (strcmp(file->info.names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+// Finds the record covering `t_unix` and the time's position in it.
+static const double *locate(const struct ChebyshevFile *file, double t_unix, double *tau) {
+    const struct ChebyshevInfo *info = &file->info;
+    double offset = t_unix - (double)info->start_unix;
+    if (offset < 0 || t_unix > (double)info->end_unix) return NULL;
+    double span = (double)info->segment_seconds;
+    long segment = (long)(offset / span);
+    if (segment >= info->num_segments) segment = info->num_segments - 1;
+    *tau = 2.0 * (offset - segment * span) / span - 1.0;
+    return file->records + (size_t)segment * record_len(info);
+}
+
+int chebyshev_position(const struct ChebyshevFile *file, int body, double t_unix, double position[3]) {
+    double tau;
+    const double *record = locate(file, t_unix, &tau);
+    if (record == NULL || body < 0 || body >= file->info.num_bodies) return -1;
+    int n = file->info.num_coeffs;
+    const double *series = record + (size_t)body * 3 * n;
+    for (int axis = 0; axis < 3; axis++) position[axis] = chebyshev_value(series + axis * n, n, tau);
+    return 0;
+}
+
+int chebyshev_positions(const struct ChebyshevFile *file, double t_unix, double *xyz) {
+    double tau;
+    const double *record = locate(file, t_unix, &tau);
+    if (record == NULL) return -1;
+    int n = file->info.num_coeffs;
+    for (int s = 0; s < 3 * file->info.num_bodies; s++) xyz[s] = chebyshev_value(record + (size_t)s * n, n, tau);
+    return 0;
+}
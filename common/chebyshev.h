@@ -0,0 +1,136 @@
+/**
+ * @file chebyshev.h
+ * @brief Chebyshev-polynomial ephemeris segments (a JPL-DE-style file).
+ *
+ * Instead of positions sampled at a fixed step, the file stores, for each
+ * time segment and body, the coefficients of a Chebyshev series per axis.
+ * A position at any time inside the file's span is one segment lookup and
+ * a Clenshaw recurrence, so sub-daily times cost no extra storage. A few
+ * coefficients per axis and segment also take less space than a daily
+ * table.
+ *
+ * The file starts with a fixed 64-byte header:
+ *
+ *   offset  size  field
+ *        0     8  magic "PLCHEBY\n"
+ *        8     4  format version (CHEBYSHEV_VERSION)
+ *       12     4  byte-order mark 0x01020304, written in host order
+ *       16     4  number of bodies
+ *       20     4  coefficients per axis and segment
+ *       24     8  number of segments
+ *       32     8  start of segment 0, Unix seconds
+ *       40     8  segment length, seconds
+ *       48     8  end of the fitted span, Unix seconds
+ *       56     4  Horizons ID of the centre body (10 = Sun, 399 = Earth)
+ *       60     4  offset of the first segment from the start of the file
+ *
+ * It is followed by one CHEBYSHEV_NAME_LEN byte, NUL-padded name per body.
+ * The segments then start on a 64-byte boundary. Each segment is one
+ * record of float64 coefficients, body by body: the x series, then y, then
+ * z. So every body at one time is read from a single contiguous record.
+ * Positions are ecliptic coordinates in AU relative to the centre body.
+ *
+ * Files are written a segment at a time, in order, from positions at the
+ * Chebyshev nodes of each segment (exact interpolation, e.g. from the Kepler
+ * propagator) or from positions sampled at any times in it (a least-squares
+ * fit, e.g. to daily Horizons vectors).
+ */
+
+#ifndef CHEBYSHEV_H
+#define CHEBYSHEV_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHEBYSHEV_MAGIC "PLCHEBY\n"
+#define CHEBYSHEV_VERSION 1
+#define CHEBYSHEV_BYTE_ORDER 0x01020304u
+#define CHEBYSHEV_HEADER_LEN 64
+#define CHEBYSHEV_NAME_LEN 32
+#define CHEBYSHEV_MAX_BODIES 64
+#define CHEBYSHEV_MAX_COEFFS 32
+#define CHEBYSHEV_CENTRE_SUN 10
+#define CHEBYSHEV_CENTRE_EARTH 399
+
+// Everything the header describes.
+struct ChebyshevInfo {
+    int num_bodies;
+    char names[CHEBYSHEV_MAX_BODIES][CHEBYSHEV_NAME_LEN];
+    int num_coeffs;
+    long num_segments;
+    int64_t start_unix;
+    int64_t segment_seconds;
+    int64_t end_unix;
+    int centre;
+    long data_offset;
+};
+
+// File being written, one segment after another.
+struct ChebyshevWriter {
+    FILE *file;
+    struct ChebyshevInfo info;
+    long segments_written;
+};
+
+// Mapped file being read.
+struct ChebyshevFile {
+    struct ChebyshevInfo info;
+    const unsigned char *map;
+    size_t map_len;
+    const double *records;   // num_segments records of num_bodies * 3 * num_coeffs
+};
+
+// --- Fitting ---
+
+// Stores the `n` Chebyshev nodes in (-1, 1), largest first: cos(pi (k + 1/2) / n).
+void chebyshev_nodes(int n, double *nodes);
+
+// Fits the `n` coefficients of the series through `values` taken at the
+// chebyshev_nodes(n) positions. The fit is exact at the nodes.
+void chebyshev_fit_nodes(const double *values, int n, double *coeffs);
+
+// Least-squares fit of `n` coefficients to `num_points` values taken at
+// `tau` in [-1, 1]. Returns 0, or -1 if the points cannot determine the
+// series (fewer than `n` distinct points).
+int chebyshev_fit_points(const double *tau, const double *values, int num_points, int n, double *coeffs);
+
+// Evaluates a series of `n` coefficients at `tau` in [-1, 1].
+double chebyshev_value(const double *coeffs, int n, double tau);
+
+// --- Writer ---
+
+// Creates `path` for `num_segments` segments of `segment_seconds`, starting
+// at `start_unix` and fitted up to `end_unix`. Returns 0 on success.
+int chebyshev_writer_open(struct ChebyshevWriter *writer, const char *path,
+                          const char *const names[], int num_bodies, int num_coeffs, int centre,
+                          long num_segments, int64_t start_unix, int64_t segment_seconds, int64_t end_unix);
+
+// Appends the next segment: num_bodies * 3 * num_coeffs coefficients laid
+// out as in the file. Returns 0 on success.
+int chebyshev_writer_put(struct ChebyshevWriter *writer, const double *record);
+
+// Finishes and closes the file; fails if segments are missing. Returns 0 on
+// success.
+int chebyshev_writer_close(struct ChebyshevWriter *writer);
+
+// --- Reader ---
+
+// Maps and validates `path`. Returns 0, or -1 with a message on stderr.
+int chebyshev_open(struct ChebyshevFile *file, const char *path);
+
+// Unmaps the file.
+void chebyshev_close(struct ChebyshevFile *file);
+
+// Returns the body's index, or -1 if the file has no body of that name.
+int chebyshev_find_body(const struct ChebyshevFile *file, const char *name);
+
+// Evaluates the position (AU) of `body` at `t_unix` (Unix seconds, any
+// fraction). Returns 0, or -1 if the time is outside the fitted span.
+int chebyshev_position(const struct ChebyshevFile *file, int body, double t_unix, double position[3]);
+
+// Evaluates every body at `t_unix` into xyz[3 * body + axis], reading a
+// single record. Returns 0, or -1 if the time is outside the fitted span.
+int chebyshev_positions(const struct ChebyshevFile *file, double t_unix, double *xyz);
+
+#endif // CHEBYSHEV_H
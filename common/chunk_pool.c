@@ -0,0 +1,201 @@
+/**
+ * @file chunk_pool.c
+ * @brief Ordered parallel chunk executor implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "chunk_pool.h"
+
+#define CHUNK_BUFFER_MIN 65536
+#define SLOTS_PER_THREAD 2
+
+enum SlotState { SLOT_FREE, SLOT_BUSY, SLOT_DONE };
+
+// One chunk's output on its way from a worker to the caller.
+struct ChunkSlot {
+    struct ChunkBuffer buffer;
+    enum SlotState state;
+    int failed;
+};
+
+// State shared by the workers and the emitting thread, guarded by `lock`.
+struct ChunkPool {
+    pthread_mutex_t lock;
+    pthread_cond_t slot_freed;   // Signalled when the caller releases a slot
+    pthread_cond_t slot_done;    // Signalled when a worker finishes a chunk
+    struct ChunkSlot *slots;
+    int num_slots;
+    long next_chunk;
+    long num_chunks;
+    int abort;
+    chunk_work_fn work;
+    void *userp;
+};
+
+struct ChunkWorker {
+    struct ChunkPool *pool;
+    int index;
+    pthread_t thread;
+};
+
+char *chunk_buffer_reserve(struct ChunkBuffer *buffer, size_t n) {
+    if (buffer->cap - buffer->len < n) {
+        size_t cap = buffer->cap ? buffer->cap * 2 : CHUNK_BUFFER_MIN;
+        while (cap - buffer->len < n) cap *= 2;
+        char *data = realloc(buffer->data, cap);
+        if (data == NULL) return NULL;
+        buffer->data = data;
+        buffer->cap = cap;
+    }
+    return buffer->data + buffer->len;
+}
+
+int chunk_buffer_write(struct ChunkBuffer *buffer, const void *data, size_t n) {
+    if (n == 0) return 0;
+    char *at = chunk_buffer_reserve(buffer, n);
+    if (at == NULL) return -1;
+    memcpy(at, data, n);
+    buffer->len += n;
+    return 0;
+}
+
+int chunk_buffer_printf(struct ChunkBuffer *buffer, const char *format, ...) {
+    for (;;) {
+        size_t room = buffer->cap - buffer->len;
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buffer->data ? buffer->data + buffer->len : NULL, room, format, args);
+        va_end(args);
+        if (n < 0) return -1;
+        if ((size_t)n < room) {
+            buffer->len += n;
+            return 0;
+        }
+        if (chunk_buffer_reserve(buffer, (size_t)n + 1) == NULL) return -1;
+    }
+}
+
+// Worker loop: claim the next chunk once its slot is free, produce it, repeat.
+static void *chunk_worker_main(void *arg) {
+    struct ChunkWorker *worker = (struct ChunkWorker *)arg;
+    struct ChunkPool *pool = worker->pool;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->abort && pool->next_chunk < pool->num_chunks &&
+               pool->slots[pool->next_chunk % pool->num_slots].state != SLOT_FREE) {
+            pthread_cond_wait(&pool->slot_freed, &pool->lock);
+        }
+        if (pool->abort || pool->next_chunk >= pool->num_chunks) break;
+
+        long chunk = pool->next_chunk++;
+        struct ChunkSlot *slot = &pool->slots[chunk % pool->num_slots];
+        slot->state = SLOT_BUSY;
+        slot->buffer.len = 0;
+        pthread_mutex_unlock(&pool->lock);
+
+        int rc = pool->work(chunk, worker->index, &slot->buffer, pool->userp);
+
+        pthread_mutex_lock(&pool->lock);
+        slot->failed = (rc != 0);
+        slot->state = SLOT_DONE;
+        pthread_cond_broadcast(&pool->slot_done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// Runs every chunk on the calling thread.
+static int chunk_run_inline(long num_chunks, chunk_work_fn work, chunk_emit_fn emit, void *userp) {
+    struct ChunkBuffer buffer = {0};
+    int status = 0;
+    for (long chunk = 0; chunk < num_chunks; chunk++) {
+        buffer.len = 0;
+        if (work(chunk, 0, &buffer, userp) != 0 || emit(chunk, &buffer, userp) != 0) {
+            status = -1;
+            break;
+        }
+    }
+    free(buffer.data);
+    return status;
+}
+
+int chunk_pool_run(long num_chunks, int num_threads, chunk_work_fn work, chunk_emit_fn emit,
+                   void *userp) {
+    if (num_threads > CHUNK_POOL_MAX_THREADS) num_threads = CHUNK_POOL_MAX_THREADS;
+    if (num_threads > num_chunks) num_threads = (int)num_chunks;
+    if (num_threads <= 1) return chunk_run_inline(num_chunks, work, emit, userp);
+
+    struct ChunkPool pool = {0};
+    struct ChunkWorker workers[CHUNK_POOL_MAX_THREADS];
+    pool.num_slots = num_threads * SLOTS_PER_THREAD;
+    pool.slots = calloc(pool.num_slots, sizeof(struct ChunkSlot));
+    if (pool.slots == NULL) return -1;
+    pool.num_chunks = num_chunks;
+    pool.work = work;
+    pool.userp = userp;
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.slot_freed, NULL);
+    pthread_cond_init(&pool.slot_done, NULL);
+
+    int started = 0;
+    for (; started < num_threads; started++) {
+        workers[started].pool = &pool;
+        workers[started].index = started;
+        if (pthread_create(&workers[started].thread, NULL, chunk_worker_main, &workers[started]) != 0) break;
+    }
+
+    int status = (started > 0) ? 0 : -1;
+    if (started == 0) fprintf(stderr, "Error: Could not start worker threads.\n");
+
+    // Emit chunks in order as their slots complete, then hand the slot back.
+    for (long chunk = 0; status == 0 && chunk < num_chunks; chunk++) {
+        struct ChunkSlot *slot = &pool.slots[chunk % pool.num_slots];
+        pthread_mutex_lock(&pool.lock);
+        while (slot->state != SLOT_DONE) pthread_cond_wait(&pool.slot_done, &pool.lock);
+        pthread_mutex_unlock(&pool.lock);
+
+        if (slot->failed || emit(chunk, &slot->buffer, userp) != 0) status = -1;
+
+        pthread_mutex_lock(&pool.lock);
+        slot->state = SLOT_FREE;
+        if (status != 0) pool.abort = 1;
+        pthread_cond_broadcast(&pool.slot_freed);
+        pthread_mutex_unlock(&pool.lock);
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    pool.abort = 1;
+    pthread_cond_broadcast(&pool.slot_freed);
+    pthread_mutex_unlock(&pool.lock);
+    for (int i = 0; i < started; i++) pthread_join(workers[i].thread, NULL);
+
+    for (int i = 0; i < pool.num_slots; i++) free(pool.slots[i].buffer.data);
+    free(pool.slots);
+    pthread_cond_destroy(&pool.slot_done);
+    pthread_cond_destroy(&pool.slot_freed);
+    pthread_mutex_destroy(&pool.lock);
+    return status;
+}
+
+int chunk_pool_default_threads(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) return 1;
+    if (cpus > CHUNK_POOL_MAX_THREADS) return CHUNK_POOL_MAX_THREADS;
+    return (int)cpus;
+}
+
+int chunk_pool_parse_option(int argc, char *argv[], int *index, int *num_threads) {
+    if (strcmp(argv[*index], "-threads") != 0 || *index + 1 >= argc) return 0;
+    int n = atoi(argv[++(*index)]);
+    if (n <= 0) n = chunk_pool_default_threads();
+    if (n > CHUNK_POOL_MAX_THREADS) n = CHUNK_POOL_MAX_THREADS;
+    *num_threads = n;
+    return 1;
+}
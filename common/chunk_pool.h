@@ -0,0 +1,63 @@
+/**
+ * @file chunk_pool.h
+ * @brief Ordered parallel chunk executor.
+ *
+ * Splits a job into numbered chunks that worker threads produce in any
+ * order, while the calling thread consumes the results strictly in chunk
+ * order. Each chunk formats its output into its own ChunkBuffer, so a
+ * parallel run writes exactly the same bytes as a serial one.
+ *
+ * At most twice as many chunks as there are threads are in flight, so memory
+ * stays bounded however long the job is. With one thread no threads are
+ * started and the chunks run inline on the caller's thread.
+ */
+
+#ifndef CHUNK_POOL_H
+#define CHUNK_POOL_H
+
+#include <stddef.h>
+
+#define CHUNK_POOL_MAX_THREADS 64
+
+// Growable text buffer a chunk writes its output into.
+struct ChunkBuffer {
+    char *data;
+    size_t len;
+    size_t cap;
+};
+
+// Returns a pointer to at least `n` free bytes at the end of the buffer, or
+// NULL if out of memory. Write into it, then advance `len` past the text.
+char *chunk_buffer_reserve(struct ChunkBuffer *buffer, size_t n);
+
+// Appends `n` bytes, e.g. a binary record. Returns 0, or -1 if out of memory.
+int chunk_buffer_write(struct ChunkBuffer *buffer, const void *data, size_t n);
+
+// Appends printf-style text to the buffer. Returns 0, or -1 if out of memory.
+int chunk_buffer_printf(struct ChunkBuffer *buffer, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// Produces chunk `chunk` into `out`, which arrives empty. `worker` is in
+// [0, num_threads) and is stable per thread, so callers can keep per-worker
+// scratch space. Runs on a worker thread; return non-zero to abort the job.
+typedef int (*chunk_work_fn)(long chunk, int worker, struct ChunkBuffer *out, void *userp);
+
+// Consumes a finished chunk. Called on the caller's thread in chunk order;
+// return non-zero to abort the job.
+typedef int (*chunk_emit_fn)(long chunk, const struct ChunkBuffer *out, void *userp);
+
+// Runs chunks [0, num_chunks) on `num_threads` workers. Returns 0 once every
+// chunk has been emitted, or -1 if a callback failed or threads could not
+// be started.
+int chunk_pool_run(long num_chunks, int num_threads, chunk_work_fn work, chunk_emit_fn emit,
+                   void *userp);
+
+// Returns the number of online CPUs, clamped to [1, CHUNK_POOL_MAX_THREADS].
+int chunk_pool_default_threads(void);
+
+// Parses a "-threads N" option at argv[*index]. N = 0 selects
+// chunk_pool_default_threads(). Returns 1 and advances *index if the
+// option was consumed, otherwise 0.
+int chunk_pool_parse_option(int argc, char *argv[], int *index, int *num_threads);
+
+#endif // CHUNK_POOL_H
@@ -0,0 +1,190 @@
+/**
+ * @file chunk_scan.c
+ * @brief Parallel detector run implementation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chunk_scan.h"
+
+enum LanePhase { LANE_LEAD_IN, LANE_OWNED, LANE_RUN_ON, LANE_DONE };
+
+struct ChunkScanJob {
+    const struct ChunkScanDetector *detectors;
+    int num_detectors;
+    int num_lanes;       // Across every detector
+    long num_rows;
+    long chunk_rows;
+};
+
+// One lane's progress through its chunk.
+struct LaneCursor {
+    const struct ChunkScanDetector *detector;
+    void *scan;
+    int lane;
+    long row;            // Next row to feed
+    enum LanePhase phase;
+    struct ChunkBuffer *out;
+};
+
+// Feeds a lane the rows it needs below `limit`. The lane owns the rows from
+// its first quiet row at or after `begin` (row 0 for the first chunk) to
+// its first quiet row at or after `end`, or to the end of the data. It is
+// fed from `lead` rows before `begin`, so its state is settled by the time
+// either hand-over is checked.
+static int advance_lane(struct LaneCursor *cursor, long begin, long end, long limit, long num_rows) {
+    const struct ChunkScanDetector *detector = cursor->detector;
+    void *scan = cursor->scan, *userp = detector->userp;
+    int lane = cursor->lane;
+
+    if (cursor->phase == LANE_LEAD_IN) {
+        // The chunk before owns everything up to the hand-over.
+        while (cursor->row < limit && !(cursor->row >= begin && detector->quiet(scan, lane, userp))) {
+            if (detector->feed(scan, lane, cursor->row, 1, 0, cursor->out, userp) != 0) return -1;
+            cursor->row++;
+        }
+        if (cursor->row == limit) {
+            if (limit == num_rows) cursor->phase = LANE_DONE;
+            return 0;
+        }
+        cursor->phase = LANE_OWNED;
+    }
+    if (cursor->phase == LANE_OWNED) {
+        long stop = end < limit ? end : limit;
+        if (cursor->row < stop) {
+            if (detector->feed(scan, lane, cursor->row, stop - cursor->row, 1, cursor->out, userp) != 0) return -1;
+            cursor->row = stop;
+        }
+        if (cursor->row < end) return 0;
+        cursor->phase = LANE_RUN_ON;
+    }
+    if (cursor->phase == LANE_RUN_ON) {
+        // Run on until the next chunk can take over.
+        while (cursor->row < limit && !detector->quiet(scan, lane, userp)) {
+            if (detector->feed(scan, lane, cursor->row, 1, 1, cursor->out, userp) != 0) return -1;
+            cursor->row++;
+        }
+        if (cursor->row < limit) {
+            cursor->phase = LANE_DONE;
+        } else if (limit == num_rows) {
+            cursor->phase = LANE_DONE;
+            return detector->finish(scan, lane, cursor->out, userp);
+        }
+    }
+    return 0;
+}
+
+// Appends each detector's output to `out` as a size and that many bytes.
+static int pack_outputs(const struct ChunkBuffer *outputs, int num_detectors, struct ChunkBuffer *out) {
+    for (int d = 0; d < num_detectors; d++) {
+        size_t len = outputs[d].len;
+        if (chunk_buffer_write(out, &len, sizeof(len)) != 0 || chunk_buffer_write(out, outputs[d].data, len) != 0) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int scan_chunk(long chunk, int worker, struct ChunkBuffer *out, void *userp) {
+    (void)worker;
+    const struct ChunkScanJob *job = userp;
+    long begin = chunk * job->chunk_rows;
+    long end = begin + job->chunk_rows < job->num_rows ? begin + job->chunk_rows : job->num_rows;
+
+    void **scans = calloc((size_t)job->num_detectors, sizeof(*scans));
+    long *firsts = calloc((size_t)job->num_detectors, sizeof(*firsts));
+    struct ChunkBuffer *outputs = calloc((size_t)job->num_detectors, sizeof(*outputs));
+    struct LaneCursor *cursors = calloc(job->num_lanes > 0 ? (size_t)job->num_lanes : 1, sizeof(*cursors));
+    int64_t *spent = calloc((size_t)job->num_detectors, sizeof(*spent));   // -stats: ns per detector
+    int status = (scans && firsts && outputs && cursors && spent) ? 0 : -1;
+    if (status != 0) fprintf(stderr, "Error: Out of memory.\n");
+
+    int started = 0, num_cursors = 0;
+    for (; started < job->num_detectors && status == 0; started++) {
+        const struct ChunkScanDetector *detector = &job->detectors[started];
+        firsts[started] = begin > detector->lead ? begin - detector->lead : 0;
+        scans[started] = calloc(1, detector->scan_size);
+        if (scans[started] == NULL) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            status = -1;
+            break;
+        }
+        int64_t start = STATS_START();
+        status = detector->start(scans[started], firsts[started], detector->userp);
+        if (stats_enabled) spent[started] += stats_now() - start;
+        for (int lane = 0; lane < detector->num_lanes; lane++) {
+            struct LaneCursor cursor = {detector, scans[started], lane, firsts[started],
+                                        begin > 0 ? LANE_LEAD_IN : LANE_OWNED, &outputs[started]};
+            cursors[num_cursors++] = cursor;
+        }
+    }
+
+    // Every lane takes each block in turn, until all of them are done.
+    long block = begin;
+    for (int d = 0; d < started; d++) {
+        if (firsts[d] < block) block = firsts[d];
+    }
+    for (int remaining = num_cursors; status == 0 && remaining > 0; block += CHUNK_SCAN_BLOCK_ROWS) {
+        long limit = block + CHUNK_SCAN_BLOCK_ROWS < job->num_rows ? block + CHUNK_SCAN_BLOCK_ROWS : job->num_rows;
+        remaining = 0;
+        for (int k = 0; k < num_cursors && status == 0; k++) {
+            if (cursors[k].phase == LANE_DONE) continue;
+            int64_t start = STATS_START();
+            status = advance_lane(&cursors[k], begin, end, limit, job->num_rows);
+            if (stats_enabled) spent[cursors[k].detector - job->detectors] += stats_now() - start;
+            if (cursors[k].phase != LANE_DONE) remaining++;
+        }
+    }
+
+    for (int d = 0; d < started; d++) {
+        const struct ChunkScanDetector *detector = &job->detectors[d];
+        int64_t start = STATS_START();
+        if (scans[d] && detector->stop(scans[d], status == 0 ? &outputs[d] : NULL, detector->userp) != 0) {
+            status = -1;
+        }
+        if (detector->stats) STATS_ADD(*detector->stats, spent[d] + (stats_now() - start));
+        free(scans[d]);
+    }
+    if (status == 0) status = pack_outputs(outputs, job->num_detectors, out);
+    for (int d = 0; outputs && d < job->num_detectors; d++) free(outputs[d].data);
+    free(spent);
+    free(cursors);
+    free(outputs);
+    free(firsts);
+    free(scans);
+    return status;
+}
+
+// Hands each detector its part of the chunk's output.
+static int emit_chunk(long chunk, const struct ChunkBuffer *out, void *userp) {
+    const struct ChunkScanJob *job = userp;
+    size_t at = 0;
+    for (int d = 0; d < job->num_detectors; d++) {
+        const struct ChunkScanDetector *detector = &job->detectors[d];
+        size_t len;
+        memcpy(&len, out->data + at, sizeof(len));
+        at += sizeof(len);
+        struct ChunkBuffer part = {out->data + at, len, len};
+        at += len;
+        if (detector->merge(chunk, &part, detector->userp) != 0) return -1;
+    }
+    return 0;
+}
+
+long chunk_scan_rows(long num_rows, int num_threads) {
+    if (num_threads <= 1) return num_rows > 0 ? num_rows : 1;
+    long chunks = (long)num_threads * CHUNK_SCAN_CHUNKS_PER_THREAD;
+    long rows = (num_rows + chunks - 1) / chunks;
+    return rows < CHUNK_SCAN_MIN_ROWS ? CHUNK_SCAN_MIN_ROWS : rows;
+}
+
+int chunk_scan_run(const struct ChunkScanDetector *detectors, int num_detectors, long num_rows, long chunk_rows,
+                   int num_threads) {
+    if (chunk_rows < 1) chunk_rows = 1;
+    struct ChunkScanJob job = {detectors, num_detectors, 0, num_rows, chunk_rows};
+    for (int d = 0; d < num_detectors; d++) job.num_lanes += detectors[d].num_lanes;
+    long num_chunks = num_rows > 0 ? (num_rows + chunk_rows - 1) / chunk_rows : 1;
+    return chunk_pool_run(num_chunks, num_threads, scan_chunk, emit_chunk, &job);
+}
@@ -0,0 +1,95 @@
+/**
+ * @file chunk_scan.h
+ * @brief Parallel detector runs over chunks of rows.
+ *
+ * Splits the rows of a run into chunks and runs one or more detectors
+ * (alignment windows, aspect scans, closest approaches, ...) over each
+ * chunk on the chunk_pool workers. Each detector's results come back to its
+ * merge callback in chunk order (see chunk_pool.h), to be merged and sorted
+ * into date order.
+ *
+ * Within a chunk, rows are taken in blocks of CHUNK_SCAN_BLOCK_ROWS, and
+ * every lane of every detector consumes a block before the next one is
+ * touched. So however many detectors share a run, e.g. a whole report of
+ * queries, the rows are read from memory about once and each detector works
+ * on them while they are in cache.
+ *
+ * An event can span a chunk boundary, e.g. a window that opens just before
+ * it and closes after it. To keep such events whole, a detector is split
+ * into independent lanes (one per pair of bodies, say), and every lane
+ * hands over from one chunk to the next at a settled row. That is the
+ * first row, at or after the boundary, at which the lane is quiet: it has
+ * no open window, and it has been fed at least `lead` rows, so its state
+ * depends only on the rows just before it. Both chunks can find that row
+ * on their own. The earlier chunk runs on past its end until it gets
+ * there. The later chunk starts `lead` rows early and drops what it finds
+ * before it. Every event is therefore found by exactly one chunk, and the
+ * results match a single serial run, whatever the number of threads.
+ *
+ * A lane that is never quiet again (a window that never closes) leaves
+ * the rest of the run to the chunk that holds it, which is still correct,
+ * only less parallel.
+ */
+
+#ifndef CHUNK_SCAN_H
+#define CHUNK_SCAN_H
+
+#include <stddef.h>
+#include "chunk_pool.h"
+#include "stats.h"
+
+#define CHUNK_SCAN_MIN_ROWS 4096        // Smallest chunk worth a hand-over
+#define CHUNK_SCAN_CHUNKS_PER_THREAD 4  // Spare chunks to even out the load
+#define CHUNK_SCAN_BLOCK_ROWS 1024      // Rows every lane takes in turn: tens of KiB of columns
+
+// A detector the executor runs over chunks. Each chunk gets its own
+// `scan_size` bytes of zeroed scan state; the callbacks receive it along
+// with the detector's `userp`.
+struct ChunkScanDetector {
+    size_t scan_size;
+    int num_lanes;
+    int lead;      // Rows a lane must be fed before its state is settled
+
+    // Prepares a scan whose first row is `origin`. Returns 0, or -1 on
+    // failure (stop is still called).
+    int (*start)(void *scan, long origin, void *userp);
+
+    // Feeds rows [first, first + count) to a lane. Events it settles belong
+    // to this chunk if `keep` is set and are then written to `out`;
+    // otherwise they are dropped. Returns 0, or -1 on failure.
+    int (*feed)(void *scan, int lane, long first, long count, int keep, struct ChunkBuffer *out,
+                void *userp);
+
+    // Returns 1 if the lane has no open window.
+    int (*quiet)(const void *scan, int lane, void *userp);
+
+    // Marks the end of the data for a lane, writing its last events to
+    // `out`. Returns 0, or -1 on failure.
+    int (*finish)(void *scan, int lane, struct ChunkBuffer *out, void *userp);
+
+    // Ends the chunk: writes anything the scan still holds to `out` (unless
+    // `out` is NULL, after a failure) and releases it. Returns 0, or -1.
+    int (*stop)(void *scan, struct ChunkBuffer *out, void *userp);
+
+    // Consumes one chunk's output, on the caller's thread and in chunk
+    // order. Returns 0, or non-zero to abort the run.
+    chunk_emit_fn merge;
+
+    void *userp;
+
+    // Under -stats, receives the time spent in this detector's scan
+    // callbacks, once per chunk. May be NULL.
+    struct StatsEntry *stats;
+};
+
+// Returns the chunk length for `num_rows` rows on `num_threads` workers: the
+// whole run for one thread, otherwise a few chunks per thread.
+long chunk_scan_rows(long num_rows, int num_threads);
+
+// Runs the `num_detectors` detectors side by side over rows [0, num_rows),
+// in chunks of `chunk_rows` on `num_threads` workers. Returns 0, or -1 if a
+// callback failed.
+int chunk_scan_run(const struct ChunkScanDetector *detectors, int num_detectors, long num_rows, long chunk_rows,
+                   int num_threads);
+
+#endif // CHUNK_SCAN_H
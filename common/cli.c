@@ -0,0 +1,211 @@
+/**
+ * @file cli.c
+ * @brief Shared parameter handling implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include "cli.h"
+
+#define CONFIG_LINE_LEN 1024
+
+static FILE *data_stdout = NULL;   // The original stdout once claimed for data
+
+static int find_param(const struct CliParams *params, const char *name, size_t len) {
+    for (int i = 0; params->names[i] != NULL && i < CLI_MAX_PARAMS; i++) {
+        if (strlen(params->names[i]) == len && strncmp(params->names[i], name, len) == 0) return i;
+    }
+    return -1;
+}
+
+static int set_param(struct CliParams *params, int i, const char *value, int source) {
+    if (params->source[i] > source) return 0;   // The command line wins
+    if (strlen(value) >= CLI_VALUE_LEN) {
+        fprintf(stderr, "Error: Value for -%s is too long.\n", params->names[i]);
+        return -1;
+    }
+    strcpy(params->values[i], value);
+    params->source[i] = (unsigned char)source;
+    return 0;
+}
+
+void cli_init(struct CliParams *params, const char *const names[]) {
+    memset(params, 0, sizeof(*params));
+    params->names = names;
+}
+
+// --- Config Files ---
+
+// Reads "name = value" (or "name value") lines; '#' starts a comment.
+static int load_config(struct CliParams *params, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        perror("Error opening config file");
+        return -1;
+    }
+    char line[CONFIG_LINE_LEN];
+    int line_no = 0, status = 0;
+    while (status == 0 && fgets(line, sizeof(line), f)) {
+        line_no++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char *p = line;
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '\0') continue;
+
+        char *name = p;
+        while (*p && !isspace((unsigned char)*p) && *p != '=') p++;
+        size_t name_len = (size_t)(p - name);
+        while (isspace((unsigned char)*p) || *p == '=') p++;
+        char *value = p;
+        char *end = value + strlen(value);
+        while (end > value && isspace((unsigned char)end[-1])) end--;
+        *end = '\0';
+
+        int i = find_param(params, name, name_len);
+        if (i < 0) {
+            fprintf(stderr, "Error: %s:%d: unknown parameter '%.*s'.\n", path, line_no, (int)name_len, name);
+            status = -1;
+        } else if (*value == '\0') {
+            fprintf(stderr, "Error: %s:%d: '%s' has no value.\n", path, line_no, params->names[i]);
+            status = -1;
+        } else {
+            status = set_param(params, i, value, 1);
+        }
+    }
+    fclose(f);
+    return status;
+}
+
+// --- Command Line ---
+
+int cli_parse_option(int argc, char *argv[], int *index, struct CliParams *params) {
+    const char *arg = argv[*index];
+    if (arg[0] != '-') return 0;
+    if (strcmp(arg, "-batch") == 0) {
+        params->batch = 1;
+        return 1;
+    }
+    if (strcmp(arg, "-config") == 0) {
+        if (*index + 1 >= argc) {
+            fprintf(stderr, "Error: -config needs a file name.\n");
+            return -1;
+        }
+        return load_config(params, argv[++(*index)]) == 0 ? 1 : -1;
+    }
+    int i = find_param(params, arg + 1, strlen(arg + 1));
+    if (i < 0) return 0;
+    if (*index + 1 >= argc) {
+        fprintf(stderr, "Error: %s needs a value.\n", arg);
+        return -1;
+    }
+    return set_param(params, i, argv[++(*index)], 2) == 0 ? 1 : -1;
+}
+
+// Keeps the real stdout for data and sends everything else printed to
+// stdout (prompts, banners, progress) to stderr instead.
+static FILE *claim_stdout(void) {
+    if (data_stdout != NULL) return data_stdout;
+    fflush(stdout);
+    int fd = dup(STDOUT_FILENO);
+    if (fd < 0) return NULL;
+    if (dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        close(fd);
+        return NULL;
+    }
+    data_stdout = fdopen(fd, "w");
+    return data_stdout;
+}
+
+void cli_begin(struct CliParams *params) {
+    if (cli_is_stdio(cli_get(params, "output"))) claim_stdout();
+    if (cli_is_stdio(cli_get(params, "input"))) params->batch = 1;
+}
+
+const char *cli_get(const struct CliParams *params, const char *name) {
+    int i = find_param(params, name, strlen(name));
+    return (i >= 0 && params->source[i]) ? params->values[i] : NULL;
+}
+
+// --- Prompts ---
+
+int cli_prompt_string(struct CliParams *params, const char *name, const char *prompt, char *out, size_t len) {
+    const char *value = cli_get(params, name);
+    if (value != NULL) {
+        if (strlen(value) >= len) {
+            fprintf(stderr, "Error: Value for -%s is too long.\n", name);
+            return -1;
+        }
+        strcpy(out, value);
+        return 0;
+    }
+    if (params->batch) {
+        fprintf(stderr, "Error: -%s is required in batch mode.\n", name);
+        return -1;
+    }
+    printf("%s", prompt);
+    fflush(stdout);
+
+    // Reads a whole line, so answers such as "2000-01-01 12:00" keep their
+    // spaces. Blank lines (e.g. the rest of a menu choice) are skipped.
+    char line[CONFIG_LINE_LEN];
+    while (fgets(line, sizeof(line), stdin)) {
+        char *p = line, *end;
+        if (strchr(line, '\n') == NULL && !feof(stdin)) {
+            for (int c = getchar(); c != '\n' && c != EOF; c = getchar());
+            fprintf(stderr, "Error: Input for -%s is too long.\n", name);
+            return -1;
+        }
+        while (isspace((unsigned char)*p)) p++;
+        end = p + strlen(p);
+        while (end > p && isspace((unsigned char)end[-1])) end--;
+        if (end == p) continue;
+        if ((size_t)(end - p) >= len) {
+            fprintf(stderr, "Error: Input for -%s is too long.\n", name);
+            return -1;
+        }
+        memcpy(out, p, (size_t)(end - p));
+        out[end - p] = '\0';
+        return 0;
+    }
+    fprintf(stderr, "Error: Invalid input format.\n");
+    return -1;
+}
+
+int cli_prompt_int(struct CliParams *params, const char *name, const char *prompt, int *out) {
+    char text[64], *end;
+    if (cli_prompt_string(params, name, prompt, text, sizeof(text)) != 0) return -1;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0') {
+        fprintf(stderr, "Error: -%s expects a whole number, got '%s'.\n", name, text);
+        return -1;
+    }
+    *out = (int)value;
+    return 0;
+}
+
+int cli_prompt_double(struct CliParams *params, const char *name, const char *prompt, double *out) {
+    char text[64], *end;
+    if (cli_prompt_string(params, name, prompt, text, sizeof(text)) != 0) return -1;
+    double value = strtod(text, &end);
+    if (end == text || *end != '\0') {
+        fprintf(stderr, "Error: -%s expects a number, got '%s'.\n", name, text);
+        return -1;
+    }
+    *out = value;
+    return 0;
+}
+
+// --- Files ---
+
+int cli_is_stdio(const char *path) {
+    return path != NULL && strcmp(path, "-") == 0;
+}
+
+FILE *cli_open_output(const char *path, const char *mode) {
+    return cli_is_stdio(path) ? claim_stdout() : fopen(path, mode);
+}
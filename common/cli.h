@@ -0,0 +1,68 @@
+/**
+ * @file cli.h
+ * @brief Shared parameter handling for argv, config files and prompts.
+ *
+ * Every tool asks for its parameters with prompts. A parameter given on the
+ * command line as "-name value", or in a "-config FILE" of "name = value"
+ * lines, is used as-is and its prompt is skipped, so a run with all of its
+ * parameters supplied needs no terminal. Command-line values win over the
+ * config file whatever their order. "-batch" turns a missing parameter into
+ * an error instead of a prompt. An option no parser accepts is an error, so
+ * a misspelt name is not mistaken for a missing one.
+ *
+ * A file name of "-" means stdout for outputs and stdin for inputs, so a
+ * simulator can feed an analyser through a pipe:
+ *
+ *     kepler_sim_3d -start 2000-01-01 -end 2100-12-31 -output - |
+ *         multi_alignment_finder -input - -analysis aspects -threshold 2 -aspects major
+ *
+ * When stdout carries data, console text (banners, progress) is moved to
+ * stderr; when stdin carries data, batch mode is implied.
+ */
+
+#ifndef CLI_H
+#define CLI_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define CLI_MAX_PARAMS 16
+#define CLI_VALUE_LEN 256
+
+struct CliParams {
+    const char *const *names;                 // Parameters the tool accepts, NULL-terminated
+    char values[CLI_MAX_PARAMS][CLI_VALUE_LEN];
+    unsigned char source[CLI_MAX_PARAMS];     // 0 = unset, 1 = config file, 2 = command line
+    int batch;                                // Never prompt
+};
+
+// Sets up `params` for the NULL-terminated list of parameter names.
+void cli_init(struct CliParams *params, const char *const names[]);
+
+// Consumes argv[*index] if it is "-<name> value" for an accepted name,
+// "-config FILE" or "-batch". Returns 1 (advancing *index past any value) if
+// consumed, 0 if not, or -1 after reporting an error on stderr.
+int cli_parse_option(int argc, char *argv[], int *index, struct CliParams *params);
+
+// Finishes option parsing. If the "output" parameter is "-", console text is
+// moved to stderr now; if "input" is "-", batch mode is turned on.
+void cli_begin(struct CliParams *params);
+
+// Returns the value of `name`, or NULL if it was not given.
+const char *cli_get(const struct CliParams *params, const char *name);
+
+// Copies parameter `name` into `out` (`len` bytes), or prompts for it if it
+// was not given, reading a whole line with surrounding spaces trimmed. Returns 0, or -1 after reporting an error.
+int cli_prompt_string(struct CliParams *params, const char *name, const char *prompt, char *out, size_t len);
+
+// Numeric forms of cli_prompt_string; the whole value must parse.
+int cli_prompt_int(struct CliParams *params, const char *name, const char *prompt, int *out);
+int cli_prompt_double(struct CliParams *params, const char *name, const char *prompt, double *out);
+
+// Returns 1 if `path` names stdin/stdout ("-").
+int cli_is_stdio(const char *path);
+
+// Opens an output file, or the real stdout for "-" (see cli_begin).
+FILE *cli_open_output(const char *path, const char *mode);
+
+#endif // CLI_H
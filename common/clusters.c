@@ -0,0 +1,134 @@
+/**
+ * @file clusters.c
+ * @brief Circular longitude sweep implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "clusters.h"
+
+// SplitMix64 finaliser: spreads body indices over the full 64 bits so that
+// sums of member hashes identify member sets.
+static uint64_t mix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t finish_key(uint64_t sum, int count) {
+    return mix64(sum ^ ((uint64_t)count << 48));
+}
+
+static int compare_entries(const void *pa, const void *pb) {
+    const struct ClusterEntry *a = pa, *b = pb;
+    if (a->longitude != b->longitude) return a->longitude < b->longitude ? -1 : 1;
+    return a->body - b->body;
+}
+
+static int compare_doubles(const void *pa, const void *pb) {
+    double a = *(const double *)pa, b = *(const double *)pb;
+    return (a > b) - (a < b);
+}
+
+int cluster_sweep_init(struct ClusterSweep *sweep, int capacity) {
+    memset(sweep, 0, sizeof(*sweep));
+    size_t n = capacity > 0 ? (size_t)capacity : 1;
+    sweep->entries = malloc(n * sizeof(*sweep->entries));
+    sweep->order = malloc(2 * n * sizeof(*sweep->order));
+    sweep->sorted = malloc(2 * n * sizeof(*sweep->sorted));
+    sweep->reach = malloc(n * sizeof(*sweep->reach));
+    sweep->prefix = malloc((2 * n + 1) * sizeof(*sweep->prefix));
+    if (!sweep->entries || !sweep->order || !sweep->sorted || !sweep->reach || !sweep->prefix) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        cluster_sweep_free(sweep);
+        return -1;
+    }
+    sweep->capacity = capacity;
+    return 0;
+}
+
+void cluster_sweep_free(struct ClusterSweep *sweep) {
+    free(sweep->entries);
+    free(sweep->order);
+    free(sweep->sorted);
+    free(sweep->reach);
+    free(sweep->prefix);
+    memset(sweep, 0, sizeof(*sweep));
+}
+
+// Reports the cluster spanning sorted positions [first, last].
+static int emit(const struct ClusterSweep *sweep, int first, int last, cluster_fn fn, void *userp) {
+    struct Cluster cluster;
+    cluster.members = sweep->order + first;
+    cluster.count = last - first + 1;
+    cluster.start = sweep->sorted[first];
+    cluster.spread = sweep->sorted[last] - sweep->sorted[first];
+    cluster.key = finish_key(sweep->prefix[last + 1] - sweep->prefix[first], cluster.count);
+    return fn(&cluster, userp);
+}
+
+int cluster_sweep_run(struct ClusterSweep *sweep, const double *longitudes, int num_bodies,
+                      double width, int min_size, cluster_fn fn, void *userp) {
+    int n = num_bodies < sweep->capacity ? num_bodies : sweep->capacity;
+    if (n <= 0 || min_size > n) return 0;
+
+    // --- Sort Once, Then Unroll The Circle ---
+    for (int b = 0; b < n; b++) {
+        sweep->entries[b].longitude = longitudes[b];
+        sweep->entries[b].body = b;
+    }
+    qsort(sweep->entries, (size_t)n, sizeof(*sweep->entries), compare_entries);
+    sweep->prefix[0] = 0;
+    for (int k = 0; k < 2 * n; k++) {
+        const struct ClusterEntry *entry = &sweep->entries[k % n];
+        sweep->order[k] = entry->body;
+        sweep->sorted[k] = entry->longitude + (k >= n ? 360.0 : 0.0);
+        sweep->prefix[k + 1] = sweep->prefix[k] + mix64((uint64_t)entry->body);
+    }
+
+    // --- Two-Pointer Sweep ---
+    // reach[i] is the last position whose longitude is within `width` of
+    // position i, never lapping i itself.
+    int whole = -1;
+    for (int i = 0, j = 0; i < n; i++) {
+        if (j < i) j = i;
+        while (j + 1 < i + n && sweep->sorted[j + 1] - sweep->sorted[i] <= width) j++;
+        sweep->reach[i] = j;
+        if (j - i + 1 == n &&
+            (whole < 0 || sweep->sorted[j] - sweep->sorted[i] < sweep->sorted[whole + n - 1] - sweep->sorted[whole])) {
+            whole = i;
+        }
+    }
+    if (whole >= 0) return emit(sweep, whole, whole + n - 1, fn, userp);
+
+    // An arc start is maximal only if it reaches further than the one before
+    // it; otherwise its members are a subset of that earlier cluster.
+    for (int i = 0; i < n; i++) {
+        int previous = i > 0 ? sweep->reach[i - 1] : sweep->reach[n - 1] - n;
+        int last = sweep->reach[i];
+        if (last <= previous || last - i + 1 < min_size) continue;
+        int status = emit(sweep, i, last, fn, userp);
+        if (status != 0) return status;
+    }
+    return 0;
+}
+
+uint64_t cluster_key(const int *members, int count) {
+    uint64_t sum = 0;
+    for (int k = 0; k < count; k++) sum += mix64((uint64_t)members[k]);
+    return finish_key(sum, count);
+}
+
+double cluster_arc(double *longitudes, int count) {
+    if (count < 2) return 0;
+    qsort(longitudes, (size_t)count, sizeof(double), compare_doubles);
+    double largest_gap = longitudes[0] + 360.0 - longitudes[count - 1];
+    for (int k = 1; k < count; k++) {
+        double gap = longitudes[k] - longitudes[k - 1];
+        if (gap > largest_gap) largest_gap = gap;
+    }
+    return 360.0 - largest_gap;
+}
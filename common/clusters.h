@@ -0,0 +1,67 @@
+/**
+ * @file clusters.h
+ * @brief Circular sweep that groups bodies lying close together in longitude.
+ *
+ * A cluster is a largest set of bodies whose longitudes fit inside an arc of
+ * the given width. Longitudes are sorted once per call, then two pointers
+ * sweep the circle (wrapping through 360°) and each arc start that reaches a
+ * body the previous start could not reach yields one cluster. Each cluster
+ * is reported exactly once, in O(n log n) for n bodies.
+ *
+ * Each cluster also carries a 64-bit key derived from its member set alone,
+ * so callers can match the same group across days without comparing member
+ * lists.
+ */
+
+#ifndef CLUSTERS_H
+#define CLUSTERS_H
+
+#include <stdint.h>
+
+// One maximal cluster, valid for the duration of the callback.
+struct Cluster {
+    const int *members;   // Body indices, in increasing longitude from the arc start
+    int count;
+    double start;         // Longitude of the first member, degrees
+    double spread;        // Arc from the first to the last member, degrees
+    uint64_t key;         // Identical for identical member sets
+};
+
+typedef int (*cluster_fn)(const struct Cluster *cluster, void *userp);
+
+struct ClusterEntry {
+    double longitude;
+    int body;
+};
+
+// Scratch space for up to `capacity` bodies, reused between calls.
+struct ClusterSweep {
+    int capacity;
+    struct ClusterEntry *entries;   // capacity: (longitude, body) pairs to sort
+    int *order;           // 2 * capacity: sorted body indices, repeated once
+    double *sorted;       // 2 * capacity: their longitudes, +360 the second time round
+    int *reach;           // capacity: last index each arc start reaches
+    uint64_t *prefix;     // 2 * capacity + 1: running sums of member hashes
+};
+
+
+// Allocates scratch for `capacity` bodies. Returns 0, or -1 if out of memory.
+int cluster_sweep_init(struct ClusterSweep *sweep, int capacity);
+
+// Releases the scratch space.
+void cluster_sweep_free(struct ClusterSweep *sweep);
+
+// Calls `fn` for every maximal cluster of at least `min_size` bodies whose
+// longitudes (degrees, in [0, 360)) fit in an arc of `width` degrees. Stops
+// early and returns fn's value if it is non-zero; otherwise returns 0.
+int cluster_sweep_run(struct ClusterSweep *sweep, const double *longitudes, int num_bodies,
+                      double width, int min_size, cluster_fn fn, void *userp);
+
+// Returns the key a cluster of these members would have.
+uint64_t cluster_key(const int *members, int count);
+
+// Smallest arc containing the given longitudes (degrees). Sorts
+// `longitudes` in place.
+double cluster_arc(double *longitudes, int count);
+
+#endif // CLUSTERS_H
@@ -0,0 +1,153 @@
+/**
+ * @file csv_writer.c
+ * @brief Buffered CSV output implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "csv_writer.h"
+#include "stats.h"
+
+static struct StatsEntry write_time = STATS_ENTRY("csv.write", STATS_TIMER, "ns");
+static struct StatsEntry write_bytes = STATS_ENTRY("csv.bytes", STATS_COUNTER, "bytes");
+
+static const double POW10[CSV_FIXED_MAX_DECIMALS + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+};
+
+static const uint64_t POW10_INT[CSV_FIXED_MAX_DECIMALS + 1] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL
+};
+
+// --- Buffered Writer ---
+
+int csv_writer_init(struct CsvWriter *writer, FILE *file, size_t cap) {
+    if (cap == 0) cap = CSV_WRITER_DEFAULT_CAP;
+    writer->file = file;
+    writer->len = 0;
+    writer->cap = cap;
+    writer->failed = 0;
+    writer->buf = malloc(cap);
+    return writer->buf ? 0 : -1;
+}
+
+int csv_writer_flush(struct CsvWriter *writer) {
+    int64_t start = STATS_START();
+    if (writer->len > 0 && fwrite(writer->buf, 1, writer->len, writer->file) != writer->len) {
+        writer->failed = 1;
+    }
+    if (writer->len > 0) {
+        STATS_STOP(write_time, start);
+        STATS_ADD(write_bytes, writer->len);
+    }
+    writer->len = 0;
+    return writer->failed ? -1 : 0;
+}
+
+char *csv_writer_reserve(struct CsvWriter *writer, size_t n) {
+    if (writer->cap - writer->len < n) csv_writer_flush(writer);
+    return writer->buf + writer->len;
+}
+
+void csv_writer_commit(struct CsvWriter *writer, char *end) {
+    writer->len = (size_t)(end - writer->buf);
+}
+
+void csv_writer_write(struct CsvWriter *writer, const char *data, size_t len) {
+    if (len > writer->cap - writer->len) {
+        csv_writer_flush(writer);
+        if (len >= writer->cap) {
+            int64_t start = STATS_START();
+            if (fwrite(data, 1, len, writer->file) != len) writer->failed = 1;
+            STATS_STOP(write_time, start);
+            STATS_ADD(write_bytes, len);
+            return;
+        }
+    }
+    memcpy(writer->buf + writer->len, data, len);
+    writer->len += len;
+}
+
+void csv_writer_puts(struct CsvWriter *writer, const char *text) {
+    csv_writer_write(writer, text, strlen(text));
+}
+
+void csv_writer_field_fixed(struct CsvWriter *writer, double value, int decimals) {
+    char *p = csv_writer_reserve(writer, 1 + CSV_FIXED_MAX_LEN);
+    *p++ = ',';
+    csv_writer_commit(writer, csv_put_fixed(p, value, decimals));
+}
+
+int csv_writer_finish(struct CsvWriter *writer) {
+    int status = csv_writer_flush(writer);
+    free(writer->buf);
+    writer->buf = NULL;
+    writer->cap = 0;
+    return status;
+}
+
+// --- Number Formatting ---
+
+// Returns the rounding error of p = a * b, so that a * b == p + error exactly.
+static double product_error(double a, double b, double p) {
+#ifdef FP_FAST_FMA
+    return fma(a, b, -p);
+#else
+    // Dekker's split; relies on the compiler not contracting into an FMA,
+    // which -std=c99 guarantees for GCC.
+    const double split = 134217729.0; // 2^27 + 1
+    double ta = split * a, tb = split * b;
+    double ah = ta - (ta - a), al = a - ah;
+    double bh = tb - (tb - b), bl = b - bh;
+    return ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+#endif
+}
+
+char *csv_put_fixed(char *out, double value, int decimals) {
+    if (decimals < 0) decimals = 0;
+    double magnitude = fabs(value);
+    double scaled = magnitude * (decimals <= CSV_FIXED_MAX_DECIMALS ? POW10[decimals] : 0.0);
+    if (decimals > CSV_FIXED_MAX_DECIMALS || !isfinite(value) || scaled >= 4503599627370496.0) {
+        int n = snprintf(out, CSV_FIXED_MAX_LEN, "%.*f", decimals, value);
+        return out + (n < 0 ? 0 : (n < CSV_FIXED_MAX_LEN ? n : CSV_FIXED_MAX_LEN - 1));
+    }
+
+    // Round the exact product magnitude * 10^decimals to an integer. Below 2^52
+    // the fraction is exact and the product error decides near-ties.
+    uint64_t n = (uint64_t)scaled;
+    double frac = scaled - (double)n;
+    if (frac > 0.5) {
+        n++;
+    } else if (frac == 0.5) {
+        double error = product_error(magnitude, POW10[decimals], scaled);
+        if (error > 0.0 || (error == 0.0 && (n & 1))) n++;
+    }
+
+    char digits[24];
+    int len = 0;
+    uint64_t whole = n / POW10_INT[decimals];
+    uint64_t fraction = n % POW10_INT[decimals];
+    do {
+        digits[len++] = (char)('0' + whole % 10);
+        whole /= 10;
+    } while (whole);
+
+    char *p = out;
+    if (signbit(value)) *p++ = '-';
+    while (len) *p++ = digits[--len];
+    if (decimals > 0) {
+        *p++ = '.';
+        for (int i = decimals - 1; i >= 0; i--) {
+            p[i] = (char)('0' + fraction % 10);
+            fraction /= 10;
+        }
+        p += decimals;
+    }
+    return p;
+}
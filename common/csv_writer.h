@@ -0,0 +1,69 @@
+/**
+ * @file csv_writer.h
+ * @brief Buffered CSV output with fast number and date formatting.
+ *
+ * CsvWriter collects output in a large user-space buffer and hands it to
+ * the FILE in big blocks. The formatting helpers write straight into
+ * caller-provided memory without touching the heap or libc's printf
+ * machinery:
+ *
+ *  - csv_put_fixed produces exactly the text printf("%.Nf") would for
+ *    finite values below 2^52 / 10^N (ties round to even, as glibc does),
+ *    and falls back to snprintf otherwise.
+ *
+ * Row labels come from TimeLabel in common/timebase.h.
+ */
+
+#ifndef CSV_WRITER_H
+#define CSV_WRITER_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define CSV_WRITER_DEFAULT_CAP (1 << 20)
+#define CSV_FIXED_MAX_DECIMALS 15
+#define CSV_FIXED_MAX_LEN 330  // Room for any csv_put_fixed value (DBL_MAX has 309 digits)
+
+// Buffered output stream.
+struct CsvWriter {
+    FILE *file;
+    char *buf;
+    size_t len;
+    size_t cap;
+    int failed;
+};
+
+// Initialises a writer on `file` with a `cap` byte buffer (0 selects
+// CSV_WRITER_DEFAULT_CAP). Returns 0, or -1 if out of memory.
+int csv_writer_init(struct CsvWriter *writer, FILE *file, size_t cap);
+
+// Returns a pointer to at least `n` free bytes at the end of the buffer,
+// flushing first if needed. Write into it, then call csv_writer_commit
+// with the end of what was written. `n` must not exceed the capacity.
+char *csv_writer_reserve(struct CsvWriter *writer, size_t n);
+
+// Marks the bytes up to `end` as written.
+void csv_writer_commit(struct CsvWriter *writer, char *end);
+
+// Appends raw bytes; blocks larger than the buffer bypass it.
+void csv_writer_write(struct CsvWriter *writer, const char *data, size_t len);
+
+// Appends a NUL-terminated string.
+void csv_writer_puts(struct CsvWriter *writer, const char *text);
+
+// Appends "," followed by `value` with `decimals` digits after the point.
+void csv_writer_field_fixed(struct CsvWriter *writer, double value, int decimals);
+
+// Writes the buffered bytes to the FILE. Returns 0, or -1 after any error.
+int csv_writer_flush(struct CsvWriter *writer);
+
+// Flushes and releases the buffer (the FILE stays open). Returns 0, or -1
+// if any write failed.
+int csv_writer_finish(struct CsvWriter *writer);
+
+// Writes `value` as printf("%.*f", decimals, value) would, at `out`
+// (which needs CSV_FIXED_MAX_LEN bytes). Returns the end of the text; no
+// terminator is written.
+char *csv_put_fixed(char *out, double value, int decimals);
+
+#endif // CSV_WRITER_H
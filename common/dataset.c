@@ -0,0 +1,734 @@
+/**
+ * @file dataset.c
+ * @brief Memory-mapped dataset loader implementation.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dataset.h"
+#include "timebase.h"
+#include "stats.h"
+
+#define FIELD_MAX 64          // Longest field handed to the strtod fallback
+#define FAST_MAX_DIGITS 15    // Mantissas this short are exact in a double
+#define STDIN_INITIAL (1 << 20) // First read buffer for "-"
+#define LAZY_OFFSETS_INITIAL 1024 // First index allocation for lazy CSV files
+#define INDEX_MAGIC "PLCSVIX\n"
+#define INDEX_VERSION 1
+#define INDEX_BYTE_ORDER 0x01020304u
+#define INDEX_HEADER_LEN 64
+
+static const double POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// --- Field Parsing ---
+
+// Parses the number in [p, end) up to the next ',' or line end, setting
+// *next to the terminator. Plain "[-]ddd.ddd" fields of up to 15 digits are
+// converted exactly (one correctly rounded division, as strtod would);
+// anything else goes through strtod.
+static double parse_field(const char *p, const char *end, const char **next) {
+    const char *q = p;
+    int negative = 0;
+    if (q < end && (*q == '-' || *q == '+')) negative = (*q++ == '-');
+
+    uint64_t mantissa = 0;
+    int digits = 0, decimals = 0, seen_point = 0;
+    for (; q < end; q++) {
+        char c = *q;
+        if (c >= '0' && c <= '9') {
+            mantissa = mantissa * 10 + (uint64_t)(c - '0');
+            digits++;
+            decimals += seen_point;
+        } else if (c == '.' && !seen_point) {
+            seen_point = 1;
+        } else {
+            break;
+        }
+    }
+
+    if (digits > 0 && digits <= FAST_MAX_DIGITS &&
+        (q == end || *q == ',' || *q == '\n' || *q == '\r')) {
+        *next = q;
+        double value = (double)mantissa / POW10[decimals];
+        return negative ? -value : value;
+    }
+
+    // Exponents, nan/inf or long mantissas: hand a terminated copy to strtod.
+    const char *stop = p;
+    while (stop < end && *stop != ',' && *stop != '\n' && *stop != '\r') stop++;
+    *next = stop;
+    char field[FIELD_MAX];
+    size_t len = (size_t)(stop - p);
+    if (len == 0) return NAN;
+    if (len >= sizeof(field)) len = sizeof(field) - 1;
+    memcpy(field, p, len);
+    field[len] = '\0';
+    return strtod(field, NULL);
+}
+
+// --- CSV ---
+
+// Returns 1 if the line [p, nl) holds a row (blank lines are skipped).
+static int is_row(const char *p, const char *nl) {
+    return nl - p > 1 || (nl - p == 1 && *p != '\r');
+}
+
+// Start of the row after the one at `p`.
+static const char *next_row(const char *p, const char *end) {
+    for (;;) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (nl == NULL) return end;
+        p = nl + 1;
+        if (p >= end) return end;
+        nl = memchr(p, '\n', (size_t)(end - p));
+        if (is_row(p, nl ? nl : end)) return p;
+    }
+}
+
+// Start of data row `row` (which must be indexed).
+static const char *row_start(const struct Dataset *data, long row) {
+    const char *p = data->map + data->row_offsets[row / data->row_stride];
+    const char *end = data->map + data->map_len;
+    for (long k = row % data->row_stride; k > 0; k--) p = next_row(p, end);
+    return p;
+}
+
+// Parses the fields of the row at `p` into values[body * per_body + axis].
+static void parse_row(const struct Dataset *data, const char *p, double *values) {
+    const char *end = data->map + data->map_len;
+    const char *nl = memchr(p, '\n', (size_t)(end - p));
+    if (nl == NULL) nl = end;
+    const char *q = memchr(p, ',', (size_t)(nl - p));
+    int n = data->num_bodies * data->values_per_body;
+    for (int k = 0; k < n; k++) {
+        if (q != NULL && q < nl && *q == ',') {
+            values[k] = parse_field(q + 1, nl, &q);
+        } else {
+            values[k] = NAN;   // Short row
+        }
+    }
+}
+
+// Reads body names from the "Date,Body_x,Body_y,Body_z,..." header line, or
+// from a "Date,Body,Body,..." longitude table header.
+static void parse_csv_header(struct Dataset *data, const char *p, const char *end) {
+    // The first body field decides the layout: "Sun_x" or plain "Sun".
+    const char *first = memchr(p, ',', (size_t)(end - p));
+    const char *second = first ? memchr(first + 1, ',', (size_t)(end - first - 1)) : NULL;
+    if (second == NULL) second = end;
+    if (second > p && second[-1] == '\r') second--;
+    int per_body = (first && second - first > 2 && memcmp(second - 2, "_x", 2) == 0) ? 3 : 1;
+    data->values_per_body = per_body;
+
+    int field = 0;
+    while (p < end) {
+        const char *stop = memchr(p, ',', (size_t)(end - p));
+        if (stop == NULL) stop = end;
+        size_t len = (size_t)(stop - p);
+        if (len > 0 && p[len - 1] == '\r') len--;
+        if (field > 0 && (field - 1) % per_body == 0 && data->num_bodies < DATASET_MAX_BODIES) {
+            const char *underscore = per_body == 3 ? memchr(p, '_', len) : NULL;
+            if (underscore) len = (size_t)(underscore - p);
+            if (len >= DATASET_NAME_LEN) len = DATASET_NAME_LEN - 1;
+            memcpy(data->names[data->num_bodies], p, len);
+            data->names[data->num_bodies][len] = '\0';
+            data->num_bodies++;
+        }
+        field++;
+        p = stop + 1;
+    }
+}
+
+// Reads the header line; data rows start at data->scan_pos.
+static int open_csv_header(struct Dataset *data, const char *path) {
+    const char *map = data->map, *end = data->map + data->map_len;
+    const char *header_end = memchr(map, '\n', data->map_len);
+    if (header_end == NULL) header_end = end;
+    parse_csv_header(data, map, header_end);
+    if (data->num_bodies == 0) {
+        fprintf(stderr, "Error: %s has no body columns in its header.\n", path);
+        return -1;
+    }
+    data->scan_pos = header_end < end ? (size_t)(header_end + 1 - map) : data->map_len;
+    return 0;
+}
+
+// Parses the rows starting in [begin, stop) of a CSV whose header is read.
+static int open_csv_rows(struct Dataset *data, const char *begin, const char *stop) {
+    const char *map = data->map, *end = data->map + data->map_len;
+
+    // Count the rows first so every column is allocated exactly once.
+    long rows = 0;
+    for (const char *p = begin; p < stop;) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (nl == NULL) nl = end;
+        if (is_row(p, nl)) rows++;
+        p = nl + 1;
+    }
+
+    size_t plane = (size_t)rows;
+    int per_body = data->values_per_body;
+    data->owned = malloc((plane ? plane : 1) * per_body * data->num_bodies * sizeof(double));
+    data->row_offsets = malloc((plane ? plane : 1) * sizeof(size_t));
+    if (data->owned == NULL || data->row_offsets == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    for (int b = 0; b < data->num_bodies; b++) {
+        for (int a = 0; a < per_body; a++) data->columns[b][a] = data->owned + (size_t)(b * per_body + a) * plane;
+    }
+
+    long row = 0;
+    for (const char *p = begin; p < stop && row < rows;) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (nl == NULL) nl = end;
+        if (is_row(p, nl)) {
+            data->row_offsets[row] = (size_t)(p - map);
+            const char *q = memchr(p, ',', (size_t)(nl - p));
+            for (int b = 0; b < data->num_bodies; b++) {
+                for (int a = 0; a < per_body; a++) {
+                    double *column = data->owned + (size_t)(b * per_body + a) * plane;
+                    if (q != NULL && q < nl && *q == ',') {
+                        column[row] = parse_field(q + 1, nl, &q);
+                    } else {
+                        column[row] = NAN;   // Short row
+                    }
+                }
+            }
+            row++;
+        }
+        p = nl + 1;
+    }
+    data->num_rows = rows;
+    data->row_stride = 1;
+    data->indexed = 1;
+    return 0;
+}
+
+// --- Binary ---
+
+// Opens rows of a binary ephemeris with times in [from_t, to_t]; the
+// fixed step makes the first and last row plain arithmetic. float32
+// columns are widened unless `lazy`.
+static int open_binary(struct Dataset *data, const char *path, int lazy, int64_t from_t, int64_t to_t) {
+    const unsigned char *image = (const unsigned char *)data->map;
+    if (ephemeris_decode(&data->info, image, data->map_len, path) != 0) return -1;
+
+    const struct EphemerisInfo *info = &data->info;
+    long n = info->num_rows;
+    int64_t start = ephemeris_row_time(info, 0), step = info->step_seconds;
+    int64_t last = start + (int64_t)(n - 1) * step;
+    long first = from_t <= start ? 0 : from_t > last ? n : (long)((from_t - start + step - 1) / step);
+    long stop = to_t >= last ? n : to_t < start ? 0 : (long)((to_t - start) / step) + 1;
+    data->is_binary = 1;
+    data->values_per_body = 3;
+    data->num_bodies = info->num_bodies;
+    data->row_base = first;
+    data->num_rows = stop > first ? stop - first : 0;
+    data->indexed = 1;
+    for (int b = 0; b < info->num_bodies; b++) memcpy(data->names[b], info->names[b], DATASET_NAME_LEN);
+
+    size_t plane = (size_t)n, rows = (size_t)data->num_rows;
+    if (info->value_size == 8) {
+        // Zero-copy: the columns live in the mapping (ephemeris_decode rejects an unaligned data_offset).
+        const double *base = (const double *)(image + info->data_offset) + first;
+        for (int b = 0; b < info->num_bodies; b++) {
+            for (int a = 0; a < 3; a++) data->columns[b][a] = base + (size_t)(b * 3 + a) * plane;
+        }
+        return 0;
+    }
+    if (lazy) return 0;
+
+    data->owned = malloc((rows ? rows : 1) * 3 * info->num_bodies * sizeof(double));
+    if (data->owned == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    const float *source = (const float *)(image + info->data_offset) + first;
+    for (int b = 0; b < info->num_bodies; b++) {
+        for (int a = 0; a < 3; a++) {
+            double *column = data->owned + (size_t)(b * 3 + a) * rows;
+            const float *values = source + (size_t)(b * 3 + a) * plane;
+            for (size_t r = 0; r < rows; r++) column[r] = values[r];
+            data->columns[b][a] = column;
+        }
+    }
+    return 0;
+}
+
+// --- CSV Sidecar Index ---
+
+// Every DATASET_INDEX_STRIDE'th row of a CSV: where it starts and its time.
+struct CsvIndex {
+    long num_rows;
+    long num_entries;
+    int64_t step;        // Seconds between rows, or 0 if they are not evenly spaced
+    uint64_t *offsets;
+    int64_t *times;
+};
+
+static void copy_label(const char *p, const char *end, char *out) {
+    size_t len = 0;
+    while (p + len < end && len < DATASET_DATE_LEN - 1 && p[len] != ',' && p[len] != '\n' && p[len] != '\r') len++;
+    memcpy(out, p, len);
+    out[len] = '\0';
+}
+
+// Reads the time of the row at `p` from its label. Returns 0, or -1 if the
+// label is not a date.
+static int label_time(const char *p, const char *end, int64_t *t) {
+    char date[DATASET_DATE_LEN];
+    copy_label(p, end, date);
+    return timebase_parse(date, t);
+}
+
+static void index_free(struct CsvIndex *index) {
+    free(index->offsets);
+    free(index->times);
+}
+
+static int index_alloc(struct CsvIndex *index, size_t entries) {
+    index->offsets = malloc((entries ? entries : 1) * sizeof(uint64_t));
+    index->times = malloc((entries ? entries : 1) * sizeof(int64_t));
+    return index->offsets && index->times ? 0 : -1;
+}
+
+// Scans every row of the open CSV. Returns 0, or -1 if a label is not a
+// date or memory runs out.
+static int index_build(const struct Dataset *data, struct CsvIndex *index) {
+    const char *map = data->map, *end = data->map + data->map_len;
+    size_t cap = LAZY_OFFSETS_INITIAL;
+    if (index_alloc(index, cap) != 0) return -1;
+    long rows = 0, entries = 0;
+    int64_t second_t = 0;
+    const char *last_row = NULL;
+    for (const char *p = map + data->scan_pos; p < end;) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (nl == NULL) nl = end;
+        if (is_row(p, nl)) {
+            if (rows % DATASET_INDEX_STRIDE == 0) {
+                if ((size_t)entries == cap) {
+                    uint64_t *offsets = realloc(index->offsets, cap * 2 * sizeof(uint64_t));
+                    if (offsets) index->offsets = offsets;
+                    int64_t *times = realloc(index->times, cap * 2 * sizeof(int64_t));
+                    if (times) index->times = times;
+                    if (!offsets || !times) return -1;
+                    cap *= 2;
+                }
+                index->offsets[entries] = (uint64_t)(p - map);
+                if (label_time(p, nl, &index->times[entries]) != 0) return -1;
+                entries++;
+            }
+            if (rows == 1 && label_time(p, nl, &second_t) != 0) return -1;
+            last_row = p;
+            rows++;
+        }
+        p = nl + 1;
+    }
+    index->num_rows = rows;
+    index->num_entries = entries;
+
+    // Evenly spaced rows (anything the tools write) are found by arithmetic.
+    index->step = 0;
+    int64_t last_t;
+    if (rows > 1 && label_time(last_row, end, &last_t) == 0) {
+        int64_t step = second_t - index->times[0];
+        int even = step > 0 && last_t == index->times[0] + (int64_t)(rows - 1) * step;
+        for (long k = 1; k < entries && even; k++) {
+            even = index->times[k] == index->times[0] + (int64_t)k * DATASET_INDEX_STRIDE * step;
+        }
+        if (even) index->step = step;
+    }
+    return 0;
+}
+
+// Reads PATH.idx if it was written for this very file. Returns 0 on success.
+static int index_load(const char *index_path, const struct stat *st, struct CsvIndex *index) {
+    FILE *file = fopen(index_path, "rb");
+    if (file == NULL) return -1;
+    unsigned char header[INDEX_HEADER_LEN];
+    uint32_t version, stride, order;
+    uint64_t size, rows, entries;
+    int64_t mtime, step;
+    int status = -1;
+    if (fread(header, sizeof(header), 1, file) == 1 && memcmp(header, INDEX_MAGIC, 8) == 0) {
+        memcpy(&version, header + 8, 4);
+        memcpy(&stride, header + 12, 4);
+        memcpy(&size, header + 16, 8);
+        memcpy(&mtime, header + 24, 8);
+        memcpy(&rows, header + 32, 8);
+        memcpy(&entries, header + 40, 8);
+        memcpy(&step, header + 48, 8);
+        memcpy(&order, header + 56, 4);
+        if (version == INDEX_VERSION && stride == DATASET_INDEX_STRIDE && order == INDEX_BYTE_ORDER &&
+            size == (uint64_t)st->st_size && mtime == (int64_t)st->st_mtime &&
+            entries == (rows + DATASET_INDEX_STRIDE - 1) / DATASET_INDEX_STRIDE &&
+            index_alloc(index, (size_t)entries) == 0 &&
+            fread(index->offsets, sizeof(uint64_t), (size_t)entries, file) == entries &&
+            fread(index->times, sizeof(int64_t), (size_t)entries, file) == entries) {
+            index->num_rows = (long)rows;
+            index->num_entries = (long)entries;
+            index->step = step;
+            status = 0;
+        }
+    }
+    fclose(file);
+    return status;
+}
+
+// Writes PATH.idx for later runs; a directory that cannot be written to
+// just means the index is rebuilt next time.
+static void index_save(const char *index_path, const struct stat *st, const struct CsvIndex *index) {
+    unsigned char header[INDEX_HEADER_LEN] = {0};
+    uint32_t version = INDEX_VERSION, stride = DATASET_INDEX_STRIDE, order = INDEX_BYTE_ORDER;
+    uint64_t size = (uint64_t)st->st_size, rows = (uint64_t)index->num_rows, entries = (uint64_t)index->num_entries;
+    int64_t mtime = (int64_t)st->st_mtime;
+    memcpy(header, INDEX_MAGIC, 8);
+    memcpy(header + 8, &version, 4);
+    memcpy(header + 12, &stride, 4);
+    memcpy(header + 16, &size, 8);
+    memcpy(header + 24, &mtime, 8);
+    memcpy(header + 32, &rows, 8);
+    memcpy(header + 40, &entries, 8);
+    memcpy(header + 48, &index->step, 8);
+    memcpy(header + 56, &order, 4);
+    FILE *file = fopen(index_path, "wb");
+    if (file == NULL) return;
+    int ok = fwrite(header, sizeof(header), 1, file) == 1 &&
+             fwrite(index->offsets, sizeof(uint64_t), (size_t)entries, file) == entries &&
+             fwrite(index->times, sizeof(int64_t), (size_t)entries, file) == entries;
+    if (fclose(file) != 0 || !ok) remove(index_path);
+}
+
+// Start of row `row` (or the end of the file past the last row).
+static const char *index_row(const struct Dataset *data, const struct CsvIndex *index, long row) {
+    const char *end = data->map + data->map_len;
+    if (row >= index->num_rows) return end;
+    const char *p = data->map + index->offsets[row / DATASET_INDEX_STRIDE];
+    for (long k = row % DATASET_INDEX_STRIDE; k > 0; k--) p = next_row(p, end);
+    return p;
+}
+
+// First row at or after `t`: arithmetic for evenly spaced rows, otherwise
+// a binary search of the entries and a scan of at most one stride.
+static long index_find(const struct Dataset *data, const struct CsvIndex *index, int64_t t) {
+    if (index->num_rows == 0 || t <= index->times[0]) return 0;
+    if (index->step > 0) {
+        int64_t last = index->times[0] + (int64_t)(index->num_rows - 1) * index->step;
+        if (t > last) return index->num_rows;
+        return (long)((t - index->times[0] + index->step - 1) / index->step);
+    }
+    long lo = 0, hi = index->num_entries - 1;
+    while (lo < hi) {
+        long mid = (lo + hi + 1) / 2;
+        if (index->times[mid] < t) lo = mid; else hi = mid - 1;
+    }
+    const char *end = data->map + data->map_len, *p = data->map + index->offsets[lo];
+    long row = lo * DATASET_INDEX_STRIDE;
+    for (; row < index->num_rows; row++, p = next_row(p, end)) {
+        int64_t row_t;
+        if (label_time(p, end, &row_t) == 0 && row_t >= t) break;
+    }
+    return row;
+}
+
+// Parses the rows of a CSV with times in [from_t, to_t], found through
+// its sidecar index.
+static int open_csv_range(struct Dataset *data, const char *path, int64_t from_t, int64_t to_t) {
+    if (open_csv_header(data, path) != 0) return -1;
+    struct CsvIndex index = {0};
+    char index_path[FILENAME_MAX];
+    struct stat st;
+    int stored = !data->map_owned && stat(path, &st) == 0 &&
+                 snprintf(index_path, sizeof(index_path), "%s.idx", path) < (int)sizeof(index_path);
+    if (!stored || index_load(index_path, &st, &index) != 0) {
+        index_free(&index);
+        memset(&index, 0, sizeof(index));
+        if (index_build(data, &index) != 0) {
+            fprintf(stderr, "Error: %s has row labels that are not dates; -from/-to need dates.\n", path);
+            index_free(&index);
+            return -1;
+        }
+        if (stored) index_save(index_path, &st, &index);
+    }
+    long first = index_find(data, &index, from_t);
+    long stop = to_t == DATASET_TIME_MAX ? index.num_rows : index_find(data, &index, to_t + 1);
+    if (stop < first) stop = first;
+    int status = open_csv_rows(data, index_row(data, &index, first), index_row(data, &index, stop));
+    index_free(&index);
+    return status;
+}
+
+// --- Public API ---
+
+static int map_file(struct Dataset *data, const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening input file");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "Error: %s is empty or unreadable.\n", path);
+        close(fd);
+        return -1;
+    }
+    if ((uint64_t)st.st_size > (uint64_t)SIZE_MAX) {
+        fprintf(stderr, "Error: %s is too large to map on this machine.\n", path);
+        close(fd);
+        return -1;
+    }
+    data->map_len = (size_t)st.st_size;
+    void *map = mmap(NULL, data->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error mapping input file");
+        data->map_len = 0;
+        return -1;
+    }
+    data->map = map;
+    madvise(map, data->map_len, MADV_SEQUENTIAL);
+    return 0;
+}
+
+// Reads all of stdin into memory, standing in for the mapping.
+static int read_stdin(struct Dataset *data) {
+    size_t cap = STDIN_INITIAL, len = 0;
+    char *buf = malloc(cap);
+    for (;;) {
+        if (buf == NULL) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            return -1;
+        }
+        len += fread(buf + len, 1, cap - len, stdin);
+        if (len < cap) break;
+        char *grown = realloc(buf, cap * 2);
+        if (grown == NULL) free(buf);
+        buf = grown;
+        cap *= 2;
+    }
+    if (ferror(stdin) || len == 0) {
+        fprintf(stderr, "Error: No data on standard input.\n");
+        free(buf);
+        return -1;
+    }
+    data->map = buf;
+    data->map_len = len;
+    data->map_owned = 1;
+    return 0;
+}
+
+static struct StatsEntry open_time = STATS_ENTRY("dataset.open", STATS_TIMER, "ns");
+static struct StatsEntry rows_loaded = STATS_ENTRY("dataset.rows", STATS_COUNTER, "rows");
+static struct StatsEntry index_time = STATS_ENTRY("dataset.index", STATS_TIMER, "ns");
+
+static int open_any(struct Dataset *data, const char *path, int lazy, int64_t from_t, int64_t to_t) {
+    int64_t start = STATS_START();
+    memset(data, 0, sizeof(*data));
+    if (strcmp(path, "-") == 0) {
+        if (read_stdin(data) != 0) return -1;
+        path = "standard input";
+    } else if (map_file(data, path) != 0) {
+        return -1;
+    }
+
+    int status;
+    if (data->map_len >= 8 && memcmp(data->map, EPHEMERIS_MAGIC, 8) == 0) {
+        status = open_binary(data, path, lazy, from_t, to_t);
+    } else if (lazy) {
+        status = open_csv_header(data, path);
+        data->row_stride = DATASET_LAZY_STRIDE;
+        data->offsets_cap = LAZY_OFFSETS_INITIAL;
+        data->row_offsets = malloc(data->offsets_cap * sizeof(size_t));
+        if (status == 0 && data->row_offsets == NULL) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            status = -1;
+        }
+    } else if (from_t != DATASET_TIME_MIN || to_t != DATASET_TIME_MAX) {
+        status = open_csv_range(data, path, from_t, to_t);
+    } else {
+        status = open_csv_header(data, path);
+        if (status == 0) status = open_csv_rows(data, data->map + data->scan_pos, data->map + data->map_len);
+    }
+    if (status != 0) {
+        dataset_close(data);
+    } else {
+        STATS_STOP(open_time, start);
+        STATS_ADD(rows_loaded, data->num_rows);
+    }
+    return status;
+}
+
+int dataset_open(struct Dataset *data, const char *path) {
+    return open_any(data, path, 0, DATASET_TIME_MIN, DATASET_TIME_MAX);
+}
+
+int dataset_open_lazy(struct Dataset *data, const char *path) {
+    return open_any(data, path, 1, DATASET_TIME_MIN, DATASET_TIME_MAX);
+}
+
+int dataset_open_range(struct Dataset *data, const char *path, int64_t from_t, int64_t to_t) {
+    if (open_any(data, path, 0, from_t, to_t) != 0) return -1;
+    if (data->num_rows == 0) {
+        fprintf(stderr, "Error: %s has no rows between the -from and -to times.\n", path);
+        dataset_close(data);
+        return -1;
+    }
+    return 0;
+}
+
+int dataset_parse_range(const char *from, const char *to, int64_t *from_t, int64_t *to_t) {
+    *from_t = DATASET_TIME_MIN;
+    *to_t = DATASET_TIME_MAX;
+    if ((from && timebase_parse(from, from_t) != 0) || (to && timebase_parse(to, to_t) != 0)) {
+        fprintf(stderr, "Error: -from and -to must be YYYY-MM-DD or YYYY-MM-DD HH:MM.\n");
+        return -1;
+    }
+    // A date alone runs to the end of that day.
+    if (to && strchr(to, ':') == NULL) *to_t += TIMEBASE_SECONDS_PER_DAY - 1;
+    if (*from_t > *to_t) {
+        fprintf(stderr, "Error: -from is after -to.\n");
+        return -1;
+    }
+    return 0;
+}
+
+int dataset_index_rows(struct Dataset *data, size_t max_bytes) {
+    if (data->indexed) return 1;
+    int64_t start = STATS_START();
+    const char *map = data->map, *end = data->map + data->map_len;
+    const char *p = map + data->scan_pos;
+    const char *limit = (size_t)(end - p) > max_bytes ? p + max_bytes : end;
+    while (p < limit) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        if (nl == NULL) nl = end;
+        if (is_row(p, nl)) {
+            if (data->num_rows % data->row_stride == 0) {
+                size_t entry = (size_t)(data->num_rows / data->row_stride);
+                if (entry == data->offsets_cap) {
+                    size_t *grown = realloc(data->row_offsets, data->offsets_cap * 2 * sizeof(size_t));
+                    if (grown == NULL) break;   // Retried on the next call
+                    data->row_offsets = grown;
+                    data->offsets_cap *= 2;
+                }
+                data->row_offsets[entry] = (size_t)(p - map);
+            }
+            data->num_rows++;
+        }
+        p = nl + 1;
+    }
+    data->scan_pos = p < end ? (size_t)(p - map) : data->map_len;
+    data->indexed = data->scan_pos >= data->map_len;
+    STATS_STOP(index_time, start);
+    return data->indexed;
+}
+
+int dataset_read_rows(const struct Dataset *data, long first, long count, double *out) {
+    if (first < 0 || count < 0 || first + count > data->num_rows) return -1;
+    int per_body = data->values_per_body;
+    size_t row_len = (size_t)data->num_bodies * per_body;
+    if (data->columns[0][0] != NULL) {
+        for (int b = 0; b < data->num_bodies; b++) {
+            for (int a = 0; a < per_body; a++) {
+                const double *column = data->columns[b][a] + first;
+                double *dest = out + (size_t)b * per_body + a;
+                for (long r = 0; r < count; r++) dest[(size_t)r * row_len] = column[r];
+            }
+        }
+    } else if (data->is_binary) {
+        // Lazily opened float32 file: widen just these rows.
+        const float *base = (const float *)(data->map + data->info.data_offset);
+        for (int b = 0; b < data->num_bodies; b++) {
+            for (int a = 0; a < 3; a++) {
+                const float *column = base + (size_t)(b * 3 + a) * data->info.num_rows + data->row_base + first;
+                double *dest = out + (size_t)b * 3 + a;
+                for (long r = 0; r < count; r++) dest[(size_t)r * row_len] = column[r];
+            }
+        }
+    } else {
+        const char *end = data->map + data->map_len;
+        const char *p = count > 0 ? row_start(data, first) : end;
+        for (long r = 0; r < count; r++) {
+            parse_row(data, p, out + (size_t)r * row_len);
+            p = next_row(p, end);
+        }
+    }
+    return 0;
+}
+
+void dataset_close(struct Dataset *data) {
+    if (data->map_owned) free((void *)data->map);
+    else if (data->map) munmap((void *)data->map, data->map_len);
+    free(data->owned);
+    free(data->row_offsets);
+    memset(data, 0, sizeof(*data));
+}
+
+const double *dataset_column(const struct Dataset *data, int body, int axis) {
+    return data->columns[body][axis];
+}
+
+void dataset_date(const struct Dataset *data, long row, char *out) {
+    if (data->is_binary) {
+        ephemeris_date(&data->info, data->row_base + row, out);
+        return;
+    }
+    copy_label(row_start(data, row), data->map + data->map_len, out);
+}
+
+// Reads the UTC time of `row` from its label. Returns 0, or -1 if the label
+// is not a date.
+static int row_time(const struct Dataset *data, long row, int64_t *t) {
+    if (data->is_binary) {
+        *t = ephemeris_row_time(&data->info, data->row_base + row);
+        return 0;
+    }
+    char date[DATASET_DATE_LEN];
+    dataset_date(data, row, date);
+    return timebase_parse(date, t);
+}
+
+void dataset_time_label(const struct Dataset *data, double row, char *out) {
+    if (data->num_rows <= 0) {
+        out[0] = '\0';
+        return;
+    }
+    if (row < 0) row = 0;
+    if (row > data->num_rows - 1) row = (double)(data->num_rows - 1);
+    long base = (long)floor(row);
+    int64_t t, next;
+    if (row_time(data, base, &t) != 0) {
+        // Unparseable CSV label: show it as it is.
+        dataset_date(data, base, out);
+        return;
+    }
+    // The step is the header's, or the gap to a neighbouring CSV row.
+    int64_t step = TIMEBASE_SECONDS_PER_DAY;
+    if (data->is_binary) {
+        step = data->info.step_seconds;
+    } else if (base + 1 < data->num_rows && row_time(data, base + 1, &next) == 0) {
+        step = next - t;
+    } else if (base > 0 && row_time(data, base - 1, &next) == 0) {
+        step = t - next;
+    }
+    timebase_format(t + lround((row - base) * (double)step / 60) * 60, 1, out);
+}
+
+int dataset_find_body(const struct Dataset *data, const char *name) {
+    for (int i = 0; i < data->num_bodies; i++) {
+        if (strcmp(data->names[i], name) == 0) return i;
+    }
+    return -1;
+}
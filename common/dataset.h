@@ -0,0 +1,134 @@
+/**
+ * @file dataset.h
+ * @brief Memory-mapped loader for simulated position datasets.
+ *
+ * Opens either a binary ephemeris (see ephemeris.h) or the
+ * "Date,Body_x,Body_y,Body_z,..." CSV written by kepler_sim_3d and exposes
+ * every coordinate as a contiguous per-body column.
+ *
+ * Binary float64 files are mmap'd and the columns point straight into the
+ * mapping, so opening costs a header check however large the file is.
+ * float32 files are widened in a single pass. CSV files are mapped as well:
+ * the rows are counted first, so the columns are allocated once, then every
+ * field is parsed straight into place. Date labels are read from each row's
+ * text on demand, so nothing is copied per frame.
+ *
+ * The "Date,Sun,Moon,..." longitude tables written by planetary_logger and
+ * kepler_sim load the same way, with one value per body (axis 0) instead of
+ * three; values_per_body tells the two apart.
+ *
+ * dataset_open_lazy is for playback of files of any length: opening reads
+ * only the header. CSV rows are found as dataset_index_rows is called,
+ * keeping one offset per DATASET_LAZY_STRIDE rows, and positions are read a
+ * window of rows at a time with dataset_read_rows, so memory use does not
+ * grow with the file.
+ *
+ * dataset_open_range opens just the rows between two times. A binary
+ * ephemeris has a fixed step, so the rows are found by arithmetic and
+ * only their part of each column is touched. A CSV gets a sidecar index,
+ * "FILE.idx", written on first use and rebuilt when the CSV's size or
+ * modification time changes. It holds the offset and time of every
+ * DATASET_INDEX_STRIDE'th row; evenly spaced rows are then found by
+ * arithmetic too, and only the slice is parsed. It is laid out as:
+ *
+ *   offset  size  field
+ *        0     8  magic "PLCSVIX\n"
+ *        8     4  version (1)
+ *       12     4  rows per entry (DATASET_INDEX_STRIDE)
+ *       16     8  size of the CSV, bytes
+ *       24     8  modification time of the CSV, Unix seconds
+ *       32     8  number of rows
+ *       40     8  number of entries
+ *       48     8  seconds between rows, or 0 if they are not evenly spaced
+ *       56     4  byte-order mark 0x01020304, written in host order
+ *       64        entry offsets (uint64), then entry times (int64)
+ */
+
+#ifndef DATASET_H
+#define DATASET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ephemeris.h"
+
+#define DATASET_MAX_BODIES EPHEMERIS_MAX_BODIES
+#define DATASET_NAME_LEN EPHEMERIS_NAME_LEN
+#define DATASET_DATE_LEN EPHEMERIS_DATE_LEN
+#define DATASET_TIME_LEN (DATASET_DATE_LEN + 16)
+#define DATASET_LAZY_STRIDE 64   // Rows per index entry for lazily opened CSV files
+#define DATASET_INDEX_STRIDE 64  // Rows per entry of a CSV sidecar index
+#define DATASET_TIME_MIN INT64_MIN // Open ends of a dataset_open_range range
+#define DATASET_TIME_MAX INT64_MAX
+
+// An open dataset. Treat as read-only; use the accessors below.
+struct Dataset {
+    int num_bodies;
+    char names[DATASET_MAX_BODIES][DATASET_NAME_LEN];
+    long num_rows;
+    int values_per_body;                           // 3 (x, y, z) or 1 (longitude)
+    const double *columns[DATASET_MAX_BODIES][3];  // [body][axis], axis 0 = x
+
+    int is_binary;
+    struct EphemerisInfo info;     // Binary files: header, used for dates
+    long row_base;                 // Binary files: file row of row 0
+    const char *map;               // The mapped file
+    size_t map_len;
+    int map_owned;                 // `map` was read from stdin and is malloc'd
+    double *owned;                 // Columns parsed or widened into memory
+    size_t *row_offsets;           // CSV files: start of every row_stride'th data row in `map`
+    long row_stride;               // 1, or DATASET_LAZY_STRIDE when opened lazily
+    size_t offsets_cap;            // Entries allocated in row_offsets (lazy CSV)
+    size_t scan_pos;               // Lazy CSV: where indexing continues
+    int indexed;                   // Every row is counted in num_rows
+};
+
+// Opens `path`, detecting the format from its first bytes. A path of "-"
+// reads the whole of stdin instead of mapping a file. Returns 0 on success;
+// errors are reported on stderr.
+int dataset_open(struct Dataset *data, const char *path);
+
+// Opens only the rows of `path` with times in [from_t, to_t] (UTC Unix
+// seconds; DATASET_TIME_MIN/MAX leave an end open); row 0 is the first of
+// them. Returns 0, or -1 with a message on stderr, including when no row is
+// in the range.
+int dataset_open_range(struct Dataset *data, const char *path, int64_t from_t, int64_t to_t);
+
+// Turns "-from" and "-to" values (either may be NULL) into a range for
+// dataset_open_range; a "-to" date without a time includes that whole day.
+// Returns 0, or -1 with a message on stderr.
+int dataset_parse_range(const char *from, const char *to, int64_t *from_t, int64_t *to_t);
+
+// Opens `path` like dataset_open, but without parsing or widening
+// anything: a CSV starts with no rows indexed (see dataset_index_rows).
+// dataset_column returns NULL except for float64 binaries; read positions
+// with dataset_read_rows instead. Returns 0 on success.
+int dataset_open_lazy(struct Dataset *data, const char *path);
+
+// Indexes up to about `max_bytes` more of a lazily opened CSV, adding the
+// rows found to num_rows. Returns 1 once every row is indexed, else 0.
+int dataset_index_rows(struct Dataset *data, size_t max_bytes);
+
+// Copies rows [first, first + count) into `out`, row by row:
+// out[(r * num_bodies + body) * values_per_body + axis]. Works however the
+// dataset was opened. Returns 0, or -1 if the rows are not (yet) available.
+int dataset_read_rows(const struct Dataset *data, long first, long count, double *out);
+
+// Unmaps the file and releases every column.
+void dataset_close(struct Dataset *data);
+
+// Returns column `axis` (0 = x, 1 = y, 2 = z) of `body`: num_rows doubles.
+// Longitude tables only have axis 0.
+const double *dataset_column(const struct Dataset *data, int body, int axis);
+
+// Writes the date label of `row` into `out` (DATASET_DATE_LEN bytes).
+void dataset_date(const struct Dataset *data, long row, char *out);
+
+// Writes "YYYY-MM-DD HH:MM" for a fractional row (see events.h) into `out`
+// (DATASET_TIME_LEN bytes). Rows are one step apart: the binary header's
+// step, or the gap between neighbouring CSV labels.
+void dataset_time_label(const struct Dataset *data, double row, char *out);
+
+// Returns the index of the body called `name`, or -1.
+int dataset_find_body(const struct Dataset *data, const char *name);
+
+#endif // DATASET_H
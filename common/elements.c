@@ -0,0 +1,78 @@
+/**
+ * @file elements.c
+ * @brief Horizons orbital elements fetch implementation.
+ */
+
+#include <stdio.h>
+#include "elements.h"
+#include "fetch.h"
+#include "horizons_parse.h"
+#include "timebase.h"
+
+const struct ElementsBody ELEMENTS_PLANETS[ELEMENTS_NUM_PLANETS] = {
+    {"Mercury", "199"}, {"Venus", "299"}, {"Earth", "399"},
+    {"Mars", "499"}, {"Jupiter", "599"}, {"Saturn", "699"},
+    {"Uranus", "799"}, {"Neptune", "899"}, {"Pluto", "999"}
+};
+
+// Struct to hold the elements a streamed reply is written into.
+struct ElementCapture {
+    struct KeplerElements *elements;
+    int captured;
+};
+
+// Record callback for elements_fetch: values follow HORIZONS_ELEMENT_TAGS.
+static void store_elements(const double *values, void *userp) {
+    struct ElementCapture *capture = (struct ElementCapture *)userp;
+    if (capture->captured) return;
+    struct KeplerElements *elements = capture->elements;
+    elements->eccentricity = values[0];
+    elements->inclination_deg = values[1];
+    elements->lon_asc_node_deg = values[2];
+    elements->arg_periapsis_deg = values[3];
+    elements->mean_anomaly_deg = values[4];
+    // Convert Semi-major axis from km to AU
+    elements->semi_major_axis_au = values[5] / ELEMENTS_AU_KM;
+    capture->captured = 1;
+}
+
+int elements_fetch(const struct ElementsBody *body, int64_t epoch_t, int debug_mode, struct KeplerElements *out) {
+    char epoch_str[TIMEBASE_LABEL_LEN], next_day_str[TIMEBASE_LABEL_LEN];
+    timebase_format(epoch_t, 0, epoch_str);
+    timebase_format(epoch_t + TIMEBASE_SECONDS_PER_DAY, 0, next_day_str);
+
+    char url[512];
+    snprintf(url, sizeof(url),
+             "https://ssd.jpl.nasa.gov/api/horizons.api?format=text&COMMAND='%s'&OBJ_DATA='NO'&MAKE_EPHEM='YES'&EPHEM_TYPE='ELEMENTS'&CENTER='@sun'&START_TIME='%s'&STOP_TIME='%s'",
+             body->id, epoch_str, next_day_str);
+
+    // Stream the reply through the parser; only the first record is used.
+    struct ElementCapture capture = { out, 0 };
+    struct HorizonsParser parser;
+    horizons_parser_init(&parser, HORIZONS_FORMAT_TEXT, HORIZONS_ELEMENT_TAGS, 6,
+                         store_elements, &capture);
+    if (debug_mode) {
+        parser.echo = stdout;
+        printf("\n--- RAW API RESPONSE for %s ---\n", body->name);
+    }
+
+    int fetched = fetch_stream(url, &parser);
+    if (debug_mode) {
+        printf("\n-------------------------------------\n");
+    }
+
+    int success = -1;
+    if (capture.captured) {
+        out->epoch_day = (double)epoch_t / TIMEBASE_SECONDS_PER_DAY;
+        success = 0;
+    } else if (parser.in_data) {
+        int parsed_count = 0;
+        for (int t = 0; t < 6; t++) parsed_count += (parser.found_mask >> t) & 1;
+        fprintf(stderr, "  - Error: Could only parse %d of 6 orbital elements for %s.\n", parsed_count, body->name);
+    } else if (fetched == 0) {
+        fprintf(stderr, "  - Error: Could not find orbital elements for %s.\n", body->name);
+    } else {
+        fprintf(stderr, "  - Error: Could not find $$SOE marker for %s.\n", body->name);
+    }
+    return success;
+}
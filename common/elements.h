@@ -0,0 +1,35 @@
+/**
+ * @file elements.h
+ * @brief Osculating orbital elements of the planets from JPL Horizons.
+ *
+ * Fetches one ELEMENTS record per body through the shared fetch module, so
+ * replies come from the on-disk cache when possible (see cache.h), and
+ * turns it into the KeplerElements the propagator in kepler.h takes.
+ * kepler_sim, kepler_sim_3d and the visualizer's live mode propagate the
+ * same list of planets.
+ */
+
+#ifndef ELEMENTS_H
+#define ELEMENTS_H
+
+#include <stdint.h>
+#include "kepler.h"
+
+#define ELEMENTS_NUM_PLANETS 9
+#define ELEMENTS_AU_KM 149597870.7
+
+// A body by its Horizons command ID.
+struct ElementsBody {
+    const char *name;
+    const char *id;
+};
+
+// Mercury to Pluto, in order.
+extern const struct ElementsBody ELEMENTS_PLANETS[ELEMENTS_NUM_PLANETS];
+
+// Fetches the heliocentric elements of `body` valid at `epoch_t` (UTC Unix
+// seconds, a midnight) into `out`. With `debug_mode` the raw reply is echoed
+// to stdout. Returns 0, or -1 with a message on stderr.
+int elements_fetch(const struct ElementsBody *body, int64_t epoch_t, int debug_mode, struct KeplerElements *out);
+
+#endif // ELEMENTS_H
@@ -0,0 +1,213 @@
+/**
+ * @file ephemeris.c
+ * @brief Binary ephemeris reader and writer.
+ */
+
+#define _GNU_SOURCE
+#define _FILE_OFFSET_BITS 64
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include "ephemeris.h"
+#include "timebase.h"
+
+#define EPHEMERIS_ALIGN 64
+#define CONVERT_BLOCK 4096  // Values converted per float32 write
+
+// --- Header Encoding ---
+
+static void put_u32(unsigned char *p, uint32_t v) { memcpy(p, &v, 4); }
+static void put_i64(unsigned char *p, int64_t v) { memcpy(p, &v, 8); }
+static uint32_t get_u32(const unsigned char *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static int64_t get_i64(const unsigned char *p) { int64_t v; memcpy(&v, p, 8); return v; }
+
+static long data_offset_for(int num_bodies) {
+    long end = EPHEMERIS_HEADER_LEN + (long)num_bodies * EPHEMERIS_NAME_LEN;
+    return (end + EPHEMERIS_ALIGN - 1) / EPHEMERIS_ALIGN * EPHEMERIS_ALIGN;
+}
+
+static void encode_header(const struct EphemerisInfo *info, unsigned char *h) {
+    memset(h, 0, EPHEMERIS_HEADER_LEN);
+    memcpy(h, EPHEMERIS_MAGIC, 8);
+    put_u32(h + 8, EPHEMERIS_VERSION);
+    put_u32(h + 12, EPHEMERIS_BYTE_ORDER);
+    put_u32(h + 16, (uint32_t)info->num_bodies);
+    put_u32(h + 20, (uint32_t)info->value_size);
+    put_i64(h + 24, (int64_t)info->num_rows);
+    put_i64(h + 32, info->start_unix);
+    put_i64(h + 40, info->step_seconds);
+    put_u32(h + 48, (uint32_t)info->start_year);
+    put_u32(h + 52, (uint32_t)info->start_month);
+    put_u32(h + 56, (uint32_t)info->start_day);
+    put_u32(h + 60, (uint32_t)info->data_offset);
+}
+
+// Decodes the header of a `len`-byte file. The columns must fit in the file,
+// which is checked before any offset is computed from the row count.
+static int decode_header(struct EphemerisInfo *info, const unsigned char *h, size_t len, const char *path) {
+    if (memcmp(h, EPHEMERIS_MAGIC, 8) != 0) {
+        fprintf(stderr, "Error: %s is not a binary ephemeris.\n", path);
+        return -1;
+    }
+    if (get_u32(h + 12) != EPHEMERIS_BYTE_ORDER) {
+        fprintf(stderr, "Error: %s was written on a machine with a different byte order.\n", path);
+        return -1;
+    }
+    uint32_t version = get_u32(h + 8);
+    if (version != EPHEMERIS_VERSION) {
+        fprintf(stderr, "Error: %s uses ephemeris format version %u; this build reads version %d.\n",
+                path, version, EPHEMERIS_VERSION);
+        return -1;
+    }
+    info->version = (int)version;
+    info->num_bodies = (int)get_u32(h + 16);
+    info->value_size = (int)get_u32(h + 20);
+    info->num_rows = (long)get_i64(h + 24);
+    info->start_unix = get_i64(h + 32);
+    info->step_seconds = get_i64(h + 40);
+    info->start_year = (int32_t)get_u32(h + 48);
+    info->start_month = (int)get_u32(h + 52);
+    info->start_day = (int)get_u32(h + 56);
+    info->data_offset = (long)get_u32(h + 60);
+    if (info->num_bodies < 1 || info->num_bodies > EPHEMERIS_MAX_BODIES || info->num_rows < 0 ||
+        (info->value_size != 8 && info->value_size != 4) || info->step_seconds <= 0 ||
+        info->data_offset < EPHEMERIS_HEADER_LEN + (long)info->num_bodies * EPHEMERIS_NAME_LEN ||
+        info->data_offset % EPHEMERIS_ALIGN != 0) {   // Columns are mapped in place (see dataset.c)
+        fprintf(stderr, "Error: %s has a corrupt ephemeris header.\n", path);
+        return -1;
+    }
+    size_t row_bytes = (size_t)3 * info->num_bodies * info->value_size;
+    if ((size_t)info->data_offset > len || (size_t)info->num_rows > (len - info->data_offset) / row_bytes) {
+        fprintf(stderr, "Error: %s is truncated.\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+// Byte offset of row `row` in column (body, axis).
+static off_t column_offset(const struct EphemerisInfo *info, int body, int axis, long row) {
+    return (off_t)info->data_offset +
+           ((off_t)(body * 3 + axis) * info->num_rows + row) * info->value_size;
+}
+
+// --- Writer ---
+
+int ephemeris_writer_open(struct EphemerisWriter *writer, const char *path,
+                          const char *const names[], int num_bodies, long num_rows,
+                          int64_t start_unix, int64_t step_seconds, int value_size) {
+    if (num_bodies < 1 || num_bodies > EPHEMERIS_MAX_BODIES || (value_size != 8 && value_size != 4)) {
+        fprintf(stderr, "Error: Unsupported ephemeris layout.\n");
+        return -1;
+    }
+    struct EphemerisInfo *info = &writer->info;
+    memset(info, 0, sizeof(*info));
+    info->num_bodies = num_bodies;
+    for (int i = 0; i < num_bodies; i++) {
+        snprintf(info->names[i], EPHEMERIS_NAME_LEN, "%s", names[i]);
+    }
+    info->value_size = value_size;
+    info->num_rows = num_rows;
+    info->start_unix = start_unix;
+    info->step_seconds = step_seconds;
+    struct TimeLabel start;
+    time_label_init(&start, start_unix, 0);
+    info->version = EPHEMERIS_VERSION;
+    info->start_year = (int)start.year;
+    info->start_month = start.month;
+    info->start_day = start.day;
+    info->data_offset = data_offset_for(num_bodies);
+
+    writer->file = fopen(path, "wb");
+    if (writer->file == NULL) {
+        perror("Error opening output file");
+        return -1;
+    }
+
+    unsigned char header[EPHEMERIS_HEADER_LEN];
+    encode_header(info, header);
+    fwrite(header, 1, sizeof(header), writer->file);
+    fwrite(info->names, EPHEMERIS_NAME_LEN, num_bodies, writer->file);
+
+    // Pad to the first column and size the file, so columns can be filled
+    // in any order.
+    long pad = info->data_offset - (EPHEMERIS_HEADER_LEN + (long)num_bodies * EPHEMERIS_NAME_LEN);
+    static const char zeros[EPHEMERIS_ALIGN];
+    fwrite(zeros, 1, (size_t)pad, writer->file);
+    if (num_rows > 0) {
+        if (fseeko(writer->file, column_offset(info, num_bodies - 1, 2, num_rows) - 1, SEEK_SET) != 0 ||
+            fputc(0, writer->file) == EOF) {
+            perror("Error sizing output file");
+            fclose(writer->file);
+            writer->file = NULL;
+            return -1;
+        }
+    }
+    return ferror(writer->file) ? -1 : 0;
+}
+
+// Writes `rows` doubles to the file in the writer's value size.
+static int write_values(struct EphemerisWriter *writer, const double *values, int rows) {
+    if (writer->info.value_size == 8) {
+        return fwrite(values, sizeof(double), (size_t)rows, writer->file) == (size_t)rows ? 0 : -1;
+    }
+    float block[CONVERT_BLOCK];
+    for (int done = 0; done < rows; done += CONVERT_BLOCK) {
+        int n = rows - done < CONVERT_BLOCK ? rows - done : CONVERT_BLOCK;
+        for (int i = 0; i < n; i++) block[i] = (float)values[done + i];
+        if (fwrite(block, sizeof(float), (size_t)n, writer->file) != (size_t)n) return -1;
+    }
+    return 0;
+}
+
+int ephemeris_writer_put(struct EphemerisWriter *writer, long first_row, int rows,
+                         const double *x, const double *y, const double *z) {
+    const struct EphemerisInfo *info = &writer->info;
+    if (first_row < 0 || rows < 0 || first_row + rows > info->num_rows) return -1;
+    const double *axes[3] = {x, y, z};
+    for (int body = 0; body < info->num_bodies; body++) {
+        for (int axis = 0; axis < 3; axis++) {
+            if (fseeko(writer->file, column_offset(info, body, axis, first_row), SEEK_SET) != 0 ||
+                write_values(writer, axes[axis] + (size_t)body * rows, rows) != 0) {
+                perror("Error writing output file");
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int ephemeris_writer_close(struct EphemerisWriter *writer) {
+    if (writer->file == NULL) return -1;
+    int status = ferror(writer->file) ? -1 : 0;
+    if (fclose(writer->file) != 0) status = -1;
+    writer->file = NULL;
+    return status;
+}
+
+// --- Reader ---
+
+int ephemeris_decode(struct EphemerisInfo *info, const unsigned char *data, size_t len, const char *path) {
+    memset(info, 0, sizeof(*info));
+    if (len < EPHEMERIS_HEADER_LEN) {
+        fprintf(stderr, "Error: %s is truncated.\n", path);
+        return -1;
+    }
+    if (decode_header(info, data, len, path) != 0) return -1;
+    for (int i = 0; i < info->num_bodies; i++) {
+        memcpy(info->names[i], data + EPHEMERIS_HEADER_LEN + (size_t)i * EPHEMERIS_NAME_LEN, EPHEMERIS_NAME_LEN);
+        info->names[i][EPHEMERIS_NAME_LEN - 1] = '\0';
+    }
+    return 0;
+}
+
+// --- Dates ---
+
+int64_t ephemeris_row_time(const struct EphemerisInfo *info, long row) {
+    return info->start_unix + (int64_t)row * info->step_seconds;
+}
+
+void ephemeris_date(const struct EphemerisInfo *info, long row, char *out) {
+    int64_t start = ephemeris_row_time(info, 0);
+    timebase_format(ephemeris_row_time(info, row), timebase_has_time(start, info->step_seconds), out);
+}
@@ -0,0 +1,94 @@
+/**
+ * @file ephemeris.h
+ * @brief Compact, versioned binary ephemeris format.
+ *
+ * A binary alternative to the "Date,Body_x,Body_y,Body_z,..." CSV written by
+ * kepler_sim_3d. The file starts with a fixed 64-byte header:
+ *
+ *   offset  size  field
+ *        0     8  magic "PLEPHEM\n"
+ *        8     4  format version (EPHEMERIS_VERSION)
+ *       12     4  byte-order mark 0x01020304, written in host order
+ *       16     4  number of bodies
+ *       20     4  bytes per value: 8 (float64) or 4 (float32)
+ *       24     8  number of rows
+ *       32     8  time of row 0, Unix seconds
+ *       40     8  step between rows, seconds
+ *       48    12  UTC calendar date of row 0 (year, month, day)
+ *       60     4  offset of the first column from the start of the file
+ *
+ * It is followed by one EPHEMERIS_NAME_LEN byte, NUL-padded name per body.
+ * The data then starts on a 64-byte boundary as packed columns, body by
+ * body: all x values of body 0, then its y and z values, then body 1, and so
+ * on. Positions are heliocentric ecliptic coordinates in AU.
+ *
+ * Row k is at start + k * step in UTC (see common/timebase.h), so labels do
+ * not depend on the reading machine's time zone; sub-daily files label rows
+ * with the time of day as well. Files are read through common/dataset.h,
+ * which maps float64 columns straight from disk.
+ */
+
+#ifndef EPHEMERIS_H
+#define EPHEMERIS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define EPHEMERIS_MAGIC "PLEPHEM\n"
+#define EPHEMERIS_VERSION 2
+#define EPHEMERIS_BYTE_ORDER 0x01020304u
+#define EPHEMERIS_HEADER_LEN 64
+#define EPHEMERIS_NAME_LEN 32
+#define EPHEMERIS_MAX_BODIES 64
+#define EPHEMERIS_DATE_LEN 32
+
+// Everything the header describes.
+struct EphemerisInfo {
+    int version;
+    int num_bodies;
+    char names[EPHEMERIS_MAX_BODIES][EPHEMERIS_NAME_LEN];
+    int value_size;
+    long num_rows;
+    int64_t start_unix;
+    int64_t step_seconds;
+    int start_year, start_month, start_day;
+    long data_offset;
+};
+
+// Binary file being written; columns are filled in place, so the number of
+// rows must be known up front.
+struct EphemerisWriter {
+    FILE *file;
+    struct EphemerisInfo info;
+};
+
+// Creates `path` for `num_rows` rows of `num_bodies` bodies, row k at
+// start_unix + k * step_seconds (UTC). `value_size` is 8 for float64 or 4
+// for float32. Returns 0 on success.
+int ephemeris_writer_open(struct EphemerisWriter *writer, const char *path,
+                          const char *const names[], int num_bodies, long num_rows,
+                          int64_t start_unix, int64_t step_seconds, int value_size);
+
+// Stores rows [first_row, first_row + rows). The arrays are laid out per
+// body, like the kepler_batch_propagate output: x[body * rows + r].
+// Returns 0 on success.
+int ephemeris_writer_put(struct EphemerisWriter *writer, long first_row, int rows,
+                         const double *x, const double *y, const double *z);
+
+// Finishes and closes the file. Returns 0 on success.
+int ephemeris_writer_close(struct EphemerisWriter *writer);
+
+// Decodes and validates the header and body names at the start of a file
+// image of `len` bytes, checking that `len` covers every column. Returns 0
+// on success; errors naming `path` are reported on stderr.
+int ephemeris_decode(struct EphemerisInfo *info, const unsigned char *data, size_t len, const char *path);
+
+// Returns the time of `row` as UTC Unix seconds.
+int64_t ephemeris_row_time(const struct EphemerisInfo *info, long row);
+
+// Writes the label of `row` into `out` (EPHEMERIS_DATE_LEN bytes):
+// "YYYY-MM-DD", with " HH:MM" added for sub-daily files.
+void ephemeris_date(const struct EphemerisInfo *info, long row, char *out);
+
+#endif // EPHEMERIS_H
@@ -0,0 +1,301 @@
+/**
+ * @file events.c
+ * @brief Event engine implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "events.h"
+
+#define EVENT_LIST_INITIAL 256
+#define BRENT_MAX_ITERATIONS 100
+
+double event_wrap180(double degrees) {
+    double d = fmod(degrees, 360.0);
+    if (d > 180.0) d -= 360.0;
+    else if (d <= -180.0) d += 360.0;
+    return d;
+}
+
+// --- Root Finding ---
+
+double event_brent_root(double (*f)(double t, void *userp), void *userp,
+                        double a, double b, double fa, double fb, double tol) {
+    if (fa == 0) return a;
+    if (fb == 0) return b;
+
+    double c = a, fc = fa, d = b - a, e = d;
+    for (int iter = 0; iter < BRENT_MAX_ITERATIONS; iter++) {
+        if ((fb > 0) == (fc > 0)) {
+            c = a; fc = fa;
+            d = e = b - a;
+        }
+        if (fabs(fc) < fabs(fb)) {
+            a = b; b = c; c = a;
+            fa = fb; fb = fc; fc = fa;
+        }
+        double tol1 = 2.0 * 1e-16 * fabs(b) + 0.5 * tol;
+        double m = 0.5 * (c - b);
+        if (fabs(m) <= tol1 || fb == 0) return b;
+
+        if (fabs(e) >= tol1 && fabs(fa) > fabs(fb)) {
+            // Inverse quadratic interpolation (secant when only two points).
+            double p, q, s = fb / fa;
+            if (a == c) {
+                p = 2.0 * m * s;
+                q = 1.0 - s;
+            } else {
+                double r = fb / fc;
+                q = fa / fc;
+                p = s * (2.0 * m * q * (q - r) - (b - a) * (r - 1.0));
+                q = (q - 1.0) * (r - 1.0) * (s - 1.0);
+            }
+            if (p > 0) q = -q;
+            else p = -p;
+            if (2.0 * p < fmin(3.0 * m * q - fabs(tol1 * q), fabs(e * q))) {
+                e = d;
+                d = p / q;
+            } else {
+                d = m; e = m;   // Fall back to bisection
+            }
+        } else {
+            d = m; e = m;
+        }
+        a = b; fa = fb;
+        b += fabs(d) > tol1 ? d : (m > 0 ? tol1 : -tol1);
+        fb = f(b, userp);
+    }
+    return b;
+}
+
+int event_parabolic_vertex(double y0, double y1, double y2, double *offset, double *value) {
+    double curvature = y0 - 2.0 * y1 + y2;
+    if (!(curvature > 0)) return -1;
+    double x = 0.5 * (y0 - y2) / curvature;
+    if (x < -1.0) x = -1.0;
+    if (x > 1.0) x = 1.0;
+    *offset = x;
+    *value = y1 + 0.5 * x * (y2 - y0) + 0.5 * curvature * x * x;
+    return 0;
+}
+
+// --- Separation Scan ---
+
+// Catmull-Rom segment between p1 (t = 0) and p2 (t = 1).
+struct Segment {
+    double p0, p1, p2, p3;
+};
+
+static double segment_value(double t, void *userp) {
+    const struct Segment *s = userp;
+    double a = -s->p0 + 3.0 * s->p1 - 3.0 * s->p2 + s->p3;
+    double b = 2.0 * s->p0 - 5.0 * s->p1 + 4.0 * s->p2 - s->p3;
+    double c = -s->p0 + s->p2;
+    return s->p1 + 0.5 * t * (c + t * (b + t * a));
+}
+
+// Emits the near miss of a window whose closest sample is `best`, refining
+// it with a parabola through the neighbouring samples.
+static void emit_minimum(const struct SeparationTarget *st, double target, int aspect,
+                         separation_event_fn on_event, void *userp) {
+    double s1 = event_wrap180(st->around[1] - target);
+    double s0 = s1 + event_wrap180(event_wrap180(st->around[0] - target) - s1);
+    double s2 = s1 + event_wrap180(event_wrap180(st->around[2] - target) - s1);
+    double sign = s1 < 0 ? -1.0 : 1.0;
+
+    struct SeparationEvent event = {(double)st->best, s1, 0, aspect, target, -1, -1};
+    double offset, value;
+    if (event_parabolic_vertex(sign * s0, sign * s1, sign * s2, &offset, &value) == 0 && value > 0) {
+        event.row = st->best + offset;
+        event.separation = sign * value;
+    }
+    on_event(&event, userp);
+}
+
+void event_scan_init(struct SeparationScan *scan, const struct AspectTable *table) {
+    memset(scan, 0, sizeof(*scan));
+    scan->table = table;
+    for (int t = 0; t < table->num_targets; t++) {
+        scan->state[t].seen = scan->state[t].pending = -1;
+    }
+}
+
+void event_scan_set_origin(struct SeparationScan *scan, long row) {
+    scan->origin = scan->row = row;
+}
+
+// Classifies the row at the head of the queue. `lookahead` is how many of
+// the rows after it exist (0, 1 or 2), all of them already queued.
+static void scan_row(struct SeparationScan *scan, int lookahead, separation_event_fn on_event, void *userp) {
+    const struct AspectTable *table = scan->table;
+    struct SeparationTarget *state = scan->state;
+    long d = scan->row;
+    double raw = scan->queue[0];
+    double sigma = event_wrap180(raw);
+
+    // --- Near-miss windows: only the targets binned here can match ---
+    int bin = aspect_bin(sigma);
+    for (int k = table->orb_start[bin]; k < table->orb_start[bin + 1]; k++) {
+        int t = table->orb[k];
+        double s = fabs(event_wrap180(sigma - table->target_angle[t]));
+        if (s > table->aspects[table->target_aspect[t]].orb) continue;
+        struct SeparationTarget *st = &state[t];
+        if (!st->in_window || s < st->best_abs) {
+            if (!st->in_window) {
+                st->in_window = 1;
+                st->crossed = st->pending == d;
+                scan->active[scan->num_active++] = t;
+            }
+            st->best = d;
+            st->best_abs = s;
+            st->around[0] = scan->previous;
+            st->around[1] = raw;
+        }
+        st->seen = d;
+    }
+    for (int k = 0; k < scan->num_active;) {
+        int t = scan->active[k];
+        struct SeparationTarget *st = &state[t];
+        if (st->best == d - 1) st->around[2] = raw;
+        if (st->seen == d) {
+            k++;
+            continue;
+        }
+        if (!st->crossed && st->best > scan->origin) {
+            emit_minimum(st, table->target_angle[t], table->target_aspect[t], on_event, userp);
+        }
+        st->in_window = 0;
+        scan->active[k] = scan->active[--scan->num_active];
+    }
+    scan->row = d + 1;
+    scan->previous = raw;
+    if (lookahead == 0) return;
+
+    // --- Crossings between d and d + 1 ---
+    // Every target inside the swept arc is a candidate; the bins covering
+    // the arc list them.
+    double step = event_wrap180(scan->queue[1] - sigma);
+    double next_step = lookahead > 1 ? event_wrap180(scan->queue[2] - scan->queue[1]) : step;
+    double low = step < 0 ? sigma + step : sigma;
+    int first_bin = (int)floor(low + 180.0);
+    int num_bins = (int)floor(low + fabs(step) + 180.0) - first_bin + 1;
+
+    struct SeparationEvent crossings[ASPECT_MAX_TARGETS];
+    int num_crossings = 0;
+    for (int b = 0; b < num_bins; b++) {
+        int wrapped = ((first_bin + b) % ASPECT_BINS + ASPECT_BINS) % ASPECT_BINS;
+        for (int k = table->exact_start[wrapped]; k < table->exact_start[wrapped + 1]; k++) {
+            int t = table->exact[k];
+            double s = event_wrap180(sigma - table->target_angle[t]);
+            double next = s + step;
+            if (!((s < 0 && next >= 0) || (s > 0 && next <= 0) || (d == scan->origin && s == 0))) continue;
+
+            struct Segment segment;
+            segment.p1 = s;
+            segment.p2 = next;
+            segment.p0 = d > scan->origin ? s - scan->previous_step : 2.0 * s - next;
+            segment.p3 = lookahead > 1 ? next + next_step : 2.0 * next - s;
+            double root = event_brent_root(segment_value, &segment, 0.0, 1.0, s, next, EVENT_TOLERANCE);
+            struct SeparationEvent event = {d + root, 0.0, 1, table->target_aspect[t], table->target_angle[t], -1, -1};
+
+            // Keep this step's crossings in time order.
+            int at = num_crossings++;
+            while (at > 0 && crossings[at - 1].row > event.row) {
+                crossings[at] = crossings[at - 1];
+                at--;
+            }
+            crossings[at] = event;
+
+            if (state[t].in_window) state[t].crossed = 1;
+            else state[t].pending = d + 1;
+        }
+    }
+    for (int k = 0; k < num_crossings; k++) on_event(&crossings[k], userp);
+
+    scan->previous_step = step;
+}
+
+// Drops the scanned row from the head of the queue.
+static void pop_row(struct SeparationScan *scan) {
+    scan->queue[0] = scan->queue[1];
+    scan->queue[1] = scan->queue[2];
+    scan->queued--;
+}
+
+void event_scan_feed(struct SeparationScan *scan, const double *lon_a, const double *lon_b, long num_rows,
+                     separation_event_fn on_event, void *userp) {
+    if (scan->table->num_targets == 0) return;
+    for (long r = 0; r < num_rows; r++) {
+        scan->queue[scan->queued++] = lon_a[r] - lon_b[r];
+        if (scan->queued == 3) {
+            scan_row(scan, 2, on_event, userp);
+            pop_row(scan);
+        }
+    }
+}
+
+void event_scan_finish(struct SeparationScan *scan, separation_event_fn on_event, void *userp) {
+    while (scan->queued > 0) {
+        scan_row(scan, scan->queued - 1, on_event, userp);
+        pop_row(scan);
+    }
+    // Windows still open at the end of the data have no confirmed minimum.
+}
+
+int event_scan_quiet(const struct SeparationScan *scan) {
+    return scan->num_active == 0;
+}
+
+double event_scan_horizon(const struct SeparationScan *scan) {
+    double horizon = scan->row - 1.0;   // A crossing after the last row fed lands past it
+    for (int k = 0; k < scan->num_active; k++) {
+        double earliest = scan->state[scan->active[k]].best - 1.0;
+        if (earliest < horizon) horizon = earliest;
+    }
+    return horizon;
+}
+
+void event_scan_aspects(const double *lon_a, const double *lon_b, long num_rows,
+                        const struct AspectTable *table, separation_event_fn on_event, void *userp) {
+    struct SeparationScan scan;
+    event_scan_init(&scan, table);
+    event_scan_feed(&scan, lon_a, lon_b, num_rows, on_event, userp);
+    event_scan_finish(&scan, on_event, userp);
+}
+
+// --- Event List ---
+
+int event_list_push(struct EventList *list, const struct SeparationEvent *event) {
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : EVENT_LIST_INITIAL;
+        struct SeparationEvent *items = realloc(list->items, cap * sizeof(*items));
+        if (items == NULL) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            return -1;
+        }
+        list->items = items;
+        list->cap = cap;
+    }
+    list->items[list->count++] = *event;
+    return 0;
+}
+
+static int compare_events(const void *pa, const void *pb) {
+    const struct SeparationEvent *a = pa, *b = pb;
+    if (a->row != b->row) return a->row < b->row ? -1 : 1;
+    if (a->body_a != b->body_a) return a->body_a - b->body_a;
+    if (a->body_b != b->body_b) return a->body_b - b->body_b;
+    return (a->target > b->target) - (a->target < b->target);
+}
+
+void event_list_sort(struct EventList *list) {
+    if (list->count > 1) qsort(list->items, list->count, sizeof(*list->items), compare_events);
+}
+
+void event_list_free(struct EventList *list) {
+    free(list->items);
+    memset(list, 0, sizeof(*list));
+}
@@ -0,0 +1,134 @@
+/**
+ * @file events.h
+ * @brief Event engine for angular-separation searches.
+ *
+ * Instead of listing every sampled day on which two bodies are within a
+ * threshold, the engine treats the signed separation
+ *
+ *     s(t) = wrap180(lon_a(t) - lon_b(t) - target)
+ *
+ * as a continuous function of time, for every target of an aspect table
+ * (see aspects.h). Each sign change between two samples
+ * is one event, refined with Brent's method on a cubic (Catmull-Rom)
+ * interpolant of the unwrapped samples. A stretch that comes within the orb
+ * without crossing is reported once, at its parabolically refined minimum.
+ * As a result each event is printed once, at its exact time, however finely
+ * the data is sampled.
+ *
+ * Times are fractional row indices: row 12.25 is a quarter of a step after
+ * row 12 (see dataset_time_label).
+ *
+ * A SeparationScan runs the same search incrementally, over columns that
+ * arrive in batches (e.g. straight from a propagator). It keeps only the
+ * last few samples and the open windows, and finds exactly the events a
+ * single event_scan_aspects call over the whole columns would.
+ */
+
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stddef.h>
+#include "aspects.h"
+
+#define EVENT_TOLERANCE 1e-6   // Root tolerance, in rows
+#define EVENT_SCAN_LEAD_ROWS 4 // Rows after which a quiet scan no longer depends on where it started
+
+// One event found by event_scan_aspects.
+struct SeparationEvent {
+    double row;          // Fractional row index of the event
+    double separation;   // s(t) at the event: 0 for crossings, else the minimum
+    int crossing;        // 1 = exact crossing of the target, 0 = near miss
+    int aspect;          // Index into the AspectTable
+    double target;       // Signed target angle the separation is measured from
+    int body_a, body_b;  // Filled in by the caller (-1 from the scan)
+};
+
+typedef void (*separation_event_fn)(const struct SeparationEvent *event, void *userp);
+
+// Growable list of events, e.g. to merge several scans in time order.
+struct EventList {
+    struct SeparationEvent *items;
+    size_t count;
+    size_t cap;
+};
+
+// Near-miss window state of one signed target (internal to the scan).
+struct SeparationTarget {
+    int in_window;
+    int crossed;          // The window already produced a crossing
+    long seen;            // Last row inside the orb
+    long pending;         // Row just after a crossing that preceded the window
+    long best;
+    double best_abs;
+    double around[3];     // lon_a - lon_b at best - 1, best and best + 1
+};
+
+// Incremental scan of one pair of longitude columns.
+struct SeparationScan {
+    const struct AspectTable *table;
+    long origin;             // Row the data starts at
+    long row;                // Next row to classify
+    double queue[3];         // lon_a - lon_b of rows row .. row + 2 received so far
+    int queued;
+    double previous;         // lon_a - lon_b at row - 1
+    double previous_step;    // Unwrapped step of the wrapped separation into `row`
+    struct SeparationTarget state[ASPECT_MAX_TARGETS];
+    int active[ASPECT_MAX_TARGETS];
+    int num_active;
+};
+
+// Wraps an angle in degrees into (-180, 180].
+double event_wrap180(double degrees);
+
+// Finds a root of f in [a, b] with Brent's method, given f(a) = fa and
+// f(b) = fb of opposite sign (or zero). Stops once the bracket is below `tol`.
+double event_brent_root(double (*f)(double t, void *userp), void *userp,
+                        double a, double b, double fa, double fb, double tol);
+
+// Fits a parabola through (-1, y0), (0, y1), (1, y2). If it opens upwards,
+// stores the vertex offset (clamped to [-1, 1]) and value and returns 0;
+// otherwise returns -1.
+int event_parabolic_vertex(double y0, double y1, double y2, double *offset, double *value);
+
+// Scans two longitude columns (degrees) for crossings of every aspect in
+// `table` and for near misses within each aspect's orb, in a single pass.
+// Each sample is classified through the table's bins, so the cost barely
+// grows with the number of aspects. Events of different aspects are emitted
+// as they are confirmed: crossings at once, near misses when their window
+// closes, so callers that need strict time order sort afterwards.
+void event_scan_aspects(const double *lon_a, const double *lon_b, long num_rows,
+                        const struct AspectTable *table, separation_event_fn on_event, void *userp);
+
+// Starts an incremental scan against `table`, which must outlive it.
+void event_scan_init(struct SeparationScan *scan, const struct AspectTable *table);
+
+// Numbers the rows from `row` instead of 0, for a scan over data that
+// starts part-way through a run (see chunk_scan.h). Call before feeding.
+void event_scan_set_origin(struct SeparationScan *scan, long row);
+
+// Feeds the next `num_rows` rows of both columns. Events whose time is
+// already settled are emitted; row numbers continue across calls.
+void event_scan_feed(struct SeparationScan *scan, const double *lon_a, const double *lon_b, long num_rows,
+                     separation_event_fn on_event, void *userp);
+
+// Marks the end of the data, emitting the events of the last rows.
+void event_scan_finish(struct SeparationScan *scan, separation_event_fn on_event, void *userp);
+
+// Returns 1 if no near-miss window is open, so the scan's state depends
+// only on the last EVENT_SCAN_LEAD_ROWS rows fed.
+int event_scan_quiet(const struct SeparationScan *scan);
+
+// Returns the earliest row a later event of this scan can still be placed
+// at, so callers can release everything before it in time order.
+double event_scan_horizon(const struct SeparationScan *scan);
+
+// Appends a copy of `event`. Returns 0, or -1 if out of memory.
+int event_list_push(struct EventList *list, const struct SeparationEvent *event);
+
+// Sorts the list by time (ties keep body order stable).
+void event_list_sort(struct EventList *list);
+
+// Releases the list.
+void event_list_free(struct EventList *list);
+
+#endif // EVENTS_H
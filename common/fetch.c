@@ -0,0 +1,156 @@
+/**
+ * @file fetch.c
+ * @brief Pooled, connection-sharing HTTP fetch implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fetch.h"
+
+#define FETCH_POOL_SIZE 64
+
+static CURLSH *share = NULL;
+static CURL *pool[FETCH_POOL_SIZE];
+static int pool_count = 0;
+
+static struct StatsEntry http_requests = STATS_ENTRY("http.request", STATS_TIMER, "ns");
+static struct StatsEntry http_bytes = STATS_ENTRY("http.bytes", STATS_COUNTER, "bytes");
+static struct StatsEntry cache_hits = STATS_ENTRY("http.cache_hits", STATS_COUNTER, "replies");
+static struct StatsEntry parse_time = STATS_ENTRY("horizons.parse", STATS_TIMER, "ns");
+
+int fetch_init(void) {
+    if (curl_global_init(CURL_GLOBAL_ALL) != CURLE_OK) return -1;
+
+    share = curl_share_init();
+    if (!share) return -1;
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    return cache_init();
+}
+
+void fetch_cleanup(void) {
+    for (int i = 0; i < pool_count; i++) {
+        curl_easy_cleanup(pool[i]);
+    }
+    pool_count = 0;
+    if (share) {
+        curl_share_cleanup(share);
+        share = NULL;
+    }
+    curl_global_cleanup();
+}
+
+// Applies the options every Horizons request uses.
+static void configure_handle(CURL *handle) {
+    const char *ca_bundle = getenv("FETCH_CA_BUNDLE");
+
+    curl_easy_setopt(handle, CURLOPT_SHARE, share);
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 1L);
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, 2L);
+    if (ca_bundle && *ca_bundle) curl_easy_setopt(handle, CURLOPT_CAINFO, ca_bundle);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, fetch_stream_callback);
+}
+
+CURL *fetch_handle_acquire(void) {
+    if (pool_count > 0) return pool[--pool_count];
+
+    CURL *handle = curl_easy_init();
+    if (handle) configure_handle(handle);
+    return handle;
+}
+
+void fetch_handle_release(CURL *handle) {
+    if (!handle) return;
+    if (pool_count < FETCH_POOL_SIZE) {
+        pool[pool_count++] = handle;
+    } else {
+        curl_easy_cleanup(handle);
+    }
+}
+
+int fetch_stream_begin(struct FetchStream *stream, const char *url, struct HorizonsParser *parser) {
+    stream->parser = parser;
+    stream->cache.file = NULL;
+    stream->bytes = 0;
+
+    FILE *cached = cache_open(url);
+    if (cached) {
+        char buf[16384];
+        size_t n;
+        int64_t start = STATS_START();
+        while ((n = fread(buf, 1, sizeof(buf), cached)) > 0) {
+            horizons_parser_feed(parser, buf, n);
+        }
+        fclose(cached);
+        horizons_parser_finish(parser);
+        STATS_STOP(parse_time, start);
+        if (parser->done) {
+            STATS_ADD(cache_hits, 1);
+            return 1;
+        }
+        // A truncated entry is useless; drop it and fall back to the network.
+        cache_invalidate(url);
+        horizons_parser_init(parser, parser->format, parser->tags, parser->num_tags,
+                             parser->on_record, parser->userp);
+    }
+    if (cache_offline()) {
+        fprintf(stderr, "  - Error: Offline mode and no cached response for request.\n");
+        return -1;
+    }
+    cache_writer_open(&stream->cache, url);
+    stream->started = STATS_START();
+    return 0;
+}
+
+size_t fetch_stream_callback(void *contents, size_t size, size_t nmemb, void *userp) {
+    size_t realsize = size * nmemb;
+    struct FetchStream *stream = (struct FetchStream *)userp;
+    if (stream->cache.file && cache_writer_write(&stream->cache, contents, realsize) != 0) {
+        cache_writer_abort(&stream->cache);
+    }
+    stream->bytes += realsize;
+    int64_t start = STATS_START();
+    horizons_parser_feed(stream->parser, (const char *)contents, realsize);
+    STATS_STOP(parse_time, start);
+    return realsize;
+}
+
+int fetch_stream_end(struct FetchStream *stream, int transfer_ok) {
+    horizons_parser_finish(stream->parser);
+    STATS_STOP(http_requests, stream->started);
+    STATS_ADD(http_bytes, stream->bytes);
+    int complete = transfer_ok && stream->parser->done;
+    if (complete) {
+        cache_writer_commit(&stream->cache);
+    } else {
+        cache_writer_abort(&stream->cache);
+    }
+    return complete ? 0 : -1;
+}
+
+int fetch_stream(const char *url, struct HorizonsParser *parser) {
+    struct FetchStream stream;
+    int started = fetch_stream_begin(&stream, url, parser);
+    if (started != 0) return started == 1 ? 0 : -1;
+
+    CURL *handle = fetch_handle_acquire();
+    if (!handle) {
+        cache_writer_abort(&stream.cache);
+        return -1;
+    }
+    curl_easy_setopt(handle, CURLOPT_URL, url);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, (void *)&stream);
+
+    CURLcode res = curl_easy_perform(handle);
+    if (res != CURLE_OK) {
+        fprintf(stderr, "  - Error: Request failed: %s\n", curl_easy_strerror(res));
+    }
+    fetch_handle_release(handle);
+    return fetch_stream_end(&stream, res == CURLE_OK);
+}
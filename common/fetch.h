@@ -0,0 +1,76 @@
+/**
+ * @file fetch.h
+ * @brief Shared HTTP fetch module for the NASA JPL Horizons tools.
+ *
+ * All tools that talk to ssd.jpl.nasa.gov go through this module. It keeps a
+ * small pool of configured CURL easy handles alive for the whole run and
+ * shares DNS, TLS session and connection caches between them through a
+ * CURLSH object, so repeated requests reuse the same keep-alive connection
+ * instead of paying a fresh TCP connect and TLS handshake every time.
+ *
+ * TLS peer and host verification are enabled. Set FETCH_CA_BUNDLE to point
+ * at a CA bundle if the system default store is not suitable.
+ *
+ * Replies are streamed chunk by chunk into a HorizonsParser, so memory use
+ * does not grow with the size of the reply. Streams are answered from the
+ * on-disk response cache (cache.h) when possible, and complete ephemeris
+ * replies are written back to it as they arrive.
+ *
+ * With -stats (see stats.h), each transfer's latency and bytes, cache hits
+ * and the time spent parsing replies are counted.
+ *
+ * The module is not thread-safe; call it from one thread only.
+ */
+
+#ifndef FETCH_H
+#define FETCH_H
+
+#include <stddef.h>
+#include <curl/curl.h>
+#include "cache.h"
+#include "horizons_parse.h"
+#include "stats.h"
+
+// Struct to hold a reply being streamed into a parser, teed to the cache.
+struct FetchStream {
+    struct HorizonsParser *parser;
+    struct CacheWriter cache;
+    size_t bytes;       // Received so far
+    int64_t started;    // STATS_START() of the transfer
+};
+
+// Initialises libcurl, the shared handle pool and the response cache.
+// Returns 0 on success.
+int fetch_init(void);
+
+// Releases every pooled handle, the share object and libcurl itself.
+void fetch_cleanup(void);
+
+// Takes a configured handle from the pool (creating one if the pool is
+// empty). The caller sets CURLOPT_URL and CURLOPT_WRITEDATA; the write
+// function defaults to fetch_stream_callback.
+CURL *fetch_handle_acquire(void);
+
+// Returns a handle to the pool so its connection can be reused.
+void fetch_handle_release(CURL *handle);
+
+// Starts streaming `url` into `parser`. Returns 1 if the reply was served
+// from the cache (the parser has already seen all of it), 0 if a transfer
+// is needed (point CURLOPT_WRITEFUNCTION at fetch_stream_callback with the
+// stream as CURLOPT_WRITEDATA, then call fetch_stream_end), or -1 in
+// offline mode on a cache miss.
+int fetch_stream_begin(struct FetchStream *stream, const char *url, struct HorizonsParser *parser);
+
+// Write callback that feeds a struct FetchStream.
+size_t fetch_stream_callback(void *contents, size_t size, size_t nmemb, void *userp);
+
+// Completes a transfer started by fetch_stream_begin. The reply is cached
+// only if the transfer succeeded and the parser reached $$EOE. Returns 0 if
+// the parser saw a complete table, -1 otherwise.
+int fetch_stream_end(struct FetchStream *stream, int transfer_ok);
+
+// Blocking fetch of `url` streamed into `parser` using a pooled handle.
+// Returns 0 if a complete table was parsed, -1 otherwise.
+int fetch_stream(const char *url, struct HorizonsParser *parser);
+
+#endif // FETCH_H
@@ -0,0 +1,68 @@
+/**
+ * @file frame_store.c
+ * @brief Columnar analysis store implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "frame_store.h"
+#include "stats.h"
+
+static struct StatsEntry longitude_time = STATS_ENTRY("frame_store.longitudes", STATS_TIMER, "ns");
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void frame_store_init(struct FrameStore *store, int num_bodies, long num_rows,
+                      const double *const x[], const double *const y[], const double *const z[]) {
+    memset(store, 0, sizeof(*store));
+    if (num_bodies > FRAME_STORE_MAX_BODIES) num_bodies = FRAME_STORE_MAX_BODIES;
+    store->num_bodies = num_bodies;
+    store->num_rows = num_rows;
+    for (int b = 0; b < num_bodies; b++) {
+        store->x[b] = x[b];
+        store->y[b] = y[b];
+        store->z[b] = z[b];
+    }
+}
+
+void frame_store_from_dataset(struct FrameStore *store, const struct Dataset *data) {
+    const double *x[FRAME_STORE_MAX_BODIES], *y[FRAME_STORE_MAX_BODIES], *z[FRAME_STORE_MAX_BODIES];
+    for (int b = 0; b < data->num_bodies; b++) {
+        x[b] = dataset_column(data, b, 0);
+        y[b] = dataset_column(data, b, 1);
+        z[b] = dataset_column(data, b, 2);
+    }
+    frame_store_init(store, data->num_bodies, data->num_rows, x, y, z);
+}
+
+const double *frame_store_longitudes(struct FrameStore *store, int body) {
+    if (store->longitudes[body]) return store->longitudes[body];
+
+    double *lon = malloc((store->num_rows > 0 ? store->num_rows : 1) * sizeof(double));
+    if (lon == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return NULL;
+    }
+    int64_t start = STATS_START();
+    const double *x = store->x[body], *y = store->y[body];
+    for (long d = 0; d < store->num_rows; d++) {
+        double l = atan2(y[d], x[d]) * 180.0 / M_PI;
+        if (l < 0) l += 360;
+        lon[d] = l;
+    }
+    store->longitudes[body] = lon;
+    STATS_STOP(longitude_time, start);
+    return lon;
+}
+
+void frame_store_free(struct FrameStore *store) {
+    for (int b = 0; b < store->num_bodies; b++) {
+        free(store->longitudes[b]);
+        store->longitudes[b] = NULL;
+    }
+}
@@ -0,0 +1,42 @@
+/**
+ * @file frame_store.h
+ * @brief Columnar (structure-of-arrays) analysis store.
+ *
+ * Keeps each body's x, y, z and ecliptic longitude as contiguous columns of
+ * doubles, so an analysis pass is a linear scan over memory. The position
+ * columns are views (e.g. of a Dataset, or of a simulation window); the
+ * longitude column of a body is computed the first time it is asked for and
+ * cached for every later query.
+ */
+
+#ifndef FRAME_STORE_H
+#define FRAME_STORE_H
+
+#include "dataset.h"
+
+#define FRAME_STORE_MAX_BODIES DATASET_MAX_BODIES
+
+struct FrameStore {
+    int num_bodies;
+    long num_rows;
+    const double *x[FRAME_STORE_MAX_BODIES];
+    const double *y[FRAME_STORE_MAX_BODIES];
+    const double *z[FRAME_STORE_MAX_BODIES];
+    double *longitudes[FRAME_STORE_MAX_BODIES];  // NULL until computed
+};
+
+// Sets up a store over `num_rows` rows of caller-owned position columns.
+void frame_store_init(struct FrameStore *store, int num_bodies, long num_rows,
+                      const double *const x[], const double *const y[], const double *const z[]);
+
+// Sets up a store over every body of an open dataset.
+void frame_store_from_dataset(struct FrameStore *store, const struct Dataset *data);
+
+// Returns the body's heliocentric ecliptic longitudes in degrees, [0, 360),
+// computing and caching them on first use. Returns NULL if out of memory.
+const double *frame_store_longitudes(struct FrameStore *store, int body);
+
+// Releases the cached longitude columns (the position columns are not owned).
+void frame_store_free(struct FrameStore *store);
+
+#endif // FRAME_STORE_H
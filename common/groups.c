@@ -0,0 +1,250 @@
+/**
+ * @file groups.c
+ * @brief Multi-body alignment window implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "groups.h"
+#include "events.h"
+
+// One run of consecutive rows on which the same cluster forms.
+struct GroupWindow {
+    uint64_t key;         // cluster_key of the members
+    int *members;         // Body indices, ascending
+    int count;
+    long start, last;     // First and latest row of the run
+    long best;            // Row with the smallest spread
+    double best_spread;
+    double before, after; // Spreads at best - 1 and best + 1, when known
+    int has_before, has_after;
+};
+
+// A cluster found on the current row, its members in GroupClusters.pool.
+struct GroupCluster {
+    uint64_t key;
+    double spread;
+    size_t first;
+    int count;
+};
+
+// Every cluster found on the current row.
+struct GroupClusters {
+    struct GroupCluster *items;
+    size_t count, cap;
+    int *pool;
+    size_t pool_len, pool_cap;
+};
+
+static int compare_ints(const void *pa, const void *pb) {
+    int a = *(const int *)pa, b = *(const int *)pb;
+    return (a > b) - (a < b);
+}
+
+static int compare_clusters(const void *pa, const void *pb) {
+    const struct GroupCluster *a = pa, *b = pb;
+    return (a->key > b->key) - (a->key < b->key);
+}
+
+// Grows `*items` (of `size`-byte elements) to hold at least `need`. Returns 0,
+// or -1 if out of memory.
+static int grow(void **items, size_t *cap, size_t need, size_t size) {
+    if (need <= *cap) return 0;
+    size_t grown = *cap ? *cap : 64;
+    while (grown < need) grown *= 2;
+    void *p = realloc(*items, grown * size);
+    if (p == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    *items = p;
+    *cap = grown;
+    return 0;
+}
+
+static int collect_cluster(const struct Cluster *cluster, void *userp) {
+    struct GroupClusters *day = userp;
+    if (grow((void **)&day->items, &day->cap, day->count + 1, sizeof(*day->items)) != 0 ||
+        grow((void **)&day->pool, &day->pool_cap, day->pool_len + cluster->count, sizeof(int)) != 0) {
+        return -1;
+    }
+    struct GroupCluster *item = &day->items[day->count++];
+    item->key = cluster->key;
+    item->spread = cluster->spread;
+    item->first = day->pool_len;
+    item->count = cluster->count;
+    memcpy(day->pool + day->pool_len, cluster->members, cluster->count * sizeof(int));
+    day->pool_len += cluster->count;
+    return 0;
+}
+
+// Arc spanned by the members of `window` at the given longitudes.
+static double window_spread(const struct GroupWindow *window, const double *longitudes) {
+    double scratch[GROUP_MAX_BODIES];
+    for (int k = 0; k < window->count; k++) scratch[k] = longitudes[window->members[k]];
+    return cluster_arc(scratch, window->count);
+}
+
+// Reports a closed window, refining its tightest row when it is a true
+// local minimum whose vertex lies inside the window, and releases its
+// members.
+static int close_window(struct GroupWindow *window, group_event_fn fn, void *userp) {
+    struct GroupEvent event = {(double)window->best, window->best_spread, window->members, window->count,
+                               window->start, window->last, window->key};
+    double offset, value;
+    if (window->has_before && window->has_after &&
+        window->before >= window->best_spread && window->after >= window->best_spread &&
+        event_parabolic_vertex(window->before, window->best_spread, window->after, &offset, &value) == 0 &&
+        value >= 0 && window->best + offset >= window->start && window->best + offset <= window->last) {
+        event.row = window->best + offset;
+        event.spread = value;
+    }
+    int status = fn(&event, userp);
+    free(window->members);
+    window->members = NULL;
+    return status;
+}
+
+int group_tracker_init(struct GroupTracker *tracker, int num_bodies, double width, int min_size) {
+    memset(tracker, 0, sizeof(*tracker));
+    if (num_bodies > GROUP_MAX_BODIES) num_bodies = GROUP_MAX_BODIES;
+    tracker->num_bodies = num_bodies;
+    tracker->width = width;
+    tracker->min_size = min_size < 2 ? 2 : min_size;
+    tracker->day = calloc(1, sizeof(*tracker->day));
+    if (tracker->day == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    if (cluster_sweep_init(&tracker->sweep, num_bodies) != 0) {
+        free(tracker->day);
+        tracker->day = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Matches one row's clusters by key against the windows still open from the
+// row before; both lists are kept sorted by key. `current` is NULL past the
+// last row, which closes every window.
+static int track_row(struct GroupTracker *tracker, const double *current, group_event_fn fn, void *userp) {
+    struct GroupClusters *day = tracker->day;
+    long d = tracker->row;
+    int status = 0;
+
+    day->count = 0;
+    day->pool_len = 0;
+    if (current) {
+        status = cluster_sweep_run(&tracker->sweep, current, tracker->num_bodies, tracker->width,
+                                   tracker->min_size, collect_cluster, day);
+        if (status != 0) return status;
+        qsort(day->items, day->count, sizeof(*day->items), compare_clusters);
+    }
+    if (grow((void **)&tracker->next, &tracker->next_cap, day->count, sizeof(*tracker->next)) != 0) return -1;
+
+    struct GroupWindow *open = tracker->open, *next = tracker->next;
+    size_t num_open = tracker->num_open, a = 0, t = 0, kept = 0;
+    while (a < num_open || t < day->count) {
+        if (t == day->count || (a < num_open && open[a].key < day->items[t].key)) {
+            // Not formed on this row: the run is over.
+            struct GroupWindow *window = &open[a++];
+            if (current && window->best == d - 1) {
+                window->after = window_spread(window, current);
+                window->has_after = 1;
+            }
+            int closed = close_window(window, fn, userp);
+            if (status == 0) status = closed;
+        } else if (a < num_open && open[a].key == day->items[t].key) {
+            struct GroupWindow *window = &open[a++];
+            if (window->best == d - 1) {
+                window->after = window_spread(window, current);
+                window->has_after = 1;
+            }
+            if (day->items[t].spread < window->best_spread) {
+                window->best = d;
+                window->best_spread = day->items[t].spread;
+                window->before = window_spread(window, tracker->previous);
+                window->has_before = 1;
+                window->has_after = 0;
+            }
+            window->last = d;
+            next[kept++] = *window;
+            t++;
+        } else {
+            const struct GroupCluster *item = &day->items[t++];
+            struct GroupWindow window = {item->key, malloc(item->count * sizeof(int)), item->count,
+                                         d, d, d, item->spread, 0, 0, 0, 0};
+            if (window.members == NULL) {
+                fprintf(stderr, "Error: Out of memory.\n");
+                status = -1;
+                continue;
+            }
+            memcpy(window.members, day->pool + item->first, item->count * sizeof(int));
+            qsort(window.members, item->count, sizeof(int), compare_ints);
+            if (d > tracker->origin) {
+                window.before = window_spread(&window, tracker->previous);
+                window.has_before = 1;
+            }
+            next[kept++] = window;
+        }
+    }
+
+    tracker->open = next;
+    tracker->next = open;
+    size_t open_cap = tracker->open_cap;
+    tracker->open_cap = tracker->next_cap;
+    tracker->next_cap = open_cap;
+    tracker->num_open = kept;
+    if (current) {
+        memcpy(tracker->previous, current, (size_t)tracker->num_bodies * sizeof(double));
+        tracker->row++;
+    }
+    return status;
+}
+
+int group_tracker_feed(struct GroupTracker *tracker, const double *const longitudes[], long num_rows,
+                       group_event_fn fn, void *userp) {
+    double current[GROUP_MAX_BODIES];
+    for (long r = 0; r < num_rows; r++) {
+        for (int i = 0; i < tracker->num_bodies; i++) current[i] = longitudes[i][r];
+        int status = track_row(tracker, current, fn, userp);
+        if (status != 0) return status;
+    }
+    return 0;
+}
+
+int group_tracker_finish(struct GroupTracker *tracker, group_event_fn fn, void *userp) {
+    return track_row(tracker, NULL, fn, userp);
+}
+
+void group_tracker_set_origin(struct GroupTracker *tracker, long row) {
+    tracker->origin = tracker->row = row;
+}
+
+int group_tracker_quiet(const struct GroupTracker *tracker) {
+    return tracker->num_open == 0;
+}
+
+double group_tracker_horizon(const struct GroupTracker *tracker) {
+    double horizon = tracker->row - 1.0;
+    for (size_t k = 0; k < tracker->num_open; k++) {
+        double earliest = tracker->open[k].best - 1.0;
+        if (earliest < horizon) horizon = earliest;
+    }
+    return horizon;
+}
+
+void group_tracker_free(struct GroupTracker *tracker) {
+    for (size_t k = 0; k < tracker->num_open; k++) free(tracker->open[k].members);
+    free(tracker->open);
+    free(tracker->next);
+    if (tracker->day) {
+        free(tracker->day->items);
+        free(tracker->day->pool);
+        free(tracker->day);
+    }
+    cluster_sweep_free(&tracker->sweep);
+    memset(tracker, 0, sizeof(*tracker));
+}
@@ -0,0 +1,83 @@
+/**
+ * @file groups.h
+ * @brief Multi-body alignment windows tracked from row to row.
+ *
+ * Each row's longitudes are swept for clusters (see clusters.h). A cluster
+ * that forms on consecutive rows is one window. When it breaks up, the
+ * window is reported once, at its tightest moment. That moment is refined
+ * with a parabola through the neighbouring spreads when it is a true local
+ * minimum.
+ *
+ * Rows can be fed in batches of any size. Only the open windows and the
+ * previous row's longitudes are kept, so memory does not grow with the
+ * length of the data, and the windows found do not depend on the batching.
+ */
+
+#ifndef GROUPS_H
+#define GROUPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "clusters.h"
+#include "dataset.h"
+
+#define GROUP_MAX_BODIES DATASET_MAX_BODIES
+#define GROUP_TRACKER_LEAD_ROWS 1   // Rows after which a quiet tracker no longer depends on where it started
+
+// A finished window, placed at its refined tightest moment. Valid for the
+// duration of the callback.
+struct GroupEvent {
+    double row;            // Fractional row index (see dataset_time_label)
+    double spread;         // Arc spanned by the members then, degrees
+    const int *members;    // Body indices, ascending
+    int count;
+    long start, last;      // First and last row of the run
+    uint64_t key;          // cluster_key of the members
+};
+
+typedef int (*group_event_fn)(const struct GroupEvent *event, void *userp);
+
+struct GroupWindow;
+struct GroupClusters;
+
+struct GroupTracker {
+    int num_bodies;
+    double width;                 // Arc the members must fit in, degrees
+    int min_size;
+    long origin;                  // Row the data starts at
+    long row;                     // Next row to consume
+    struct ClusterSweep sweep;
+    struct GroupWindow *open, *next;   // Open windows, sorted by key
+    size_t num_open, open_cap, next_cap;
+    struct GroupClusters *day;    // Clusters of the current row
+    double previous[GROUP_MAX_BODIES];   // Longitudes of the previous row
+};
+
+// Starts tracking clusters of at least `min_size` (>= 2) of `num_bodies`
+// bodies within `width` degrees. Returns 0, or -1 if out of memory.
+int group_tracker_init(struct GroupTracker *tracker, int num_bodies, double width, int min_size);
+
+// Numbers the rows from `row` instead of 0, for a tracker over data that
+// starts part-way through a run (see chunk_scan.h). Call before feeding.
+void group_tracker_set_origin(struct GroupTracker *tracker, long row);
+
+// Feeds the next `num_rows` rows of every body's longitude column (degrees,
+// [0, 360)). Windows that close are passed to `fn` in no particular order.
+// Returns 0, fn's value if it is non-zero, or -1 if out of memory.
+int group_tracker_feed(struct GroupTracker *tracker, const double *const longitudes[], long num_rows,
+                       group_event_fn fn, void *userp);
+
+// Marks the end of the data, closing every window still open.
+int group_tracker_finish(struct GroupTracker *tracker, group_event_fn fn, void *userp);
+
+// Returns 1 if no window is open, so the tracker's state depends only on
+// the last row fed.
+int group_tracker_quiet(const struct GroupTracker *tracker);
+
+// Returns the earliest row a later event can still be placed at.
+double group_tracker_horizon(const struct GroupTracker *tracker);
+
+// Releases the tracker.
+void group_tracker_free(struct GroupTracker *tracker);
+
+#endif // GROUPS_H
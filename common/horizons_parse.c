@@ -0,0 +1,103 @@
+/**
+ * @file horizons_parse.c
+ * @brief Streaming Horizons reply parser implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "horizons_parse.h"
+
+const char *const HORIZONS_VECTOR_TAGS[3] = { "X =", "Y =", "Z =" };
+const char *const HORIZONS_ELEMENT_TAGS[6] = { "EC=", "IN=", "OM=", "W =", "MA=", "A =" };
+
+void horizons_parser_init(struct HorizonsParser *parser, enum HorizonsFormat format,
+                          const char *const *tags, int num_tags,
+                          horizons_record_fn on_record, void *userp) {
+    memset(parser, 0, sizeof(*parser));
+    parser->format = format;
+    parser->tags = tags;
+    parser->num_tags = num_tags > HORIZONS_MAX_TAGS ? HORIZONS_MAX_TAGS : num_tags;
+    parser->on_record = on_record;
+    parser->userp = userp;
+}
+
+// Handles one complete line of (unescaped) reply text.
+static void process_line(struct HorizonsParser *parser) {
+    char *line = parser->line;
+    line[parser->line_len] = '\0';
+    parser->line_len = 0;
+
+    if (!parser->in_data) {
+        if (strstr(line, "$$SOE")) parser->in_data = 1;
+        return;
+    }
+    if (strstr(line, "$$EOE")) {
+        parser->done = 1;
+        return;
+    }
+
+    unsigned all = (1u << parser->num_tags) - 1;
+    for (int t = 0; t < parser->num_tags; t++) {
+        if (parser->found_mask & (1u << t)) continue;
+        char *ptr = strstr(line, parser->tags[t]);
+        if (!ptr) continue;
+        char *value_start = ptr + strlen(parser->tags[t]);
+        char *value_end;
+        double value = strtod(value_start, &value_end);
+        if (value_end == value_start) continue;
+        parser->values[t] = value;
+        parser->found_mask |= 1u << t;
+    }
+    if (parser->found_mask == all) {
+        parser->found_mask = 0;
+        parser->records++;
+        if (parser->on_record) parser->on_record(parser->values, parser->userp);
+    }
+}
+
+// Appends one character of reply text, processing the line at each newline.
+static void push_char(struct HorizonsParser *parser, char c) {
+    if (c == '\n') {
+        process_line(parser);
+    } else if (parser->line_len < HORIZONS_LINE_MAX - 1) {
+        parser->line[parser->line_len++] = c;
+    }
+}
+
+void horizons_parser_feed(struct HorizonsParser *parser, const char *data, size_t len) {
+    if (parser->echo) fwrite(data, 1, len, parser->echo);
+    if (parser->done) return;
+
+    for (size_t i = 0; i < len && !parser->done; i++) {
+        char c = data[i];
+        if (parser->format == HORIZONS_FORMAT_TEXT) {
+            push_char(parser, c);
+            continue;
+        }
+
+        // JSON: only string contents carry reply text; decode escapes.
+        if (parser->json_unicode_left > 0) {
+            if (--parser->json_unicode_left == 0) push_char(parser, '?');
+        } else if (parser->json_escape) {
+            parser->json_escape = 0;
+            switch (c) {
+                case 'n': push_char(parser, '\n'); break;
+                case 't': push_char(parser, '\t'); break;
+                case 'r': case 'b': case 'f': break;
+                case 'u': parser->json_unicode_left = 4; break;
+                default: push_char(parser, c); break;
+            }
+        } else if (parser->json_in_string) {
+            if (c == '\\') parser->json_escape = 1;
+            else if (c == '"') parser->json_in_string = 0;
+            else push_char(parser, c);
+        } else if (c == '"') {
+            parser->json_in_string = 1;
+        }
+    }
+}
+
+void horizons_parser_finish(struct HorizonsParser *parser) {
+    if (parser->line_len > 0 && !parser->done) process_line(parser);
+}
@@ -0,0 +1,67 @@
+/**
+ * @file horizons_parse.h
+ * @brief Streaming parser for NASA JPL Horizons ephemeris replies.
+ *
+ * The parser is fed the response in whatever chunks the transport delivers
+ * and never holds more than one line of it. JSON replies ("format=json") are
+ * unescaped on the fly; text replies are scanned directly. Between the $$SOE
+ * and $$EOE markers it looks for a fixed set of field tags (e.g. "X =",
+ * "Y =", "Z =") and calls `on_record` once every tag of a record has been
+ * seen, with the values in tag order.
+ */
+
+#ifndef HORIZONS_PARSE_H
+#define HORIZONS_PARSE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define HORIZONS_MAX_TAGS 8
+#define HORIZONS_LINE_MAX 512
+
+enum HorizonsFormat {
+    HORIZONS_FORMAT_TEXT,
+    HORIZONS_FORMAT_JSON
+};
+
+// Tag sets for the two table types the tools request.
+extern const char *const HORIZONS_VECTOR_TAGS[3];   // X, Y, Z
+extern const char *const HORIZONS_ELEMENT_TAGS[6];  // EC, IN, OM, W, MA, A
+
+// Called for each complete record; values[i] belongs to tags[i].
+typedef void (*horizons_record_fn)(const double *values, void *userp);
+
+// Struct to hold the parser configuration and its constant-size state.
+struct HorizonsParser {
+    // --- Configuration ---
+    enum HorizonsFormat format;
+    const char *const *tags;
+    int num_tags;
+    horizons_record_fn on_record;
+    void *userp;
+    FILE *echo;                 // If set, raw input is copied here (debugging)
+    // --- State ---
+    int in_data;                // Seen $$SOE
+    int done;                   // Seen $$EOE
+    int records;                // Records delivered so far
+    int json_in_string;
+    int json_escape;
+    int json_unicode_left;
+    char line[HORIZONS_LINE_MAX];
+    size_t line_len;
+    double values[HORIZONS_MAX_TAGS];
+    unsigned found_mask;
+};
+
+// Prepares a parser for one response.
+void horizons_parser_init(struct HorizonsParser *parser, enum HorizonsFormat format,
+                          const char *const *tags, int num_tags,
+                          horizons_record_fn on_record, void *userp);
+
+// Feeds the next `len` bytes of the response.
+void horizons_parser_feed(struct HorizonsParser *parser, const char *data, size_t len);
+
+// Processes any trailing partial line once the response has ended.
+void horizons_parser_finish(struct HorizonsParser *parser);
+
+#endif // HORIZONS_PARSE_H
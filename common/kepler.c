@@ -0,0 +1,236 @@
+/**
+ * @file kepler.c
+ * @brief Batch Keplerian orbit propagator implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <math.h>
+#include "kepler.h"
+#include "stats.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// The "omp simd" hints only take effect with -fopenmp-simd; otherwise they
+// are ignored and the loops are still correct scalar code.
+#pragma GCC diagnostic ignored "-Wunknown-pragmas"
+
+// The helpers below must be inlined for the simd loops to vectorize.
+#if defined(__GNUC__)
+#define KEPLER_INLINE static inline __attribute__((always_inline))
+#else
+#define KEPLER_INLINE static inline
+#endif
+
+#define KEPLER_BLOCK 256            // Times solved together per Newton pass
+#define KEPLER_HIGH_ECCENTRICITY 0.8 // Above this the Danby starting guess is used
+
+// Rounds to the nearest integer without a libm call, so loops using it stay
+// vectorizable. Valid for |v| < 2^51.
+KEPLER_INLINE double round_nearest(double v) {
+    const double magic = 6755399441055744.0; // 1.5 * 2^52
+    return (v + magic) - magic;
+}
+
+// Starting guess for Kepler's equation with M in [-pi, pi]. Low
+// eccentricities use the second-order series M + e sin M (1 + e cos M),
+// which is within a few 1e-3 rad for the planets, so Newton needs 2-3
+// steps. Highly eccentric orbits such as comets use Danby's
+// M + 0.85 e sign(M), from which Newton converges for any e < 1.
+KEPLER_INLINE double kepler_guess(double m, double e, double sm, double cm) {
+    if (e < KEPLER_HIGH_ECCENTRICITY) return m + e * sm * (1.0 + e * cm);
+    return m + copysign(0.85 * e, m);
+}
+
+// Branch-free sine and cosine (Cephes polynomials on [-pi/4, pi/4] with a
+// three-part Cody-Waite reduction by pi/2). Accurate to about 1e-16 for the
+// |x| < 1e5 arguments the propagator produces.
+KEPLER_INLINE void sincos_fast(double x, double *s_out, double *c_out) {
+    const double DP1 = 1.57079625129699707031e+0;
+    const double DP2 = 7.54978941586159635336e-8;
+    const double DP3 = 5.39030285815811905290e-15;
+
+    double k = round_nearest(x * (2.0 / M_PI));
+    double r = ((x - k * DP1) - k * DP2) - k * DP3;
+    double z = r * r;
+
+    double sr = 1.58962301576546568060e-10;
+    sr = sr * z - 2.50507477628578072866e-8;
+    sr = sr * z + 2.75573136213857245213e-6;
+    sr = sr * z - 1.98412698295895385996e-4;
+    sr = sr * z + 8.33333333332211858878e-3;
+    sr = sr * z - 1.66666666666666307295e-1;
+    sr = r + r * z * sr;
+
+    double cr = -1.13585365213876817300e-11;
+    cr = cr * z + 2.08757008419747316778e-9;
+    cr = cr * z - 2.75573141792967388112e-7;
+    cr = cr * z + 2.48015872888517045348e-5;
+    cr = cr * z - 1.38888888888730564116e-3;
+    cr = cr * z + 4.16666666666665929218e-2;
+    cr = 1.0 - 0.5 * z + z * z * cr;
+
+    // Quadrant q = k mod 4 selects and signs the reduced results. Everything
+    // is done with arithmetic on 0/1 and +-1 factors so there are no branches.
+    double q = k - 4.0 * round_nearest(k * 0.25 - 0.375);
+    double odd = fabs(q - 2.0 * round_nearest(q * 0.5));
+    double s_sign = 1.0 - 2.0 * round_nearest(q * 0.5 - 0.25);
+    double q1 = q + 1.0;
+    q1 -= 4.0 * round_nearest(q1 * 0.25 - 0.375);
+    double c_sign = 1.0 - 2.0 * round_nearest(q1 * 0.5 - 0.25);
+    *s_out = s_sign * (odd * cr + (1.0 - odd) * sr);
+    *c_out = c_sign * (odd * sr + (1.0 - odd) * cr);
+}
+
+int kepler_batch_init(struct KeplerBatch *batch, const struct KeplerElements *elements, int count) {
+    batch->count = count;
+    double **arrays[] = { &batch->e, &batch->a, &batch->b, &batch->n, &batch->m0, &batch->epoch,
+                          &batch->px, &batch->py, &batch->pz, &batch->qx, &batch->qy, &batch->qz };
+    int num_arrays = sizeof(arrays) / sizeof(arrays[0]);
+    int failed = 0;
+    for (int k = 0; k < num_arrays; k++) {
+        *arrays[k] = malloc((size_t)(count > 0 ? count : 1) * sizeof(double));
+        if (!*arrays[k]) failed = 1;
+    }
+    batch->valid = malloc((size_t)(count > 0 ? count : 1) * sizeof(int));
+    if (failed || !batch->valid) {
+        kepler_batch_free(batch);
+        return -1;
+    }
+
+    for (int p = 0; p < count; p++) {
+        const struct KeplerElements *el = &elements[p];
+        double e = el->eccentricity;
+        double a = el->semi_major_axis_au;
+        batch->valid[p] = (a > 0);
+        batch->e[p] = e;
+        batch->a[p] = a;
+        batch->b[p] = a * sqrt(1 - e * e);
+        batch->n[p] = (batch->valid[p] ? 2.0 * M_PI / (sqrt(a * a * a) * 365.25) : 0.0);
+        batch->m0[p] = el->mean_anomaly_deg * M_PI / 180.0;
+        batch->epoch[p] = el->epoch_day;
+
+        double w_rad = el->arg_periapsis_deg * M_PI / 180.0;
+        double N_rad = el->lon_asc_node_deg * M_PI / 180.0;
+        double i_rad = el->inclination_deg * M_PI / 180.0;
+        double cw = cos(w_rad), sw = sin(w_rad);
+        double cN = cos(N_rad), sN = sin(N_rad);
+        double ci = cos(i_rad), si = sin(i_rad);
+
+        // --- Full 3D Rotation (perifocal -> ecliptic) ---
+        batch->px[p] = cw * cN - sw * sN * ci;
+        batch->py[p] = cw * sN + sw * cN * ci;
+        batch->pz[p] = sw * si;
+        batch->qx[p] = -(sw * cN + cw * sN * ci);
+        batch->qy[p] = -sw * sN + cw * cN * ci;
+        batch->qz[p] = cw * si;
+    }
+    return 0;
+}
+
+void kepler_batch_free(struct KeplerBatch *batch) {
+    double **arrays[] = { &batch->e, &batch->a, &batch->b, &batch->n, &batch->m0, &batch->epoch,
+                          &batch->px, &batch->py, &batch->pz, &batch->qx, &batch->qy, &batch->qz };
+    for (size_t k = 0; k < sizeof(arrays) / sizeof(arrays[0]); k++) {
+        free(*arrays[k]);
+        *arrays[k] = NULL;
+    }
+    free(batch->valid);
+    batch->valid = NULL;
+    batch->count = 0;
+}
+
+static struct StatsEntry block_passes = STATS_ENTRY("kepler.block_passes", STATS_COUNTER, "passes");
+static struct StatsEntry solve_iterations = STATS_ENTRY("kepler.iterations", STATS_COUNTER, "steps");
+
+int kepler_batch_propagate(const struct KeplerBatch *batch, const double *days, int num_times,
+                           double *x, double *y, double *z) {
+    double M[KEPLER_BLOCK], E[KEPLER_BLOCK];
+    int max_iterations = 0;
+    long blocks = 0, passes = 0;   // For -stats
+
+    for (int p = 0; p < batch->count; p++) {
+        double *xp = x + (size_t)p * num_times;
+        double *yp = y + (size_t)p * num_times;
+        double *zp = z + (size_t)p * num_times;
+
+        if (!batch->valid[p]) {
+            for (int t = 0; t < num_times; t++) xp[t] = yp[t] = zp[t] = NAN;
+            continue;
+        }
+
+        const double e = batch->e[p], a = batch->a[p], b = batch->b[p];
+        const double n = batch->n[p], m0 = batch->m0[p], epoch = batch->epoch[p];
+        const double px = batch->px[p], py = batch->py[p], pz = batch->pz[p];
+        const double qx = batch->qx[p], qy = batch->qy[p], qz = batch->qz[p];
+
+        for (int t0 = 0; t0 < num_times; t0 += KEPLER_BLOCK) {
+            int len = num_times - t0;
+            if (len > KEPLER_BLOCK) len = KEPLER_BLOCK;
+            const double *d = days + t0;
+
+            // Mean anomaly, reduced to [-pi, pi], and the starting guess.
+            #pragma omp simd
+            for (int i = 0; i < len; i++) {
+                double m = m0 + n * (d[i] - epoch);
+                m -= (2.0 * M_PI) * round_nearest(m * (1.0 / (2.0 * M_PI)));
+                double sm, cm;
+                sincos_fast(m, &sm, &cm);
+                M[i] = m;
+                E[i] = kepler_guess(m, e, sm, cm);
+            }
+
+            // Newton passes over the whole block until every lane has converged.
+            int iter = 0;
+            while (iter < KEPLER_MAX_ITERATIONS) {
+                double max_step = 0.0;
+                #pragma omp simd reduction(max:max_step)
+                for (int i = 0; i < len; i++) {
+                    double se, ce;
+                    sincos_fast(E[i], &se, &ce);
+                    double step = (E[i] - e * se - M[i]) / (1.0 - e * ce);
+                    E[i] -= step;
+                    double mag = fabs(step);
+                    max_step = (mag > max_step) ? mag : max_step;
+                }
+                iter++;
+                if (max_step < KEPLER_TOLERANCE) break;
+            }
+            if (iter > max_iterations) max_iterations = iter;
+            blocks++;
+            passes += iter;
+
+            #pragma omp simd
+            for (int i = 0; i < len; i++) {
+                double se, ce;
+                sincos_fast(E[i], &se, &ce);
+                double x_orb = a * (ce - e);
+                double y_orb = b * se;
+                xp[t0 + i] = px * x_orb + qx * y_orb;
+                yp[t0 + i] = py * x_orb + qy * y_orb;
+                zp[t0 + i] = pz * x_orb + qz * y_orb;
+            }
+        }
+    }
+    STATS_ADD_CALLS(block_passes, blocks, passes);
+    return max_iterations;
+}
+
+double kepler_solve(double mean_anomaly_rad, double e, int *iterations) {
+    double m = remainder(mean_anomaly_rad, 2.0 * M_PI);
+    double E = kepler_guess(m, e, sin(m), cos(m));
+    double offset = mean_anomaly_rad - m; // Restored so E tracks the caller's M
+
+    int iter = 0;
+    while (iter < KEPLER_MAX_ITERATIONS) {
+        double step = (E - e * sin(E) - m) / (1.0 - e * cos(E));
+        E -= step;
+        iter++;
+        if (fabs(step) < KEPLER_TOLERANCE) break;
+    }
+    if (iterations) *iterations = iter;
+    STATS_ADD(solve_iterations, iter);
+    return E + offset;
+}
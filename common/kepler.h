@@ -0,0 +1,73 @@
+/**
+ * @file kepler.h
+ * @brief Keplerian orbit propagator shared by the simulators.
+ *
+ * Orbital elements are converted once into a KeplerBatch: per-body constants
+ * (mean motion, semi-minor axis and the perifocal-to-ecliptic rotation
+ * matrix) stored as separate contiguous arrays. kepler_batch_propagate then
+ * evaluates every body at a whole array of times.
+ *
+ * The time loop is written so the compiler can vectorize it. It uses
+ * branch-free sin/cos, and Kepler's equation is solved by Newton passes
+ * over a block of times that stop once the whole block has converged. Build
+ * with -fopenmp-simd (and e.g. -mavx2 or -march=native) to get AVX2/NEON
+ * code; without those flags the same code runs as scalar.
+ *
+ * kepler_solve is the scalar solver for single evaluations. Both paths use
+ * the same eccentricity-dependent starting guess and stop once the Newton
+ * step drops below KEPLER_TOLERANCE. They also report how many iterations
+ * were needed, for instrumentation.
+ */
+
+#ifndef KEPLER_H
+#define KEPLER_H
+
+#define KEPLER_SECONDS_PER_DAY 86400.0
+#define KEPLER_TOLERANCE 1e-14      // Newton convergence threshold (radians)
+#define KEPLER_MAX_ITERATIONS 32    // Safety cap for near-parabolic orbits
+
+// Struct to hold a body's Keplerian orbital elements.
+struct KeplerElements {
+    double eccentricity;        // e
+    double semi_major_axis_au;  // a
+    double inclination_deg;     // i
+    double lon_asc_node_deg;    // LAN
+    double arg_periapsis_deg;   // w
+    double mean_anomaly_deg;    // M at epoch
+    double epoch_day;           // Days since 1970-01-01 at which these elements are valid
+};
+
+// Struct to hold precomputed propagation constants for a set of bodies,
+// one array entry per body (structure of arrays).
+struct KeplerBatch {
+    int count;
+    double *e;          // Eccentricity
+    double *a;          // Semi-major axis (AU)
+    double *b;          // Semi-minor axis, a * sqrt(1 - e^2) (AU)
+    double *n;          // Mean motion (rad/day)
+    double *m0;         // Mean anomaly at epoch (rad)
+    double *epoch;      // Epoch (days since 1970-01-01)
+    double *px, *py, *pz; // Ecliptic direction of the perifocal x axis
+    double *qx, *qy, *qz; // Ecliptic direction of the perifocal y axis
+    int *valid;         // 0 if the elements cannot be propagated (a <= 0)
+};
+
+// Precomputes constants for `count` bodies. Returns 0 on success.
+int kepler_batch_init(struct KeplerBatch *batch, const struct KeplerElements *elements, int count);
+
+// Releases the arrays owned by `batch`.
+void kepler_batch_free(struct KeplerBatch *batch);
+
+// Computes heliocentric ecliptic positions (AU) of every body at each of
+// `num_times` times (days since 1970-01-01). Output is per-body columns:
+// x[body * num_times + t]. Invalid bodies yield NAN. Returns the largest
+// number of Newton passes any block needed.
+int kepler_batch_propagate(const struct KeplerBatch *batch, const double *days, int num_times,
+                           double *x, double *y, double *z);
+
+// Solves Kepler's equation E - e sin E = M for the eccentric anomaly
+// (radians). If `iterations` is non-NULL it receives the number of Newton
+// steps taken.
+double kepler_solve(double mean_anomaly_rad, double e, int *iterations);
+
+#endif // KEPLER_H
@@ -0,0 +1,238 @@
+/**
+ * @file pipeline.c
+ * @brief Streaming event detection implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "pipeline.h"
+#include "stats.h"
+
+#define PIPELINE_LINE_MAX 512
+
+// One report line waiting for every earlier event to be found.
+struct PipelineLine {
+    double row;
+    long seq;     // Arrival order, to keep ties stable
+    char *text;
+};
+
+static int compare_lines(const void *pa, const void *pb) {
+    const struct PipelineLine *a = pa, *b = pb;
+    if (a->row != b->row) return a->row < b->row ? -1 : 1;
+    return (a->seq > b->seq) - (a->seq < b->seq);
+}
+
+// Queues a formatted line for output at `row`. Returns 0, or -1 if out of
+// memory.
+static int queue_line(struct Pipeline *pipeline, double row, const char *text) {
+    if (pipeline->num_pending == pipeline->pending_cap) {
+        size_t cap = pipeline->pending_cap ? pipeline->pending_cap * 2 : 64;
+        struct PipelineLine *items = realloc(pipeline->pending, cap * sizeof(*items));
+        if (items == NULL) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            return -1;
+        }
+        pipeline->pending = items;
+        pipeline->pending_cap = cap;
+    }
+    char *copy = strdup(text);
+    if (copy == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    struct PipelineLine *line = &pipeline->pending[pipeline->num_pending++];
+    line->row = row;
+    line->seq = pipeline->next_seq++;
+    line->text = copy;
+    return 0;
+}
+
+// Writes, in time order, every queued line earlier than `horizon`.
+static void flush_lines(struct Pipeline *pipeline, double horizon) {
+    qsort(pipeline->pending, pipeline->num_pending, sizeof(*pipeline->pending), compare_lines);
+    size_t done = 0;
+    while (done < pipeline->num_pending && pipeline->pending[done].row < horizon) {
+        fputs(pipeline->pending[done].text, pipeline->out);
+        free(pipeline->pending[done].text);
+        done++;
+    }
+    memmove(pipeline->pending, pipeline->pending + done, (pipeline->num_pending - done) * sizeof(*pipeline->pending));
+    pipeline->num_pending -= done;
+}
+
+// --- Detector Callbacks ---
+
+static int queue_group(const struct GroupEvent *event, void *userp) {
+    struct Pipeline *pipeline = userp;
+    char when[DATASET_TIME_LEN], first[DATASET_TIME_LEN], last[DATASET_TIME_LEN];
+    char text[PIPELINE_LINE_MAX];
+    pipeline->label(event->row, 1, when, pipeline->label_userp);
+    pipeline->label((double)event->start, 0, first, pipeline->label_userp);
+    pipeline->label((double)event->last, 0, last, pipeline->label_userp);
+    int len = snprintf(text, sizeof(text), "%s: ", when);
+    for (int i = 0; i < event->count && len < (int)sizeof(text); i++) {
+        len += snprintf(text + len, sizeof(text) - len, "%s ", pipeline->names[event->members[i]]);
+    }
+    if (len < (int)sizeof(text)) {
+        snprintf(text + len, sizeof(text) - len, "(within %.2f° from %s to %s, tightest %.2f°)\n",
+                 pipeline->options.width, first, last, event->spread);
+    }
+    return queue_line(pipeline, event->row, text);
+}
+
+// Stamps aspect events with the pair being scanned.
+struct PipelinePair {
+    struct Pipeline *pipeline;
+    int body_a, body_b;
+};
+
+static void queue_aspect(const struct SeparationEvent *event, void *userp) {
+    const struct PipelinePair *pair = userp;
+    struct Pipeline *pipeline = pair->pipeline;
+    char when[DATASET_TIME_LEN], text[PIPELINE_LINE_MAX];
+    pipeline->label(event->row, 1, when, pipeline->label_userp);
+    double diff = fabs(event_wrap180(event->target + event->separation));
+    snprintf(text, sizeof(text), "%s: %s and %s are in %s (%.2f° apart).\n", when, pipeline->names[pair->body_a],
+             pipeline->names[pair->body_b], pipeline->options.aspects->aspects[event->aspect].name, diff);
+    if (queue_line(pipeline, event->row, text) != 0) pipeline->failed = 1;
+}
+
+// --- Pipeline ---
+
+int pipeline_init(struct Pipeline *pipeline, const struct PipelineOptions *options,
+                  const char *const names[], int num_bodies,
+                  pipeline_label_fn label, void *label_userp, FILE *out) {
+    memset(pipeline, 0, sizeof(*pipeline));
+    if (num_bodies > FRAME_STORE_MAX_BODIES) num_bodies = FRAME_STORE_MAX_BODIES;
+    pipeline->options = *options;
+    pipeline->num_bodies = num_bodies;
+    for (int i = 0; i < num_bodies; i++) pipeline->names[i] = names[i];
+    pipeline->label = label;
+    pipeline->label_userp = label_userp;
+    pipeline->out = out;
+
+    if (options->alignments &&
+        group_tracker_init(&pipeline->groups, num_bodies, options->width, options->min_size) != 0) {
+        pipeline->options.alignments = 0;
+        pipeline_free(pipeline);
+        return -1;
+    }
+    if (options->aspects) {
+        int num_pairs = num_bodies * (num_bodies - 1) / 2;
+        pipeline->scans = malloc((num_pairs > 0 ? (size_t)num_pairs : 1) * sizeof(*pipeline->scans));
+        if (pipeline->scans == NULL) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            pipeline_free(pipeline);
+            return -1;
+        }
+        for (int p = 0; p < num_pairs; p++) event_scan_init(&pipeline->scans[p], options->aspects);
+    }
+    if (options->approaches > 0) {
+        int bodies[FRAME_STORE_MAX_BODIES];
+        for (int i = 0; i < num_bodies; i++) bodies[i] = i;
+        if (approach_heap_init(&pipeline->heap, options->approaches) != 0 ||
+            approach_scan_init(&pipeline->approach_scan, bodies, num_bodies) != 0) {
+            pipeline_free(pipeline);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static struct StatsEntry alignment_time = STATS_ENTRY("detect.alignments", STATS_TIMER, "ns");
+static struct StatsEntry aspect_time = STATS_ENTRY("detect.aspects", STATS_TIMER, "ns");
+static struct StatsEntry approach_time = STATS_ENTRY("detect.approaches", STATS_TIMER, "ns");
+
+int pipeline_feed(struct Pipeline *pipeline, struct FrameStore *batch) {
+    if (pipeline->failed) return -1;
+    const double *longitudes[FRAME_STORE_MAX_BODIES];
+    if (pipeline->options.alignments || pipeline->options.aspects) {
+        for (int i = 0; i < pipeline->num_bodies; i++) {
+            longitudes[i] = frame_store_longitudes(batch, i);
+            if (longitudes[i] == NULL) {
+                pipeline->failed = 1;
+                return -1;
+            }
+        }
+    }
+
+    double horizon = HUGE_VAL;
+    if (pipeline->options.alignments) {
+        int64_t start = STATS_START();
+        if (group_tracker_feed(&pipeline->groups, longitudes, batch->num_rows, queue_group, pipeline) != 0) {
+            pipeline->failed = 1;
+            return -1;
+        }
+        horizon = group_tracker_horizon(&pipeline->groups);
+        STATS_STOP(alignment_time, start);
+    }
+    if (pipeline->options.aspects) {
+        int64_t start = STATS_START();
+        int p = 0;
+        for (int i = 0; i < pipeline->num_bodies; i++) {
+            for (int j = i + 1; j < pipeline->num_bodies; j++, p++) {
+                struct PipelinePair pair = {pipeline, i, j};
+                event_scan_feed(&pipeline->scans[p], longitudes[i], longitudes[j], batch->num_rows,
+                                queue_aspect, &pair);
+                double earliest = event_scan_horizon(&pipeline->scans[p]);
+                if (earliest < horizon) horizon = earliest;
+            }
+        }
+        STATS_STOP(aspect_time, start);
+    }
+    if (pipeline->options.approaches > 0) {
+        int64_t start = STATS_START();
+        approach_scan_feed(&pipeline->approach_scan, batch, &pipeline->heap);
+        STATS_STOP(approach_time, start);
+    }
+    pipeline->rows += batch->num_rows;
+    if (pipeline->failed) return -1;
+    flush_lines(pipeline, horizon);
+    return 0;
+}
+
+int pipeline_finish(struct Pipeline *pipeline) {
+    if (pipeline->options.alignments &&
+        group_tracker_finish(&pipeline->groups, queue_group, pipeline) != 0) {
+        pipeline->failed = 1;
+    }
+    if (pipeline->options.aspects) {
+        int p = 0;
+        for (int i = 0; i < pipeline->num_bodies; i++) {
+            for (int j = i + 1; j < pipeline->num_bodies; j++, p++) {
+                struct PipelinePair pair = {pipeline, i, j};
+                event_scan_finish(&pipeline->scans[p], queue_aspect, &pair);
+            }
+        }
+    }
+    flush_lines(pipeline, HUGE_VAL);
+
+    if (pipeline->options.approaches > 0) {
+        struct ApproachHeap *heap = &pipeline->heap;
+        approach_heap_sort(heap);
+        fprintf(pipeline->out, "\n--- Closest Approaches (%d of %ld found across %d pairs) ---\n",
+                heap->count, pipeline->approach_scan.found, pipeline->num_bodies * (pipeline->num_bodies - 1) / 2);
+        for (int k = 0; k < heap->count; k++) {
+            const struct Approach *approach = &heap->items[k];
+            char when[DATASET_TIME_LEN];
+            pipeline->label(approach->row, 1, when, pipeline->label_userp);
+            fprintf(pipeline->out, "%s: %s and %s at %.4f AU\n", when, pipeline->names[approach->body_a],
+                    pipeline->names[approach->body_b], approach->distance);
+        }
+    }
+    return pipeline->failed ? -1 : 0;
+}
+
+void pipeline_free(struct Pipeline *pipeline) {
+    if (pipeline->options.alignments) group_tracker_free(&pipeline->groups);
+    free(pipeline->scans);
+    approach_scan_free(&pipeline->approach_scan);
+    approach_heap_free(&pipeline->heap);
+    for (size_t k = 0; k < pipeline->num_pending; k++) free(pipeline->pending[k].text);
+    free(pipeline->pending);
+    memset(pipeline, 0, sizeof(*pipeline));
+}
@@ -0,0 +1,81 @@
+/**
+ * @file pipeline.h
+ * @brief Streaming event detection over batches of positions.
+ *
+ * A Pipeline runs the alignment (groups.h), aspect (events.h) and
+ * closest-approach (approaches.h) detectors side by side over positions
+ * that arrive in batches, e.g. straight from the propagator, so no
+ * intermediate file is needed. Only the detectors' carried state, one
+ * batch of longitudes and the events not yet settled are held in memory,
+ * however many rows pass through.
+ *
+ * Alignment and aspect lines are written as soon as no detector can still
+ * produce an earlier event, so the report comes out in time order. The
+ * closest approaches are a ranking over the whole run and are written by
+ * pipeline_finish.
+ */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <stdio.h>
+#include "frame_store.h"
+#include "groups.h"
+#include "events.h"
+#include "approaches.h"
+
+// Which detectors to run, and their settings.
+struct PipelineOptions {
+    int alignments;                     // Track multi-body alignments...
+    double width;                       //   ...within this arc, degrees
+    int min_size;                       //   ...of at least this many bodies
+    const struct AspectTable *aspects;  // Aspect search, or NULL for none
+    int approaches;                     // Closest approaches to rank, 0 for none
+};
+
+// Writes the label of a (fractional) row into `out` (DATASET_TIME_LEN
+// bytes): the date alone, or with the time of day if `with_time` is set.
+typedef void (*pipeline_label_fn)(double row, int with_time, char *out, void *userp);
+
+struct PipelineLine;
+
+struct Pipeline {
+    struct PipelineOptions options;
+    int num_bodies;
+    const char *names[FRAME_STORE_MAX_BODIES];
+    pipeline_label_fn label;
+    void *label_userp;
+    FILE *out;
+    long rows;                          // Rows fed so far
+
+    struct GroupTracker groups;
+    struct SeparationScan *scans;       // One per pair of bodies
+    struct ApproachScan approach_scan;
+    struct ApproachHeap heap;
+
+    struct PipelineLine *pending;       // Lines not yet settled, unsorted
+    size_t num_pending, pending_cap;
+    long next_seq;
+    int failed;
+};
+
+// Sets up the detectors chosen in `options` for `num_bodies` named bodies,
+// writing the report to `out`. Returns 0, or -1 if out of memory.
+int pipeline_init(struct Pipeline *pipeline, const struct PipelineOptions *options,
+                  const char *const names[], int num_bodies,
+                  pipeline_label_fn label, void *label_userp, FILE *out);
+
+// Runs every detector over the rows of `batch`, which continue where the
+// previous batch ended, and writes the lines that are settled. The batch's
+// longitude columns are computed (and cached in it) as needed. Returns 0,
+// or -1 if out of memory.
+int pipeline_feed(struct Pipeline *pipeline, struct FrameStore *batch);
+
+// Ends the data: writes the remaining lines, then the closest approaches.
+// Returns 0, or -1 if any step failed.
+int pipeline_finish(struct Pipeline *pipeline);
+
+// Releases the pipeline (the output stream is not closed).
+void pipeline_free(struct Pipeline *pipeline);
+
+#endif // PIPELINE_H
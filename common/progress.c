@@ -0,0 +1,26 @@
+/**
+ * @file progress.c
+ * @brief Time-throttled progress reporting implementation.
+ */
+
+#define _GNU_SOURCE
+#include <time.h>
+#include "progress.h"
+
+static double monotonic_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void progress_init(struct Progress *progress, double interval) {
+    progress->interval = (interval > 0.0) ? interval : PROGRESS_DEFAULT_INTERVAL;
+    progress->next_due = 0.0;
+}
+
+int progress_due(struct Progress *progress) {
+    double now = monotonic_seconds();
+    if (now < progress->next_due) return 0;
+    progress->next_due = now + progress->interval;
+    return 1;
+}
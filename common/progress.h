@@ -0,0 +1,27 @@
+/**
+ * @file progress.h
+ * @brief Time-throttled progress reporting.
+ *
+ * Printing and flushing a progress line for every row can cost more than
+ * producing the row. A Progress tracker says when a report is due, so
+ * callers print at most once per interval.
+ */
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#define PROGRESS_DEFAULT_INTERVAL 0.2 // Seconds between reports
+
+struct Progress {
+    double interval;
+    double next_due;  // Monotonic time of the next report, in seconds
+};
+
+// Initialises a tracker; `interval` <= 0 selects PROGRESS_DEFAULT_INTERVAL.
+// The first progress_due call always reports.
+void progress_init(struct Progress *progress, double interval);
+
+// Returns 1 if a report is due (and starts the next interval), otherwise 0.
+int progress_due(struct Progress *progress);
+
+#endif // PROGRESS_H
@@ -0,0 +1,119 @@
+/**
+ * @file stats.c
+ * @brief Runtime counters and timers implementation.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+#define STATS_PATH_LEN 1024
+
+int stats_enabled = 0;
+
+static struct StatsEntry *entries = NULL;   // Most recently registered first
+static int64_t started_at = 0;              // stats_now() when stats were turned on
+static char json_path[STATS_PATH_LEN] = "";
+
+int64_t stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Links `entry` into the report the first time it is fed, from any thread.
+static void stats_register(struct StatsEntry *entry) {
+    int expected = 0;
+    if (!__atomic_compare_exchange_n(&entry->registered, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+    entry->next = __atomic_load_n(&entries, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(&entries, &entry->next, entry, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        // entry->next now holds the new head; try again.
+    }
+}
+
+void stats_add(struct StatsEntry *entry, int64_t calls, int64_t amount) {
+    if (!__atomic_load_n(&entry->registered, __ATOMIC_ACQUIRE)) stats_register(entry);
+    __atomic_fetch_add(&entry->calls, calls, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&entry->total, amount, __ATOMIC_RELAXED);
+}
+
+static void report_at_exit(void) {
+    stats_report();
+}
+
+int stats_parse_option(int argc, char *argv[], int *index) {
+    const char *arg = argv[*index];
+    if (strcmp(arg, "-stats-json") == 0 && *index + 1 < argc) {
+        snprintf(json_path, sizeof(json_path), "%s", argv[++(*index)]);
+    } else if (strcmp(arg, "-stats") != 0 && strcmp(arg, "--stats") != 0) {
+        return 0;
+    }
+    if (!stats_enabled) {
+        stats_enabled = 1;
+        started_at = stats_now();
+        atexit(report_at_exit);
+    }
+    return 1;
+}
+
+// --- Report ---
+
+// Fills `out` with the registered entries in the order they were first fed.
+// Returns how many there are (at most `max`).
+static int collect_entries(struct StatsEntry **out, int max) {
+    int count = 0;
+    for (struct StatsEntry *e = __atomic_load_n(&entries, __ATOMIC_ACQUIRE); e && count < max; e = e->next) {
+        out[count++] = e;
+    }
+    for (int i = 0; i < count / 2; i++) {
+        struct StatsEntry *swap = out[i];
+        out[i] = out[count - 1 - i];
+        out[count - 1 - i] = swap;
+    }
+    return count;
+}
+
+static void write_json(struct StatsEntry **list, int count, double wall) {
+    FILE *file = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Cannot write stats to '%s'.\n", json_path);
+        return;
+    }
+    fprintf(file, "{\"wall_seconds\": %.6f, \"entries\": [", wall);
+    for (int i = 0; i < count; i++) {
+        const struct StatsEntry *e = list[i];
+        fprintf(file, "%s\n  {\"name\": \"%s\", \"kind\": \"%s\", \"unit\": \"%s\", \"calls\": %lld, \"total\": %lld}",
+                i ? "," : "", e->name, e->kind == STATS_TIMER ? "timer" : "counter", e->unit,
+                (long long)e->calls, (long long)e->total);
+    }
+    fprintf(file, "\n]}\n");
+    if (file == stdout) fflush(file); else fclose(file);
+}
+
+void stats_report(void) {
+    if (!stats_enabled) return;
+    static struct StatsEntry *list[256];
+    int count = collect_entries(list, (int)(sizeof(list) / sizeof(list[0])));
+    double wall = (double)(stats_now() - started_at) / 1e9;
+
+    fflush(stdout);   // Keep the report after the tool's own output
+    fprintf(stderr, "\n--- Stats (%.3f s wall) ---\n", wall);
+    for (int i = 0; i < count; i++) {
+        const struct StatsEntry *e = list[i];
+        long long calls = (long long)e->calls;
+        double per_call = calls ? (double)e->total / (double)calls : 0;
+        if (e->kind == STATS_TIMER) {
+            fprintf(stderr, "%-24s %10lld calls %12.3f ms %12.3f us/call\n", e->name, calls,
+                    (double)e->total / 1e6, per_call / 1e3);
+        } else {
+            fprintf(stderr, "%-24s %10lld calls %12lld %-8s %12.1f /call %12.0f /s\n", e->name, calls,
+                    (long long)e->total, e->unit, per_call, wall > 0 ? (double)e->total / wall : 0);
+        }
+    }
+    if (json_path[0]) write_json(list, count, wall);
+}
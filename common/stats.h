@@ -0,0 +1,74 @@
+/**
+ * @file stats.h
+ * @brief Runtime-switchable counters and timers for the hot paths.
+ *
+ * Each instrumented module declares its entries with STATS_ENTRY, e.g. the
+ * bytes of each HTTP reply or the time spent in each detector, and feeds
+ * them through STATS_ADD and STATS_START/STATS_STOP. Until "-stats" is
+ * given they cost a single test of a global flag; once it is, every update
+ * is a pair of relaxed atomic adds, so entries can be fed from the
+ * chunk_pool workers too.
+ *
+ * An entry counts how many times it was fed (`calls`) and the sum of the
+ * amounts (`total`): nanoseconds for a timer, events, rows or bytes for a
+ * counter. Entries appear in the report once they have been fed, in the
+ * order they were first fed.
+ *
+ * Options (see stats_parse_option):
+ *   -stats            print a summary to stderr at exit ("--stats" also works)
+ *   -stats-json FILE  also write it to FILE as JSON ("-" for stdout)
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+enum StatsKind { STATS_COUNTER, STATS_TIMER };
+
+struct StatsEntry {
+    const char *name;         // Dotted, e.g. "http.bytes"
+    const char *unit;         // What a counter counts, e.g. "bytes"; "ns" for timers
+    enum StatsKind kind;
+    int64_t calls;
+    int64_t total;
+    int registered;
+    struct StatsEntry *next;  // Report order
+};
+
+// Declares a zeroed entry, e.g.
+//     static struct StatsEntry parse_time = STATS_ENTRY("horizons.parse", STATS_TIMER, "ns");
+#define STATS_ENTRY(name, kind, unit) {name, unit, kind, 0, 0, 0, 0}
+
+// Nonzero once -stats is given; test it before doing any work for an entry.
+extern int stats_enabled;
+
+// Adds `amount` to `entry` as one call, if stats are on.
+#define STATS_ADD(entry, amount) do { if (stats_enabled) stats_add(&(entry), 1, (int64_t)(amount)); } while (0)
+
+// Adds `amount` over `calls` calls at once, e.g. totals kept per batch.
+#define STATS_ADD_CALLS(entry, calls, amount) \
+    do { if (stats_enabled) stats_add(&(entry), (int64_t)(calls), (int64_t)(amount)); } while (0)
+
+// Start time for STATS_STOP, or 0 if stats are off.
+#define STATS_START() (stats_enabled ? stats_now() : 0)
+
+// Adds the time since `start` (from STATS_START) to a timer entry.
+#define STATS_STOP(entry, start) do { if (stats_enabled) stats_add(&(entry), 1, stats_now() - (start)); } while (0)
+
+// Consumes a stats option at argv[*index] (see above). The first one turns
+// stats on and schedules the report for exit. Returns 1 (advancing *index
+// past any value) if consumed, 0 otherwise.
+int stats_parse_option(int argc, char *argv[], int *index);
+
+// Monotonic time in nanoseconds.
+int64_t stats_now(void);
+
+// Adds `calls` calls totalling `amount` to `entry`. Safe from any thread.
+void stats_add(struct StatsEntry *entry, int64_t calls, int64_t amount);
+
+// Prints the summary (and writes the JSON file, if asked for). Called at
+// exit when stats are on.
+void stats_report(void);
+
+#endif // STATS_H
@@ -0,0 +1,199 @@
+/**
+ * @file timebase.c
+ * @brief UTC time base implementation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "timebase.h"
+
+#define MINUTES_PER_DAY (24 * 60)
+#define SECONDS_PER_JULIAN_YEAR (int64_t)31557600 // 365.25 days
+
+// Floor division, so times before 1970 land on the right day.
+static int64_t floor_div(int64_t a, int64_t b) {
+    int64_t q = a / b;
+    return (a % b != 0 && (a < 0) != (b < 0)) ? q - 1 : q;
+}
+
+static int days_in_month(long year, int month) {
+    static const int DAYS[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0)) return 29;
+    return DAYS[month - 1];
+}
+
+// --- Calendar ---
+
+// H. Hinnant's days-from-civil algorithm.
+long timebase_days_from_civil(long year, int month, int day) {
+    year -= month <= 2;
+    long era = (year >= 0 ? year : year - 399) / 400;
+    long yoe = year - era * 400;
+    long doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void timebase_civil_from_days(long days, long *year, int *month, int *day) {
+    days += 719468;
+    long era = (days >= 0 ? days : days - 146096) / 146097;
+    long doe = days - era * 146097;
+    long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    long mp = (5 * doy + 2) / 153;
+    *day = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *month = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *year = yoe + era * 400 + (*month <= 2);
+}
+
+// --- Parsing ---
+
+// Reads exactly `digits` decimal digits at *p.
+static int read_digits(const char **p, int digits, int *value) {
+    *value = 0;
+    for (int i = 0; i < digits; i++) {
+        if (!isdigit((unsigned char)(*p)[i])) return -1;
+        *value = *value * 10 + ((*p)[i] - '0');
+    }
+    *p += digits;
+    return 0;
+}
+
+int timebase_parse(const char *text, int64_t *t) {
+    const char *p = text;
+    int negative = *p == '-';
+    if (negative) p++;
+    char *end;
+    long year = strtol(p, &end, 10);
+    if (end == p || *end != '-' || !isdigit((unsigned char)*p)) return -1;
+    if (negative) year = -year;
+    p = end + 1;
+
+    int month, day, hour = 0, minute = 0;
+    if (read_digits(&p, 2, &month) != 0 || *p++ != '-' || read_digits(&p, 2, &day) != 0) return -1;
+    if (*p == ' ' || *p == 'T') {
+        p++;
+        if (read_digits(&p, 2, &hour) != 0 || *p++ != ':' || read_digits(&p, 2, &minute) != 0) return -1;
+    }
+    if (*p != '\0' || month < 1 || month > 12 || day < 1 || day > days_in_month(year, month) ||
+        hour > 23 || minute > 59) {
+        return -1;
+    }
+    *t = (int64_t)timebase_days_from_civil(year, month, day) * TIMEBASE_SECONDS_PER_DAY + hour * 3600 + minute * 60;
+    return 0;
+}
+
+int timebase_parse_step(const char *text, int64_t *step) {
+    char *end;
+    long long count = strtoll(text, &end, 10);
+    if (end == text || count < 1) return -1;
+    int64_t unit;
+    if (strcmp(end, "m") == 0) unit = 60;
+    else if (strcmp(end, "h") == 0) unit = 3600;
+    else if (strcmp(end, "d") == 0 || *end == '\0') unit = TIMEBASE_SECONDS_PER_DAY;
+    else if (strcmp(end, "w") == 0) unit = 7 * TIMEBASE_SECONDS_PER_DAY;
+    else if (strcmp(end, "y") == 0) unit = SECONDS_PER_JULIAN_YEAR;
+    else return -1;
+    if (count > INT64_MAX / unit) return -1;
+    *step = (int64_t)count * unit;
+    return 0;
+}
+
+int timebase_has_time(int64_t start, int64_t step) {
+    return start % TIMEBASE_SECONDS_PER_DAY != 0 || step % TIMEBASE_SECONDS_PER_DAY != 0;
+}
+
+void timebase_horizons_step(int64_t step, char *out, size_t len) {
+    if (step % TIMEBASE_SECONDS_PER_DAY == 0) {
+        snprintf(out, len, "%lldd", (long long)(step / TIMEBASE_SECONDS_PER_DAY));
+    } else if (step % 3600 == 0) {
+        snprintf(out, len, "%lldh", (long long)(step / 3600));
+    } else {
+        snprintf(out, len, "%lldm", (long long)(step / 60));
+    }
+}
+
+// --- Labels ---
+
+static void format_label(struct TimeLabel *label) {
+    char *t = label->text;
+    if (label->year < 1000 || label->year > 9999) {
+        int len = snprintf(t, TIMEBASE_LABEL_LEN, "%ld-%02d-%02d", label->year, label->month, label->day);
+        if (label->with_time) {
+            snprintf(t + len, TIMEBASE_LABEL_LEN - len, " %02d:%02d", label->minute / 60, label->minute % 60);
+        }
+        return;
+    }
+    t[0] = (char)('0' + label->year / 1000);
+    t[1] = (char)('0' + label->year / 100 % 10);
+    t[2] = (char)('0' + label->year / 10 % 10);
+    t[3] = (char)('0' + label->year % 10);
+    t[4] = '-';
+    t[5] = (char)('0' + label->month / 10);
+    t[6] = (char)('0' + label->month % 10);
+    t[7] = '-';
+    t[8] = (char)('0' + label->day / 10);
+    t[9] = (char)('0' + label->day % 10);
+    if (!label->with_time) {
+        t[10] = '\0';
+        return;
+    }
+    int hour = label->minute / 60, minute = label->minute % 60;
+    t[10] = ' ';
+    t[11] = (char)('0' + hour / 10);
+    t[12] = (char)('0' + hour % 10);
+    t[13] = ':';
+    t[14] = (char)('0' + minute / 10);
+    t[15] = (char)('0' + minute % 10);
+    t[16] = '\0';
+}
+
+void timebase_format(int64_t t, int with_time, char *out) {
+    struct TimeLabel label;
+    time_label_init(&label, t, with_time);
+    memcpy(out, label.text, TIMEBASE_LABEL_LEN);
+}
+
+void time_label_init(struct TimeLabel *label, int64_t t, int with_time) {
+    int64_t days = floor_div(t, TIMEBASE_SECONDS_PER_DAY);
+    timebase_civil_from_days((long)days, &label->year, &label->month, &label->day);
+    label->minute = (int)((t - days * TIMEBASE_SECONDS_PER_DAY) / 60);
+    label->with_time = with_time;
+    format_label(label);
+}
+
+void time_label_advance(struct TimeLabel *label, int64_t step) {
+    int64_t minutes = label->minute + step / 60;
+    int64_t days = floor_div(minutes, MINUTES_PER_DAY);
+    label->minute = (int)(minutes - days * MINUTES_PER_DAY);
+    int fast = label->year >= 1000 && label->year <= 9999;
+
+    if (days == 0) {
+        // Same day: only the time digits change.
+        if (fast && label->with_time) {
+            int hour = label->minute / 60, minute = label->minute % 60;
+            label->text[11] = (char)('0' + hour / 10);
+            label->text[12] = (char)('0' + hour % 10);
+            label->text[14] = (char)('0' + minute / 10);
+            label->text[15] = (char)('0' + minute % 10);
+        } else {
+            format_label(label);
+        }
+        return;
+    }
+    if (days == 1 && label->day < days_in_month(label->year, label->month)) {
+        // Next day of the same month, the common daily case.
+        label->day++;
+        if (fast && !label->with_time) {
+            label->text[8] = (char)('0' + label->day / 10);
+            label->text[9] = (char)('0' + label->day % 10);
+            return;
+        }
+    } else {
+        long day_number = timebase_days_from_civil(label->year, label->month, label->day) + (long)days;
+        timebase_civil_from_days(day_number, &label->year, &label->month, &label->day);
+    }
+    format_label(label);
+}
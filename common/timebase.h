@@ -0,0 +1,67 @@
+/**
+ * @file timebase.h
+ * @brief UTC time base: integer Unix seconds, sample steps and date labels.
+ *
+ * Sample times are int64 Unix seconds in UTC, and row k of a run is simply
+ * start + k * step, so there is no mktime/localtime round trip per row and
+ * no daylight-saving shift. Calendar conversion uses the proleptic Gregorian
+ * day-number algorithms, which are exact for any year.
+ *
+ * Steps are whole minutes, written as a count and a unit: "30m", "1h",
+ * "1d", "1w" or "1y" (a Julian year of 365.25 days). A bare count is days.
+ *
+ * Labels are "YYYY-MM-DD" while every sample falls on midnight and
+ * "YYYY-MM-DD HH:MM" otherwise. TimeLabel advances a label by a step,
+ * rewriting only the characters that change, so a run of rows needs a
+ * single calendar conversion at its start.
+ */
+
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TIMEBASE_LABEL_LEN 24
+#define TIMEBASE_SECONDS_PER_DAY 86400
+#define TIMEBASE_DEFAULT_STEP (int64_t)TIMEBASE_SECONDS_PER_DAY
+#define TIMEBASE_STEP_HELP "a count and m, h, d, w or y, e.g. 1h"
+
+// Calendar label advanced one step at a time; `text` is NUL-terminated.
+struct TimeLabel {
+    long year;
+    int month;           // 1-12
+    int day;             // 1-31
+    int minute;          // Minute of the day, 0-1439
+    int with_time;       // Append " HH:MM"
+    char text[TIMEBASE_LABEL_LEN];
+};
+
+// Days since 1970-01-01 of a proleptic Gregorian date, and back.
+long timebase_days_from_civil(long year, int month, int day);
+void timebase_civil_from_days(long days, long *year, int *month, int *day);
+
+// Parses "YYYY-MM-DD", "YYYY-MM-DD HH:MM" or "YYYY-MM-DDTHH:MM" (UTC) into
+// Unix seconds. Returns 0, or -1 if the text is not a valid time.
+int timebase_parse(const char *text, int64_t *t);
+
+// Parses a step such as "1h" into seconds. Returns 0, or -1 if the text is
+// not a positive whole number of minutes.
+int timebase_parse_step(const char *text, int64_t *step);
+
+// Returns 1 if rows start + k * step need a time of day in their labels.
+int timebase_has_time(int64_t start, int64_t step);
+
+// Writes the label of `t` into `out` (TIMEBASE_LABEL_LEN bytes).
+void timebase_format(int64_t t, int with_time, char *out);
+
+// Writes `step` as a Horizons STEP_SIZE value ("1d", "6h", "90m").
+void timebase_horizons_step(int64_t step, char *out, size_t len);
+
+// Sets `label` to the time `t`.
+void time_label_init(struct TimeLabel *label, int64_t t, int with_time);
+
+// Advances `label` by `step` seconds (whole minutes).
+void time_label_advance(struct TimeLabel *label, int64_t step);
+
+#endif // TIMEBASE_H
@@ -4,235 +4,253 @@
  * planetary longitude data and saves it to a CSV file.
  *
  * This program fetches the orbital elements for each planet from NASA for a
- * single "epoch" date. It then uses Kepler's equations to calculate the daily
- * positions of the planets over a user-specified date range, providing a
- * very fast alternative to making an API call for every single day.
+ * single "epoch" date. It then uses Kepler's equations to calculate the
+ * positions of the planets over a user-specified date range, once per
+ * "-step" (default 1d; e.g. "-step 1h", see common/timebase.h), providing a
+ * very fast alternative to making an API call for every single sample.
+ * Times are UTC seconds throughout, so rows never shift with daylight
+ * saving.
+ *
+ * The rows are split over "-threads N" worker threads (default: one per CPU,
+ * 0 also means that). Output is written in date order and is byte-identical
+ * to a "-threads 1" run. Rows are formatted without printf (see
+ * common/csv_writer.h) and progress is printed a few times a second.
+ *
+ * Responses are cached on disk; "-offline", "-no-cache", "-cache-dir DIR",
+ * "-cache-ttl SECONDS" and "-cache-clear" control the cache (see cache.h).
+ *
+ * The prompts can be answered up front with "-epoch", "-start" and "-end"
+ * (YYYY-MM-DD; the start and end may add " HH:MM" in UTC) and "-output
+ * FILE", or from a "-config FILE" (see cli.h); "-output -" writes the CSV
+ * to stdout.
+ *
+ * "-stats" prints fetch, solver and output figures at exit (see stats.h).
  *
  * Compilation:
- * gcc kepler_sim.c -o kepler_sim -lcurl -ljansson -lm
+ * gcc kepler_sim.c ../common/cli.c ../common/fetch.c ../common/cache.c ../common/horizons_parse.c ../common/kepler.c ../common/elements.c ../common/chunk_pool.c ../common/csv_writer.c ../common/progress.c ../common/timebase.c ../common/stats.c -I../common -o kepler_sim -lcurl -lm -pthread
  */
 
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <curl/curl.h>
-#include <jansson.h>
 #include <math.h>
-#include <time.h>
+#include "fetch.h"
+#include "cache.h"
+#include "kepler.h"
+#include "elements.h"
+#include "chunk_pool.h"
+#include "csv_writer.h"
+#include "progress.h"
+#include "cli.h"
+#include "timebase.h"
+#include "stats.h"
 
 // --- Constants ---
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 #define SECONDS_IN_DAY (24 * 60 * 60)
-#define AU_TO_KM 149597870.7
-
-// Struct to hold the response data from a curl request.
-struct MemoryStruct {
-    char *memory;
-    size_t size;
-};
+#define ROWS_PER_CHUNK 1024 // Rows formatted per chunk_pool work item
 
 // Struct to hold a planet's Keplerian orbital elements.
 struct Planet {
-    const char *name;
-    const char *id;
-    // --- Orbital Elements ---
-    double eccentricity; // e
-    double semi_major_axis_au; // a
-    double inclination_deg; // i
-    double lon_asc_node_deg; // LAN
-    double arg_periapsis_deg; // w
-    double mean_anomaly_deg; // M at epoch
-    time_t epoch; // The time at which these elements are valid
+    struct ElementsBody body;
+    struct KeplerElements elements; // From elements_fetch
+    int64_t epoch; // The time at which these elements are valid, UTC Unix seconds
+};
+
+// Shared, read-only state for the chunked simulation.
+struct SimJob {
+    struct Planet *planets;
+    int num_planets;
+    int64_t start_t;   // Time of row 0, UTC Unix seconds
+    int64_t step;      // Seconds between rows
+    int with_time;     // Labels carry the time of day
+    long num_rows;
+    struct CsvWriter *writer;
+    struct Progress progress;   // Only touched on the writing thread
 };
 
+static struct StatsEntry rows_written = STATS_ENTRY("output.rows", STATS_COUNTER, "rows");
+
 // --- Function Prototypes ---
-static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp);
-int fetch_orbital_elements(struct Planet *planet, const char* epoch_str);
-double calculate_longitude(struct Planet *planet, time_t current_date);
+double calculate_longitude(const struct Planet *planet, int64_t current_t);
+static int simulate_chunk(long chunk, int worker, struct ChunkBuffer *out, void *userp);
+static int write_chunk(long chunk, const struct ChunkBuffer *out, void *userp);
 
 // --- Main ---
-int main(void) {
-    struct Planet planets[] = {
-        {"Mercury", "199"}, {"Venus", "299"}, {"Earth", "399"},
-        {"Mars", "499"}, {"Jupiter", "599"}, {"Saturn", "699"},
-        {"Uranus", "799"}, {"Neptune", "899"}, {"Pluto", "999"}
-    };
-    int num_planets = sizeof(planets) / sizeof(planets[0]);
+int main(int argc, char *argv[]) {
+    struct Planet planets[ELEMENTS_NUM_PLANETS] = {{{0}}};
+    int num_planets = ELEMENTS_NUM_PLANETS;
+    for (int i = 0; i < num_planets; i++) planets[i].body = ELEMENTS_PLANETS[i];
+
+    // Check for parameter, cache and thread flags
+    int num_threads = chunk_pool_default_threads();
+    static const char *const param_names[] = {"epoch", "start", "end", "output", "step", NULL};
+    struct CliParams params;
+    cli_init(&params, param_names);
+    for (int a = 1; a < argc; a++) {
+        int used = cli_parse_option(argc, argv, &a, &params);
+        if (used < 0) return 1;
+        if (!used && !cache_parse_option(argc, argv, &a) && !stats_parse_option(argc, argv, &a) &&
+            !chunk_pool_parse_option(argc, argv, &a, &num_threads)) {
+            fprintf(stderr, "Error: Unknown option '%s'.\n", argv[a]);
+            return 1;
+        }
+    }
+    cli_begin(&params);
 
     // --- Get User Input ---
-    char start_date_input[11], end_date_input[11], epoch_date_input[11], output_filename[100];
+    char start_date_input[TIMEBASE_LABEL_LEN], end_date_input[TIMEBASE_LABEL_LEN];
+    char epoch_date_input[TIMEBASE_LABEL_LEN], output_filename[100];
 
     printf("--- High-Speed Keplerian Orbit Simulator ---\n");
-    printf("Enter Epoch Date (YYYY-MM-DD) to get orbital elements (e.g., 2000-01-01): ");
-    scanf("%10s", epoch_date_input);
-    printf("Enter Start Date for simulation (YYYY-MM-DD): ");
-    scanf("%10s", start_date_input);
-    printf("Enter End Date for simulation (YYYY-MM-DD): ");
-    scanf("%10s", end_date_input);
-    printf("Enter Output Filename (e.g., kepler_data.csv): ");
-    scanf("%99s", output_filename);
+    if (cli_prompt_string(&params, "epoch", "Enter Epoch Date (YYYY-MM-DD) to get orbital elements (e.g., 2000-01-01): ",
+                          epoch_date_input, sizeof(epoch_date_input)) != 0 ||
+        cli_prompt_string(&params, "start", "Enter Start Date for simulation (YYYY-MM-DD): ",
+                          start_date_input, sizeof(start_date_input)) != 0 ||
+        cli_prompt_string(&params, "end", "Enter End Date for simulation (YYYY-MM-DD): ",
+                          end_date_input, sizeof(end_date_input)) != 0 ||
+        cli_prompt_string(&params, "output", "Enter Output Filename (e.g., kepler_data.csv): ",
+                          output_filename, sizeof(output_filename)) != 0) {
+        return 1;
+    }
+    int64_t epoch_t, start_t, end_t, step = TIMEBASE_DEFAULT_STEP;
+    if (timebase_parse(epoch_date_input, &epoch_t) != 0 || epoch_t % SECONDS_IN_DAY != 0 ||
+        timebase_parse(start_date_input, &start_t) != 0 || timebase_parse(end_date_input, &end_t) != 0) {
+        fprintf(stderr, "Error: Dates must be YYYY-MM-DD (or YYYY-MM-DD HH:MM for the start and end).\n");
+        return 1;
+    }
+    if (cli_get(&params, "step") && timebase_parse_step(cli_get(&params, "step"), &step) != 0) {
+        fprintf(stderr, "Error: -step must be %s.\n", TIMEBASE_STEP_HELP);
+        return 1;
+    }
 
     // --- Fetch Orbital Elements for the Epoch ---
     printf("\nFetching orbital elements from NASA for epoch %s...\n", epoch_date_input);
-    curl_global_init(CURL_GLOBAL_ALL);
+    if (fetch_init() != 0) {
+        fprintf(stderr, "Error: Could not initialise libcurl.\n");
+        return 1;
+    }
     for (int i = 0; i < num_planets; i++) {
-        if (fetch_orbital_elements(&planets[i], epoch_date_input) != 0) {
-            fprintf(stderr, "Failed to fetch or parse data for %s. Aborting.\n", planets[i].name);
+        // The raw replies are always echoed, as a record of the elements used.
+        if (elements_fetch(&planets[i].body, epoch_t, 1, &planets[i].elements) != 0) {
+            fprintf(stderr, "Failed to fetch or parse data for %s. Aborting.\n", planets[i].body.name);
             return 1;
         }
+        planets[i].epoch = epoch_t;
     }
     printf("Successfully fetched all orbital elements.\n\n");
 
     // --- Open File for Writing ---
-    FILE *outfile = fopen(output_filename, "w");
+    FILE *outfile = cli_open_output(output_filename, "w");
     if (outfile == NULL) {
         perror("Error opening output file");
         return 1;
     }
     fprintf(outfile, "Date");
-    for (int i = 0; i < num_planets; i++) fprintf(outfile, ",%s", planets[i].name);
+    for (int i = 0; i < num_planets; i++) fprintf(outfile, ",%s", planets[i].body.name);
     fprintf(outfile, "\n");
 
     // --- Main Simulation Loop ---
-    struct tm start_tm = {0}, end_tm = {0};
-    sscanf(start_date_input, "%d-%d-%d", &start_tm.tm_year, &start_tm.tm_mon, &start_tm.tm_mday);
-    sscanf(end_date_input, "%d-%d-%d", &end_tm.tm_year, &end_tm.tm_mon, &end_tm.tm_mday);
-    start_tm.tm_year -= 1900; start_tm.tm_mon -= 1;
-    end_tm.tm_year -= 1900; end_tm.tm_mon -= 1;
-    time_t start_t = mktime(&start_tm);
-    time_t end_t = mktime(&end_tm);
-    time_t current_t = start_t;
-
-    while (current_t <= end_t) {
-        char date_str[11];
-        strftime(date_str, sizeof(date_str), "%Y-%m-%d", localtime(&current_t));
-        printf("Calculating: %s\r", date_str);
-        fflush(stdout);
-
-        fprintf(outfile, "%s", date_str);
-        for (int i = 0; i < num_planets; i++) {
-            double longitude = calculate_longitude(&planets[i], current_t);
-            fprintf(outfile, ",%.4f", longitude);
-        }
-        fprintf(outfile, "\n");
-        
-        current_t += SECONDS_IN_DAY;
+    // Rows are formatted in chunks by the worker threads and written out in
+    // date order by chunk_pool.
+    struct CsvWriter writer;
+    if (csv_writer_init(&writer, outfile, 0) != 0) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return 1;
     }
+    struct SimJob job = {planets, num_planets, start_t, step, timebase_has_time(start_t, step), 0, &writer};
+    progress_init(&job.progress, 0);
+    job.num_rows = (end_t >= start_t) ? (long)((end_t - start_t) / step) + 1 : 0;
+    long num_chunks = (job.num_rows + ROWS_PER_CHUNK - 1) / ROWS_PER_CHUNK;
+    int status = chunk_pool_run(num_chunks, num_threads, simulate_chunk, write_chunk, &job);
+    if (csv_writer_finish(&writer) != 0 && status == 0) {
+        perror("Error writing output file");
+        status = -1;
+    }
+    if (status != 0) fprintf(stderr, "\nError: Simulation failed.\n");
 
     // --- Cleanup ---
     fclose(outfile);
-    curl_global_cleanup();
+    fetch_cleanup();
+    if (status != 0) return 1;
     printf("\n\nSimulation complete. File '%s' has been created.\n", output_filename);
     return 0;
 }
 
 // --- Function Implementations ---
 
-static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    struct MemoryStruct *mem = (struct MemoryStruct *)userp;
-    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
-    if (ptr == NULL) return 0;
-    mem->memory = ptr;
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->memory[mem->size] = 0;
-    return realsize;
+// Computes and formats the rows in one chunk (worker thread).
+static int simulate_chunk(long chunk, int worker, struct ChunkBuffer *out, void *userp) {
+    const struct SimJob *job = (const struct SimJob *)userp;
+    long first = chunk * ROWS_PER_CHUNK;
+    long last = first + ROWS_PER_CHUNK;
+    if (last > job->num_rows) last = job->num_rows;
+    (void)worker;
+
+    // Labels advance incrementally from a single conversion per chunk.
+    int64_t current_t = job->start_t + (int64_t)first * job->step;
+    struct TimeLabel date;
+    time_label_init(&date, current_t, job->with_time);
+    size_t row_max = sizeof(date.text) + (size_t)job->num_planets * (1 + CSV_FIXED_MAX_LEN) + 1;
+    for (long row = first; row < last; row++) {
+        char *p = chunk_buffer_reserve(out, row_max);
+        if (p == NULL) return -1;
+        for (const char *t = date.text; *t; t++) *p++ = *t;
+        for (int i = 0; i < job->num_planets; i++) {
+            *p++ = ',';
+            p = csv_put_fixed(p, calculate_longitude(&job->planets[i], current_t), 4);
+        }
+        *p++ = '\n';
+        out->len = (size_t)(p - out->data);
+        current_t += job->step;
+        time_label_advance(&date, job->step);
+    }
+    return 0;
 }
 
-// Fetches orbital elements from NASA for a given epoch
-int fetch_orbital_elements(struct Planet *planet, const char* epoch_str) {
-    CURL *curl_handle = curl_easy_init();
-    if (!curl_handle) return -1;
-
-    // Calculate the day after the epoch for a valid API date range
-    struct tm epoch_tm = {0};
-    sscanf(epoch_str, "%d-%d-%d", &epoch_tm.tm_year, &epoch_tm.tm_mon, &epoch_tm.tm_mday);
-    epoch_tm.tm_year -= 1900;
-    epoch_tm.tm_mon -= 1;
-    time_t epoch_t = mktime(&epoch_tm);
-    epoch_t += SECONDS_IN_DAY; // Add one day
-    struct tm *next_day_tm = localtime(&epoch_t);
-    char next_day_str[11];
-    strftime(next_day_str, sizeof(next_day_str), "%Y-%m-%d", next_day_tm);
-
-    struct MemoryStruct chunk = { .memory = malloc(1), .size = 0 };
-    char url[512];
-    snprintf(url, sizeof(url),
-             "https://ssd.jpl.nasa.gov/api/horizons.api?format=text&COMMAND='%s'&OBJ_DATA='NO'&MAKE_EPHEM='YES'&EPHEM_TYPE='ELEMENTS'&CENTER='@sun'&START_TIME='%s'&STOP_TIME='%s'",
-             planet->id, epoch_str, next_day_str);
-
-    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0L);
-    curl_easy_setopt(curl_handle, CURLOPT_URL, url);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
-    
-    int success = -1;
-    if (curl_easy_perform(curl_handle) == CURLE_OK) {
-        // --- DIAGNOSTIC ---
-        printf("\n--- RAW API RESPONSE for %s ---\n", planet->name);
-        printf("%s\n", chunk.memory);
-        printf("-------------------------------------\n");
-        // --- END DIAGNOSTIC ---
-
-        char* elements_start = strstr(chunk.memory, "$$SOE");
-        if (elements_start) {
-            char *ptr;
-            int parsed_count = 0;
-            double semi_major_axis_km = 0;
-
-            if ((ptr = strstr(elements_start, "EC="))) parsed_count += sscanf(ptr, "EC= %lf", &planet->eccentricity);
-            if ((ptr = strstr(elements_start, "IN="))) parsed_count += sscanf(ptr, "IN= %lf", &planet->inclination_deg);
-            if ((ptr = strstr(elements_start, "OM="))) parsed_count += sscanf(ptr, "OM= %lf", &planet->lon_asc_node_deg);
-            if ((ptr = strstr(elements_start, "W ="))) parsed_count += sscanf(ptr, "W = %lf", &planet->arg_periapsis_deg);
-            if ((ptr = strstr(elements_start, "MA="))) parsed_count += sscanf(ptr, "MA= %lf", &planet->mean_anomaly_deg);
-            if ((ptr = strstr(elements_start, "A ="))) parsed_count += sscanf(ptr, "A = %lf", &semi_major_axis_km);
-            
-            // Convert Semi-major axis from km to AU
-            planet->semi_major_axis_au = semi_major_axis_km / AU_TO_KM;
-
-            if (parsed_count == 6) {
-                planet->epoch = mktime(&epoch_tm);
-                success = 0;
-            } else {
-                 fprintf(stderr, "  - Error: Could only parse %d of 6 orbital elements for %s.\n", parsed_count, planet->name);
-            }
-        } else {
-            fprintf(stderr, "  - Error: Could not find $$SOE marker for %s.\n", planet->name);
-        }
+// Writes a finished chunk to the output file (main thread, in date order).
+static int write_chunk(long chunk, const struct ChunkBuffer *out, void *userp) {
+    struct SimJob *job = (struct SimJob *)userp;
+    csv_writer_write(job->writer, out->data, out->len);
+    if (job->writer->failed) {
+        perror("Error writing output file");
+        return -1;
     }
 
-    curl_easy_cleanup(curl_handle);
-    free(chunk.memory);
-    return success;
+    long first = chunk * ROWS_PER_CHUNK, last = first + ROWS_PER_CHUNK - 1;
+    if (last > job->num_rows - 1) last = job->num_rows - 1;
+    STATS_ADD(rows_written, last - first + 1);
+    if (last < job->num_rows - 1 && !progress_due(&job->progress)) return 0;
+    char date_str[TIMEBASE_LABEL_LEN];
+    timebase_format(job->start_t + (int64_t)last * job->step, job->with_time, date_str);
+    printf("Calculating: %s\r", date_str);
+    fflush(stdout);
+    return 0;
 }
 
-// Calculates the geocentric longitude of a planet for a given date
-double calculate_longitude(struct Planet *planet, time_t current_date) {
-    if (planet->semi_major_axis_au <= 0) {
+// Calculates the geocentric longitude of a planet at a given time
+double calculate_longitude(const struct Planet *planet, int64_t current_t) {
+    const struct KeplerElements *el = &planet->elements;
+    if (el->semi_major_axis_au <= 0) {
         return NAN;
     }
 
-    double days_since_epoch = difftime(current_date, planet->epoch) / SECONDS_IN_DAY;
-    double mean_motion = 360.0 / (sqrt(pow(planet->semi_major_axis_au, 3)) * 365.25);
-    double mean_anomaly = fmod(planet->mean_anomaly_deg + mean_motion * days_since_epoch, 360.0);
+    double days_since_epoch = (double)(current_t - planet->epoch) / SECONDS_IN_DAY;
+    double mean_motion = 360.0 / (sqrt(pow(el->semi_major_axis_au, 3)) * 365.25);
+    double mean_anomaly = fmod(el->mean_anomaly_deg + mean_motion * days_since_epoch, 360.0);
     double M_rad = mean_anomaly * M_PI / 180.0;
 
-    double E_rad = M_rad;
-    for (int i = 0; i < 10; i++) {
-        E_rad = E_rad - (E_rad - planet->eccentricity * sin(E_rad) - M_rad) / (1 - planet->eccentricity * cos(E_rad));
-    }
+    double E_rad = kepler_solve(M_rad, el->eccentricity, NULL);
 
-    double x_orb = planet->semi_major_axis_au * (cos(E_rad) - planet->eccentricity);
-    double y_orb = planet->semi_major_axis_au * sqrt(1 - planet->eccentricity * planet->eccentricity) * sin(E_rad);
+    double x_orb = el->semi_major_axis_au * (cos(E_rad) - el->eccentricity);
+    double y_orb = el->semi_major_axis_au * sqrt(1 - el->eccentricity * el->eccentricity) * sin(E_rad);
 
-    double w_rad = planet->arg_periapsis_deg * M_PI / 180.0;
-    double N_rad = planet->lon_asc_node_deg * M_PI / 180.0;
-    double i_rad = planet->inclination_deg * M_PI / 180.0;
+    double w_rad = el->arg_periapsis_deg * M_PI / 180.0;
+    double N_rad = el->lon_asc_node_deg * M_PI / 180.0;
+    double i_rad = el->inclination_deg * M_PI / 180.0;
 
     double x_ecl = x_orb * (cos(w_rad) * cos(N_rad) - sin(w_rad) * sin(N_rad) * cos(i_rad)) -
                    y_orb * (sin(w_rad) * cos(N_rad) + cos(w_rad) * sin(N_rad) * cos(i_rad));
@@ -4,251 +4,517 @@
  * 3D planetary position data and saves it to a CSV file.
  *
  * This program fetches orbital elements from NASA for the simulation's start
- * date (the epoch). It then uses Kepler's equations to calculate the daily
- * X, Y, and Z coordinates of the planets over a user-specified date range.
+ * date (the epoch, see common/elements.h). It then uses Kepler's equations
+ * to calculate the X, Y, and Z coordinates of the planets over a
+ * user-specified date range, once per "-step" (default 1d; e.g. "-step 1h"
+ * or "-step 10m", see common/timebase.h). Times are UTC seconds throughout,
+ * so rows never shift with daylight saving. Rows are propagated in batches
+ * through the vectorized propagator in common/kepler.h. The batches are
+ * spread over "-threads N" worker threads (default: one per CPU, 0 also
+ * means that); each formats its rows into its own buffer and the buffers are
+ * written out in date order, so the file is byte-identical to a "-threads 1"
+ * run. Rows are formatted without printf (see common/csv_writer.h) and
+ * progress is printed a few times a second.
+ *
+ * "-binary" writes the compact binary ephemeris format of common/ephemeris.h
+ * instead of CSV, with float64 columns; "-float32" does the same with
+ * float32 columns, halving the size again.
  *
  * A "-debug" command-line argument can be used to display raw API responses.
+ * Responses are cached on disk; "-offline", "-no-cache", "-cache-dir DIR",
+ * "-cache-ttl SECONDS" and "-cache-clear" control the cache (see cache.h).
+ *
+ * The prompts can be answered up front with "-start" and "-end"
+ * (YYYY-MM-DD, or "YYYY-MM-DD HH:MM" in UTC) and "-output FILE", or from a
+ * "-config FILE" (see cli.h). "-output -" streams the CSV to stdout, e.g.
+ * straight into "multi_alignment_finder -input -".
+ *
+ * "-chebyshev" writes Chebyshev-polynomial segments instead (see
+ * common/chebyshev.h): each "-segment-days N" segment (default 32) holds
+ * "-coefficients N" coefficients per axis (default 16), fitted through the
+ * propagator at the segment's Chebyshev nodes, so positions can later be
+ * evaluated at any time in the range rather than once a day.
+ *
+ * "-scan alignments,aspects,approaches" skips the ephemeris altogether: each
+ * chunk of rows goes straight from the propagator into the event detectors
+ * (see common/pipeline.h) and is dropped, and the output file receives the
+ * event report instead. Memory use then no longer depends on the date range.
+ * The detectors take "-threshold", "-min-planets", "-aspects" and "-count"
+ * like multi_alignment_finder, and prompt for any that are missing.
+ *
+ * "-stats" prints fetch, propagator, output and detector figures at exit
+ * (see common/stats.h).
  *
  * Compilation:
- * gcc kepler_sim_3d.c -o kepler_sim_3d -lcurl -ljansson -lm
+ * gcc kepler_sim_3d.c ../common/cli.c ../common/fetch.c ../common/cache.c ../common/horizons_parse.c ../common/kepler.c ../common/elements.c ../common/chunk_pool.c ../common/csv_writer.c ../common/progress.c ../common/ephemeris.c ../common/chebyshev.c ../common/pipeline.c ../common/groups.c ../common/clusters.c ../common/events.c ../common/aspects.c ../common/approaches.c ../common/frame_store.c ../common/dataset.c ../common/timebase.c ../common/stats.c -I../common -fopenmp-simd -o kepler_sim_3d -lcurl -lm -pthread
  */
 
 #define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <curl/curl.h>
-#include <jansson.h>
 #include <math.h>
-#include <time.h>
+#include "fetch.h"
+#include "cache.h"
+#include "horizons_parse.h"
+#include "kepler.h"
+#include "elements.h"
+#include "chunk_pool.h"
+#include "csv_writer.h"
+#include "progress.h"
+#include "ephemeris.h"
+#include "cli.h"
+#include "pipeline.h"
+#include "chebyshev.h"
+#include "timebase.h"
+#include "stats.h"
 
 // --- Constants ---
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 #define SECONDS_IN_DAY (24 * 60 * 60)
-#define AU_TO_KM 149597870.7
+#define ROWS_PER_BATCH 1024 // Rows propagated per call to kepler_batch_propagate
+#define DEFAULT_SEGMENT_DAYS 32 // Chebyshev segment length for -chebyshev
+#define DEFAULT_COEFFICIENTS 16 // Chebyshev coefficients per axis and segment
 
-// Struct to hold the response data from a curl request.
-struct MemoryStruct {
-    char *memory;
-    size_t size;
+// Shared, read-only state for the chunked simulation.
+struct SimJob {
+    const struct KeplerBatch *batch;
+    int num_planets;
+    int64_t start_t;   // Time of row 0, UTC Unix seconds
+    int64_t step;      // Seconds between rows
+    int with_time;     // Labels carry the time of day
+    long num_rows;
+    double *scratch;   // 3 * ROWS_PER_BATCH * num_planets doubles per worker
+    struct CsvWriter *writer;            // CSV output, or...
+    struct EphemerisWriter *ephemeris;   // ...binary output (see ephemeris.h), or...
+    struct Pipeline *pipeline;           // ...an event scan (see pipeline.h)
+    struct Progress progress;   // Only touched on the writing thread
 };
 
-// Struct to hold a planet's Keplerian orbital elements.
-struct Planet {
-    const char *name;
-    const char *id;
-    // --- Orbital Elements ---
-    double eccentricity;
-    double semi_major_axis_au;
-    double inclination_deg;
-    double lon_asc_node_deg;
-    double arg_periapsis_deg;
-    double mean_anomaly_deg;
-    time_t epoch;
-    // --- Calculated Position ---
-    double x, y, z; // Heliocentric ecliptic coordinates in AU
-};
+static struct StatsEntry rows_written = STATS_ENTRY("output.rows", STATS_COUNTER, "rows");
 
 // --- Function Prototypes ---
-static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp);
-int fetch_orbital_elements(struct Planet *planet, const char* epoch_str, int debug_mode);
-void calculate_position(struct Planet *planet, time_t current_date);
+static int simulate_chunk(long chunk, int worker, struct ChunkBuffer *out, void *userp);
+static int write_chunk(long chunk, const struct ChunkBuffer *out, void *userp);
+static int setup_scan(struct CliParams *params, struct PipelineOptions *options, struct AspectTable *aspects);
+static void sim_time_label(double row, int with_time, char *out, void *userp);
+static int write_chebyshev(const struct KeplerBatch *batch, const char *const names[], int num_planets,
+                           int64_t start_t, int64_t end_t, int segment_days, int num_coeffs, const char *path);
 
 // --- Main ---
 int main(int argc, char *argv[]) {
-    struct Planet planets[] = {
-        {"Mercury", "199"}, {"Venus", "299"}, {"Earth", "399"},
-        {"Mars", "499"}, {"Jupiter", "599"}, {"Saturn", "699"},
-        {"Uranus", "799"}, {"Neptune", "899"}, {"Pluto", "999"}
-    };
-    int num_planets = sizeof(planets) / sizeof(planets[0]);
-
-    // Check for debug flag
+    const struct ElementsBody *planets = ELEMENTS_PLANETS;
+    int num_planets = ELEMENTS_NUM_PLANETS;
+
+    // Check for debug, output format, cache and thread flags
     int debug_mode = 0;
-    if (argc > 1 && strcmp(argv[1], "-debug") == 0) {
-        debug_mode = 1;
-        printf("Debug mode enabled.\n");
+    int binary_value_size = 0; // 0 = CSV output
+    int chebyshev_mode = 0;
+    int segment_days = DEFAULT_SEGMENT_DAYS, num_coeffs = DEFAULT_COEFFICIENTS;
+    int num_threads = chunk_pool_default_threads();
+    static const char *const param_names[] = {"start", "end", "output", "step", "scan", "threshold",
+                                              "min-planets", "aspects", "count", NULL};
+    struct CliParams params;
+    cli_init(&params, param_names);
+    for (int a = 1; a < argc; a++) {
+        int used = cli_parse_option(argc, argv, &a, &params);
+        if (used < 0) return 1;
+        if (used || cache_parse_option(argc, argv, &a) || stats_parse_option(argc, argv, &a) ||
+            chunk_pool_parse_option(argc, argv, &a, &num_threads)) {
+            continue;
+        } else if (strcmp(argv[a], "-debug") == 0) {
+            debug_mode = 1;
+        } else if (strcmp(argv[a], "-binary") == 0) {
+            binary_value_size = 8;
+        } else if (strcmp(argv[a], "-float32") == 0) {
+            binary_value_size = 4;
+        } else if (strcmp(argv[a], "-chebyshev") == 0) {
+            chebyshev_mode = 1;
+        } else if (strcmp(argv[a], "-segment-days") == 0 && a + 1 < argc) {
+            segment_days = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-coefficients") == 0 && a + 1 < argc) {
+            num_coeffs = atoi(argv[++a]);
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'.\n", argv[a]);
+            return 1;
+        }
     }
 
     // --- Get User Input ---
-    char start_date_input[11], end_date_input[11], output_filename[100];
+    char start_date_input[TIMEBASE_LABEL_LEN], end_date_input[TIMEBASE_LABEL_LEN], output_filename[100];
+    cli_begin(&params);
+    if (debug_mode) printf("Debug mode enabled.\n");
 
+    int scan_mode = cli_get(&params, "scan") != NULL;
     printf("--- 3D High-Speed Keplerian Orbit Simulator ---\n");
-    printf("Enter Start Date for simulation (YYYY-MM-DD): ");
-    if (scanf("%10s", start_date_input) != 1) {
-        fprintf(stderr, "Error: Invalid input format.\n"); return 1;
+    if (cli_prompt_string(&params, "start", "Enter Start Date for simulation (YYYY-MM-DD): ",
+                          start_date_input, sizeof(start_date_input)) != 0 ||
+        cli_prompt_string(&params, "end", "Enter End Date for simulation (YYYY-MM-DD): ",
+                          end_date_input, sizeof(end_date_input)) != 0 ||
+        cli_prompt_string(&params, "output", scan_mode ? "Enter Report Filename (e.g., events.txt): "
+                                                       : "Enter Output Filename (e.g., data_3d.csv): ",
+                          output_filename, sizeof(output_filename)) != 0) {
+        return 1;
+    }
+    int64_t start_t, end_t, step = TIMEBASE_DEFAULT_STEP;
+    if (timebase_parse(start_date_input, &start_t) != 0 || timebase_parse(end_date_input, &end_t) != 0) {
+        fprintf(stderr, "Error: Dates must be YYYY-MM-DD or YYYY-MM-DD HH:MM.\n");
+        return 1;
+    }
+    if (cli_get(&params, "step") && timebase_parse_step(cli_get(&params, "step"), &step) != 0) {
+        fprintf(stderr, "Error: -step must be %s.\n", TIMEBASE_STEP_HELP);
+        return 1;
     }
-    printf("Enter End Date for simulation (YYYY-MM-DD): ");
-    if (scanf("%10s", end_date_input) != 1) {
-        fprintf(stderr, "Error: Invalid input format.\n"); return 1;
+    if ((binary_value_size || chebyshev_mode) && cli_is_stdio(output_filename)) {
+        fprintf(stderr, "Error: Binary output is written column by column and needs a real file; use CSV for stdout.\n");
+        return 1;
     }
-    printf("Enter Output Filename (e.g., data_3d.csv): ");
-    if (scanf("%99s", output_filename) != 1) {
-        fprintf(stderr, "Error: Invalid input format.\n"); return 1;
+    if ((binary_value_size || chebyshev_mode) && scan_mode) {
+        fprintf(stderr, "Error: -scan writes an event report, not an ephemeris; drop -binary/-float32/-chebyshev.\n");
+        return 1;
+    }
+    if (chebyshev_mode && (segment_days < 1 || num_coeffs < 2 || num_coeffs > CHEBYSHEV_MAX_COEFFS)) {
+        fprintf(stderr, "Error: -segment-days must be at least 1 and -coefficients between 2 and %d.\n",
+                CHEBYSHEV_MAX_COEFFS);
+        return 1;
+    }
+    struct PipelineOptions scan_options = {0};
+    struct AspectTable scan_aspects;
+    if (scan_mode && setup_scan(&params, &scan_options, &scan_aspects) != 0) {
+        return 1;
     }
 
-    // --- Fetch Orbital Elements for the Epoch (which is the start date) ---
-    printf("\nFetching orbital elements from NASA for epoch %s...\n", start_date_input);
-    curl_global_init(CURL_GLOBAL_ALL);
+    // --- Fetch Orbital Elements for the Epoch (midnight of the start date) ---
+    int64_t epoch_t = start_t - start_t % TIMEBASE_SECONDS_PER_DAY;
+    if (start_t % TIMEBASE_SECONDS_PER_DAY < 0) epoch_t -= TIMEBASE_SECONDS_PER_DAY;
+    char epoch_label[TIMEBASE_LABEL_LEN];
+    timebase_format(epoch_t, 0, epoch_label);
+    printf("\nFetching orbital elements from NASA for epoch %s...\n", epoch_label);
+    if (fetch_init() != 0) {
+        fprintf(stderr, "Error: Could not initialise libcurl.\n");
+        return 1;
+    }
+    struct KeplerElements elements[ELEMENTS_NUM_PLANETS];
     for (int i = 0; i < num_planets; i++) {
-        if (fetch_orbital_elements(&planets[i], start_date_input, debug_mode) != 0) {
+        if (elements_fetch(&planets[i], epoch_t, debug_mode, &elements[i]) != 0) {
             fprintf(stderr, "Failed to fetch or parse data for %s. Aborting.\n", planets[i].name);
             return 1;
         }
     }
     printf("Successfully fetched all orbital elements.\n\n");
 
-    // --- Open File for Writing ---
-    FILE *outfile = fopen(output_filename, "w");
-    if (outfile == NULL) {
-        perror("Error opening output file");
+    // --- Main Simulation Loop ---
+    // Precompute each planet's mean motion and rotation matrix once.
+    struct KeplerBatch batch;
+    if (kepler_batch_init(&batch, elements, num_planets) != 0) {
+        fprintf(stderr, "Error: Out of memory.\n");
         return 1;
     }
-    fprintf(outfile, "Date");
-    for (int i = 0; i < num_planets; i++) fprintf(outfile, ",%s_x,%s_y,%s_z", planets[i].name, planets[i].name, planets[i].name);
-    fprintf(outfile, "\n");
 
-    // --- Main Simulation Loop ---
-    struct tm start_tm = {0}, end_tm = {0};
-    sscanf(start_date_input, "%d-%d-%d", &start_tm.tm_year, &start_tm.tm_mon, &start_tm.tm_mday);
-    sscanf(end_date_input, "%d-%d-%d", &end_tm.tm_year, &end_tm.tm_mon, &end_tm.tm_mday);
-    start_tm.tm_year -= 1900; start_tm.tm_mon -= 1;
-    end_tm.tm_year -= 1900; end_tm.tm_mon -= 1;
-    time_t start_t = mktime(&start_tm);
-    time_t end_t = mktime(&end_tm);
-    time_t current_t = start_t;
-
-    while (current_t <= end_t) {
-        char date_str[11];
-        strftime(date_str, sizeof(date_str), "%Y-%m-%d", localtime(&current_t));
-        printf("Calculating: %s\r", date_str);
-        fflush(stdout);
-
-        fprintf(outfile, "%s", date_str);
-        for (int i = 0; i < num_planets; i++) {
-            calculate_position(&planets[i], current_t);
-            fprintf(outfile, ",%.6f,%.6f,%.6f", planets[i].x, planets[i].y, planets[i].z);
+    // Each chunk of ROWS_PER_BATCH rows is propagated and formatted by a
+    // worker; chunk_pool writes the chunks out in date order.
+    struct SimJob job = {0};
+    job.batch = &batch;
+    job.num_planets = num_planets;
+    job.start_t = start_t;
+    job.step = step;
+    job.with_time = timebase_has_time(start_t, step);
+    job.num_rows = (end_t >= start_t) ? (long)((end_t - start_t) / step) + 1 : 0;
+    if (chebyshev_mode) {
+        const char *names[ELEMENTS_NUM_PLANETS];
+        for (int i = 0; i < num_planets; i++) names[i] = planets[i].name;
+        int status = write_chebyshev(&batch, names, num_planets, start_t, end_t, segment_days, num_coeffs,
+                                     output_filename);
+        kepler_batch_free(&batch);
+        fetch_cleanup();
+        if (status != 0) {
+            fprintf(stderr, "\nError: Simulation failed.\n");
+            return 1;
+        }
+        printf("Simulation complete. File '%s' has been created.\n", output_filename);
+        return 0;
+    }
+    progress_init(&job.progress, 0);
+    size_t scratch_len = (size_t)3 * ROWS_PER_BATCH * num_planets;
+    job.scratch = malloc(sizeof(double) * scratch_len * num_threads);
+    if (job.scratch == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return 1;
+    }
+
+    // --- Open File for Writing ---
+    FILE *outfile = NULL;
+    struct CsvWriter writer;
+    struct EphemerisWriter ephemeris;
+    struct Pipeline pipeline;
+    if (scan_mode) {
+        const char *names[ELEMENTS_NUM_PLANETS];
+        for (int i = 0; i < num_planets; i++) names[i] = planets[i].name;
+        outfile = cli_open_output(output_filename, "w");
+        if (outfile == NULL) {
+            perror("Error opening report file");
+            return 1;
+        }
+        if (pipeline_init(&pipeline, &scan_options, names, num_planets, sim_time_label, &job, outfile) != 0) {
+            return 1;
+        }
+        fprintf(outfile, "--- Events from %s to %s ---\n", start_date_input, end_date_input);
+        job.pipeline = &pipeline;
+    } else if (binary_value_size) {
+        const char *names[ELEMENTS_NUM_PLANETS];
+        for (int i = 0; i < num_planets; i++) names[i] = planets[i].name;
+        if (ephemeris_writer_open(&ephemeris, output_filename, names, num_planets, job.num_rows,
+                                  start_t, step, binary_value_size) != 0) {
+            return 1;
         }
+        job.ephemeris = &ephemeris;
+    } else {
+        outfile = cli_open_output(output_filename, "w");
+        if (outfile == NULL) {
+            perror("Error opening output file");
+            return 1;
+        }
+        fprintf(outfile, "Date");
+        for (int i = 0; i < num_planets; i++) fprintf(outfile, ",%s_x,%s_y,%s_z", planets[i].name, planets[i].name, planets[i].name);
         fprintf(outfile, "\n");
-        
-        current_t += SECONDS_IN_DAY;
+        if (csv_writer_init(&writer, outfile, 0) != 0) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            return 1;
+        }
+        job.writer = &writer;
+    }
+
+    long num_chunks = (job.num_rows + ROWS_PER_BATCH - 1) / ROWS_PER_BATCH;
+    int status = chunk_pool_run(num_chunks, num_threads, simulate_chunk, write_chunk, &job);
+    if (scan_mode) {
+        if (status == 0) status = pipeline_finish(&pipeline);
+        pipeline_free(&pipeline);
+        if (fclose(outfile) != 0 && status == 0) {
+            perror("Error writing report file");
+            status = -1;
+        }
+    } else if (binary_value_size) {
+        if (ephemeris_writer_close(&ephemeris) != 0) status = -1;
+    } else {
+        if (csv_writer_finish(&writer) != 0 && status == 0) {
+            perror("Error writing output file");
+            status = -1;
+        }
+        fclose(outfile);
     }
+    if (status != 0) fprintf(stderr, "\nError: Simulation failed.\n");
 
     // --- Cleanup ---
-    fclose(outfile);
-    curl_global_cleanup();
+    kepler_batch_free(&batch);
+    free(job.scratch);
+    fetch_cleanup();
+    if (status != 0) return 1;
+    if (scan_mode) {
+        printf("\n\nScan complete. Report '%s' has been written.\n", output_filename);
+        return 0;
+    }
     printf("\n\nSimulation complete. File '%s' has been created.\n", output_filename);
     return 0;
 }
 
 // --- Function Implementations ---
 
-static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    struct MemoryStruct *mem = (struct MemoryStruct *)userp;
-    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
-    if (ptr == NULL) return 0;
-    mem->memory = ptr;
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->memory[mem->size] = 0;
-    return realsize;
+// Propagates and formats the rows in one chunk (worker thread).
+static int simulate_chunk(long chunk, int worker, struct ChunkBuffer *out, void *userp) {
+    const struct SimJob *job = (const struct SimJob *)userp;
+    size_t plane = (size_t)ROWS_PER_BATCH * job->num_planets;
+    double *xs = job->scratch + 3 * plane * worker;
+    double *ys = xs + plane;
+    double *zs = ys + plane;
+
+    long first = chunk * ROWS_PER_BATCH;
+    int rows = (int)(job->num_rows - first < ROWS_PER_BATCH ? job->num_rows - first : ROWS_PER_BATCH);
+    if (rows <= 0) return 0;
+    int64_t first_t = job->start_t + (int64_t)first * job->step;
+    double row_days[ROWS_PER_BATCH];
+    for (int r = 0; r < rows; r++) {
+        row_days[r] = (double)(first_t + (int64_t)r * job->step) / SECONDS_IN_DAY;
+    }
+    kepler_batch_propagate(job->batch, row_days, rows, xs, ys, zs);
+
+    // Binary output and the event scan take the columns as they are.
+    if (job->ephemeris || job->pipeline) {
+        size_t n = (size_t)rows * job->num_planets;
+        char *p = chunk_buffer_reserve(out, 3 * n * sizeof(double));
+        if (p == NULL) return -1;
+        memcpy(p, xs, n * sizeof(double));
+        memcpy(p + n * sizeof(double), ys, n * sizeof(double));
+        memcpy(p + 2 * n * sizeof(double), zs, n * sizeof(double));
+        out->len = 3 * n * sizeof(double);
+        return 0;
+    }
+
+    // Labels advance incrementally from a single conversion per chunk.
+    struct TimeLabel date;
+    time_label_init(&date, first_t, job->with_time);
+    size_t row_max = sizeof(date.text) + (size_t)job->num_planets * 3 * (1 + CSV_FIXED_MAX_LEN) + 1;
+    for (int r = 0; r < rows; r++) {
+        char *p = chunk_buffer_reserve(out, row_max);
+        if (p == NULL) return -1;
+        for (const char *t = date.text; *t; t++) *p++ = *t;
+        for (int i = 0; i < job->num_planets; i++) {
+            int idx = i * rows + r;
+            *p++ = ',';
+            p = csv_put_fixed(p, xs[idx], 6);
+            *p++ = ',';
+            p = csv_put_fixed(p, ys[idx], 6);
+            *p++ = ',';
+            p = csv_put_fixed(p, zs[idx], 6);
+        }
+        *p++ = '\n';
+        out->len = (size_t)(p - out->data);
+        time_label_advance(&date, job->step);
+    }
+    return 0;
 }
 
-int fetch_orbital_elements(struct Planet *planet, const char* epoch_str, int debug_mode) {
-    CURL *curl_handle = curl_easy_init();
-    if (!curl_handle) return -1;
-
-    struct tm epoch_tm = {0};
-    sscanf(epoch_str, "%d-%d-%d", &epoch_tm.tm_year, &epoch_tm.tm_mon, &epoch_tm.tm_mday);
-    epoch_tm.tm_year -= 1900;
-    epoch_tm.tm_mon -= 1;
-    time_t epoch_t = mktime(&epoch_tm);
-    epoch_t += SECONDS_IN_DAY;
-    struct tm *next_day_tm = localtime(&epoch_t);
-    char next_day_str[11];
-    strftime(next_day_str, sizeof(next_day_str), "%Y-%m-%d", next_day_tm);
-
-    struct MemoryStruct chunk = { .memory = malloc(1), .size = 0 };
-    char url[512];
-    snprintf(url, sizeof(url),
-             "https://ssd.jpl.nasa.gov/api/horizons.api?format=text&COMMAND='%s'&OBJ_DATA='NO'&MAKE_EPHEM='YES'&EPHEM_TYPE='ELEMENTS'&CENTER='@sun'&START_TIME='%s'&STOP_TIME='%s'",
-             planet->id, epoch_str, next_day_str);
-
-    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0L);
-    curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0L);
-    curl_easy_setopt(curl_handle, CURLOPT_URL, url);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
-    
-    int success = -1;
-    if (curl_easy_perform(curl_handle) == CURLE_OK) {
-        if (debug_mode) {
-            printf("\n--- RAW API RESPONSE for %s ---\n", planet->name);
-            printf("%s\n", chunk.memory);
-            printf("-------------------------------------\n");
-        }
-
-        char* elements_start = strstr(chunk.memory, "$$SOE");
-        if (elements_start) {
-            char *ptr;
-            int parsed_count = 0;
-            double semi_major_axis_km = 0;
-
-            if ((ptr = strstr(elements_start, "EC="))) parsed_count += sscanf(ptr, "EC= %lf", &planet->eccentricity);
-            if ((ptr = strstr(elements_start, "IN="))) parsed_count += sscanf(ptr, "IN= %lf", &planet->inclination_deg);
-            if ((ptr = strstr(elements_start, "OM="))) parsed_count += sscanf(ptr, "OM= %lf", &planet->lon_asc_node_deg);
-            if ((ptr = strstr(elements_start, "W ="))) parsed_count += sscanf(ptr, "W = %lf", &planet->arg_periapsis_deg);
-            if ((ptr = strstr(elements_start, "MA="))) parsed_count += sscanf(ptr, "MA= %lf", &planet->mean_anomaly_deg);
-            if ((ptr = strstr(elements_start, "A ="))) parsed_count += sscanf(ptr, "A = %lf", &semi_major_axis_km);
-            
-            planet->semi_major_axis_au = semi_major_axis_km / AU_TO_KM;
-
-            if (parsed_count == 6) {
-                planet->epoch = mktime(&epoch_tm);
-                success = 0;
-            } else {
-                 fprintf(stderr, "  - Error: Could only parse %d of 6 orbital elements for %s.\n", parsed_count, planet->name);
-            }
-        } else {
-            fprintf(stderr, "  - Error: Could not find $$SOE marker for %s.\n", planet->name);
+// Writes a finished chunk to the output file (main thread, in date order).
+static int write_chunk(long chunk, const struct ChunkBuffer *out, void *userp) {
+    struct SimJob *job = (struct SimJob *)userp;
+    if (job->pipeline) {
+        // Run the detectors over this chunk, then drop it.
+        const double *xs = (const double *)out->data;
+        int rows = (int)(out->len / (3 * sizeof(double) * job->num_planets));
+        size_t n = (size_t)rows * job->num_planets;
+        const double *x[FRAME_STORE_MAX_BODIES], *y[FRAME_STORE_MAX_BODIES], *z[FRAME_STORE_MAX_BODIES];
+        for (int i = 0; i < job->num_planets; i++) {
+            x[i] = xs + (size_t)i * rows;
+            y[i] = x[i] + n;
+            z[i] = y[i] + n;
+        }
+        struct FrameStore store;
+        frame_store_init(&store, job->num_planets, rows, x, y, z);
+        int status = pipeline_feed(job->pipeline, &store);
+        frame_store_free(&store);
+        if (status != 0) return -1;
+    } else if (job->ephemeris) {
+        const double *xs = (const double *)out->data;
+        int rows = (int)(out->len / (3 * sizeof(double) * job->num_planets));
+        size_t n = (size_t)rows * job->num_planets;
+        if (ephemeris_writer_put(job->ephemeris, chunk * ROWS_PER_BATCH, rows, xs, xs + n, xs + 2 * n) != 0) {
+            return -1;
+        }
+    } else {
+        csv_writer_write(job->writer, out->data, out->len);
+        if (job->writer->failed) {
+            perror("Error writing output file");
+            return -1;
         }
     }
 
-    curl_easy_cleanup(curl_handle);
-    free(chunk.memory);
-    return success;
+    long first = chunk * ROWS_PER_BATCH, last = first + ROWS_PER_BATCH - 1;
+    if (last > job->num_rows - 1) last = job->num_rows - 1;
+    STATS_ADD(rows_written, last - first + 1);
+    if (last < job->num_rows - 1 && !progress_due(&job->progress)) return 0;
+    char date_str[TIMEBASE_LABEL_LEN];
+    timebase_format(job->start_t + (int64_t)last * job->step, job->with_time, date_str);
+    printf("Calculating: %s\r", date_str);
+    fflush(stdout);
+    return 0;
 }
 
-void calculate_position(struct Planet *planet, time_t current_date) {
-    if (planet->semi_major_axis_au <= 0) {
-        planet->x = planet->y = planet->z = NAN;
-        return;
+// Writes the run as Chebyshev segments (see chebyshev.h) covering start_t
+// to end_t. Each segment is fitted exactly through the propagated positions
+// at its Chebyshev nodes. Returns 0 on success.
+static int write_chebyshev(const struct KeplerBatch *batch, const char *const names[], int num_planets,
+                           int64_t start_t, int64_t end_t, int segment_days, int num_coeffs, const char *path) {
+    int64_t segment_seconds = (int64_t)segment_days * SECONDS_IN_DAY;
+    int64_t span = end_t > start_t ? end_t - start_t : 0;
+    long num_segments = span > 0 ? (long)((span + segment_seconds - 1) / segment_seconds) : 1;
+    struct ChebyshevWriter writer;
+    if (chebyshev_writer_open(&writer, path, names, num_planets, num_coeffs, CHEBYSHEV_CENTRE_SUN, num_segments,
+                              start_t, segment_seconds, start_t + span) != 0) {
+        return -1;
     }
 
-    double days_since_epoch = difftime(current_date, planet->epoch) / SECONDS_IN_DAY;
-    double mean_motion = 360.0 / (sqrt(pow(planet->semi_major_axis_au, 3)) * 365.25);
-    double mean_anomaly = fmod(planet->mean_anomaly_deg + mean_motion * days_since_epoch, 360.0);
-    double M_rad = mean_anomaly * M_PI / 180.0;
-
-    double E_rad = M_rad;
-    for (int i = 0; i < 10; i++) {
-        E_rad = E_rad - (E_rad - planet->eccentricity * sin(E_rad) - M_rad) / (1 - planet->eccentricity * cos(E_rad));
+    double nodes[CHEBYSHEV_MAX_COEFFS], days[CHEBYSHEV_MAX_COEFFS];
+    size_t plane = (size_t)num_planets * num_coeffs;
+    double *xyz = malloc(3 * plane * sizeof(double));
+    double *record = malloc(3 * plane * sizeof(double));
+    if (xyz == NULL || record == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        free(xyz);
+        free(record);
+        chebyshev_writer_close(&writer);
+        return -1;
     }
+    chebyshev_nodes(num_coeffs, nodes);
 
-    double x_orb = planet->semi_major_axis_au * (cos(E_rad) - planet->eccentricity);
-    double y_orb = planet->semi_major_axis_au * sqrt(1 - planet->eccentricity * planet->eccentricity) * sin(E_rad);
+    int status = 0;
+    for (long s = 0; s < num_segments && status == 0; s++) {
+        double segment_start = (double)start_t + (double)s * segment_seconds;
+        for (int k = 0; k < num_coeffs; k++) {
+            days[k] = (segment_start + 0.5 * (nodes[k] + 1.0) * segment_seconds) / SECONDS_IN_DAY;
+        }
+        kepler_batch_propagate(batch, days, num_coeffs, xyz, xyz + plane, xyz + 2 * plane);
+        for (int i = 0; i < num_planets; i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                chebyshev_fit_nodes(xyz + axis * plane + (size_t)i * num_coeffs, num_coeffs,
+                                    record + ((size_t)i * 3 + axis) * num_coeffs);
+            }
+        }
+        status = chebyshev_writer_put(&writer, record);
+    }
+    free(xyz);
+    free(record);
+    if (chebyshev_writer_close(&writer) != 0) status = -1;
+    return status;
+}
 
-    double w_rad = planet->arg_periapsis_deg * M_PI / 180.0;
-    double N_rad = planet->lon_asc_node_deg * M_PI / 180.0;
-    double i_rad = planet->inclination_deg * M_PI / 180.0;
+// Reads the detector settings for "-scan alignments,aspects,approaches",
+// prompting for any that were not given. Returns 0, or -1 on bad input.
+static int setup_scan(struct CliParams *params, struct PipelineOptions *options, struct AspectTable *aspects) {
+    char list[CLI_VALUE_LEN], spec[CLI_VALUE_LEN];
+    double threshold;
+    snprintf(list, sizeof(list), "%s", cli_get(params, "scan"));
+    char *save = NULL;
+    for (char *name = strtok_r(list, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save)) {
+        if (strcmp(name, "alignments") == 0) {
+            if (cli_prompt_double(params, "threshold", "Enter Alignment Threshold in Degrees (e.g., 5.0): ", &threshold) != 0 ||
+                cli_prompt_int(params, "min-planets", "Enter Minimum Planets for Alignment (e.g., 3): ", &options->min_size) != 0) {
+                return -1;
+            }
+            options->alignments = 1;
+            options->width = threshold;
+            if (options->min_size < 2) options->min_size = 2;
+        } else if (strcmp(name, "aspects") == 0) {
+            if (cli_prompt_double(params, "threshold", "Enter Aspect Threshold in Degrees (e.g., 5.0): ", &threshold) != 0 ||
+                cli_prompt_string(params, "aspects", "Enter Aspects (" ASPECT_SPEC_HELP "): ", spec, sizeof(spec)) != 0) {
+                return -1;
+            }
+            aspect_table_init(aspects);
+            if (aspect_table_parse(aspects, spec, threshold) != 0) return -1;
+            options->aspects = aspects;
+        } else if (strcmp(name, "approaches") == 0) {
+            if (cli_prompt_int(params, "count", "Enter Number of Approaches to List (e.g., 20): ", &options->approaches) != 0) {
+                return -1;
+            }
+            if (options->approaches < 1) {
+                fprintf(stderr, "Error: -count must be at least 1.\n");
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "Error: Unknown scan '%s' (expected alignments, aspects or approaches).\n", name);
+            return -1;
+        }
+    }
+    return 0;
+}
 
-    // --- Full 3D Rotation ---
-    planet->x = x_orb * (cos(w_rad) * cos(N_rad) - sin(w_rad) * sin(N_rad) * cos(i_rad)) -
-                y_orb * (sin(w_rad) * cos(N_rad) + cos(w_rad) * sin(N_rad) * cos(i_rad));
-    planet->y = x_orb * (cos(w_rad) * sin(N_rad) + sin(w_rad) * cos(N_rad) * cos(i_rad)) +
-                y_orb * (-sin(w_rad) * sin(N_rad) + cos(w_rad) * cos(N_rad) * cos(i_rad));
-    planet->z = x_orb * (sin(w_rad) * sin(i_rad)) + y_orb * (cos(w_rad) * sin(i_rad));
+// Labels a fractional row of the simulation (see pipeline_label_fn); rows
+// of a sub-daily run always carry their time.
+static void sim_time_label(double row, int with_time, char *out, void *userp) {
+    const struct SimJob *job = (const struct SimJob *)userp;
+    if (row > job->num_rows - 1) row = (double)(job->num_rows - 1);
+    if (row < 0) row = 0;
+    long base = (long)floor(row);
+    int64_t t = job->start_t + (int64_t)base * job->step + lround((row - base) * (double)job->step / 60) * 60;
+    timebase_format(t, with_time || job->with_time, out);
 }
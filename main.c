@@ -7,8 +7,45 @@
  * then iterates through that range, fetching the geocentric ecliptic longitude
  * for each major celestial body and writing the results to a CSV file.
  *
+ * Rows are one "-step" apart (default 1d; e.g. "-step 1h" or "-step 10m",
+ * see common/timebase.h), starting at the UTC start time. A request covers a
+ * whole day of rows, so hourly data costs no more requests than daily data.
+ *
+ * Requests are issued concurrently through the curl multi interface. A
+ * "-j N" command-line argument sets how many requests may be in flight at
+ * once (default 8). Results are reordered so rows are always written in
+ * date order.
+ *
+ * A "-range" argument switches to range-query mode: instead of one request
+ * per body per day, each body is fetched with a single request covering the
+ * whole span (split into chunks of "-chunk N" rows for very long spans), and
+ * every row of the returned table is written to the CSV.
+ *
+ * Responses are cached on disk (see common/cache.h); "-offline",
+ * "-no-cache", "-cache-dir DIR", "-cache-ttl SECONDS" and "-cache-clear"
+ * control the cache.
+ *
+ * Replies are parsed as they stream in (see common/horizons_parse.h), so
+ * memory use does not grow with the size of a range reply. Rows go through
+ * a buffered writer (see common/csv_writer.h) and the progress line is
+ * refreshed a few times a second.
+ *
+ * Every prompt can be answered up front with "-start YYYY-MM-DD" (or
+ * "YYYY-MM-DD HH:MM"), "-days N" and "-output FILE" (or a "-config FILE";
+ * see common/cli.h).
+ * "-output -" writes the CSV to stdout for piping.
+ *
+ * "-chebyshev FILE" also keeps the fetched vectors and fits them into a
+ * Chebyshev ephemeris (see common/chebyshev.h): "-segment-days N" segments
+ * (default 16) of "-coefficients N" per axis (default 14), least-squares
+ * fitted to the fetched positions. Positions, and so longitudes, can then be
+ * evaluated at any time of day without further requests.
+ *
+ * "-stats" prints request latency, bytes fetched, parse time and rows
+ * written at exit (see common/stats.h).
+ *
  * Compilation:
- * gcc planetary_logger.c -o planetary_logger -lcurl -ljansson -lm
+ * gcc main.c common/cli.c common/fetch.c common/cache.c common/horizons_parse.c common/csv_writer.c common/progress.c common/chebyshev.c common/timebase.c common/stats.c -Icommon -o planetary_logger -lcurl -lm
  */
 
 #define _GNU_SOURCE
@@ -16,20 +53,27 @@
 #include <stdlib.h>
 #include <string.h>
 #include <curl/curl.h>
-#include <jansson.h>
 #include <math.h>
-#include <time.h>
+#include "fetch.h"
+#include "cache.h"
+#include "horizons_parse.h"
+#include "csv_writer.h"
+#include "progress.h"
+#include "cli.h"
+#include "chebyshev.h"
+#include "timebase.h"
+#include "stats.h"
 
 // --- Constants ---
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
-
-// Struct to hold the response data from a curl request.
-struct MemoryStruct {
-    char *memory;
-    size_t size;
-};
+#define DEFAULT_MAX_IN_FLIGHT 8
+#define MAX_IN_FLIGHT_LIMIT 64
+#define DEFAULT_RANGE_CHUNK_ROWS 10000 // Keeps each range reply well under the Horizons line limit
+#define AU_TO_KM 149597870.7
+#define DEFAULT_SEGMENT_DAYS 16   // Chebyshev segment length for -chebyshev
+#define DEFAULT_COEFFICIENTS 14   // Chebyshev coefficients per axis (of at least 17 daily samples)
 
 // Struct to hold planetary data.
 struct Planet {
@@ -38,48 +82,168 @@ struct Planet {
     double longitude;
 };
 
-// Callback function for libcurl
-static size_t WriteMemoryCallback(void *contents, size_t size, size_t nmemb, void *userp) {
-    size_t realsize = size * nmemb;
-    struct MemoryStruct *mem = (struct MemoryStruct *)userp;
-    char *ptr = realloc(mem->memory, mem->size + realsize + 1);
-    if (ptr == NULL) return 0;
-    mem->memory = ptr;
-    memcpy(&(mem->memory[mem->size]), contents, realsize);
-    mem->size += realsize;
-    mem->memory[mem->size] = 0;
-    return realsize;
+// Struct to hold the results table rows are assembled in before writing.
+struct LogTable {
+    double *longitudes;   // [row * num_planets + planet]
+    int *parsed;          // 1 where longitudes holds a fetched value
+    int *pending;         // Requests still outstanding per row
+    double *vectors;      // [(row * num_planets + planet) * 3] in AU, for -chebyshev (else NULL)
+    int num_planets;
+};
+
+// Struct to hold one in-flight request: which rows and body it is for,
+// together with the curl handle and the streaming parser its reply feeds.
+struct FetchSlot {
+    CURL *handle;
+    struct HorizonsParser parser;
+    struct FetchStream stream;
+    struct LogTable *table;
+    char url[512];
+    int first_row;
+    int count;
+    int planet;
+    int rows;             // Rows stored so far for this request
+    int busy;
+};
+
+static struct StatsEntry rows_written = STATS_ENTRY("output.rows", STATS_COUNTER, "rows");
+
+// Record callback for the streaming parser: each vector row (values are
+// X, Y, Z in km) becomes the longitude of the slot's next row.
+static void store_planet_row(const double *values, void *userp) {
+    struct FetchSlot *slot = (struct FetchSlot *)userp;
+    if (slot->rows >= slot->count) return;
+
+    struct LogTable *table = slot->table;
+    int idx = (slot->first_row + slot->rows) * table->num_planets + slot->planet;
+    double longitude_rad = atan2(values[1], values[0]);
+    double longitude = longitude_rad * (180.0 / M_PI);
+    if (longitude < 0) longitude += 360;
+    table->longitudes[idx] = longitude;
+    table->parsed[idx] = 1;
+    if (table->vectors) {
+        for (int axis = 0; axis < 3; axis++) table->vectors[(size_t)idx * 3 + axis] = values[axis] / AU_TO_KM;
+    }
+    slot->rows++;
+}
+
+// Copies a row label into a URL, escaping the space before the time of day.
+static void url_time(const char *label, char *out, size_t len) {
+    size_t n = 0;
+    for (const char *c = label; *c && n + 4 <= len; c++) {
+        if (*c == ' ') {
+            memcpy(out + n, "%20", 3);
+            n += 3;
+        } else {
+            out[n++] = *c;
+        }
+    }
+    out[n] = '\0';
 }
 
-// Parses planetary data from NASA API response
-int parse_planet_data(const char *json_text, double *longitude) {
-    json_error_t error;
-    json_t *root = json_loads(json_text, 0, &error);
-    if (!root) {
-        fprintf(stderr, "JSON parse error: %s\n", error.text);
+// Prepares the request covering `count` rows from `first_row` for one
+// planet. A cached reply is parsed immediately (returns 1); otherwise the
+// slot's handle is added to the multi stack (returns 0). Returns -1 if the
+// request cannot be made.
+static int start_fetch(CURLM *multi, struct FetchSlot *slot, struct Planet *planets,
+                       char (*dates)[TIMEBASE_LABEL_LEN], const char *step_size,
+                       int first_row, int count, int planet) {
+    char start[2 * TIMEBASE_LABEL_LEN], stop[2 * TIMEBASE_LABEL_LEN];
+    url_time(dates[first_row], start, sizeof(start));
+    url_time(dates[first_row + count], stop, sizeof(stop));
+    snprintf(slot->url, sizeof(slot->url),
+             "https://ssd.jpl.nasa.gov/api/horizons.api?format=json&COMMAND='%s'&OBJ_DATA='NO'&MAKE_EPHEM='YES'&EPHEM_TYPE='VECTORS'&CENTER='@399'&START_TIME='%s'&STOP_TIME='%s'&STEP_SIZE='%s'&VEC_TABLE='1'",
+             planets[planet].id, start, stop, step_size);
+
+    slot->first_row = first_row;
+    slot->count = count;
+    slot->planet = planet;
+    slot->rows = 0;
+    horizons_parser_init(&slot->parser, HORIZONS_FORMAT_JSON, HORIZONS_VECTOR_TAGS, 3,
+                         store_planet_row, slot);
+
+    int started = fetch_stream_begin(&slot->stream, slot->url, &slot->parser);
+    if (started != 0) return started;
+
+    curl_easy_setopt(slot->handle, CURLOPT_URL, slot->url);
+    if (curl_multi_add_handle(multi, slot->handle) != CURLM_OK) {
+        fetch_stream_end(&slot->stream, 0);
         return -1;
     }
-    json_t *result = json_object_get(root, "result");
-    if (!json_is_string(result)) { json_decref(root); return -1; }
-    const char *result_text = json_string_value(result);
-    const char *data_start = strstr(result_text, "$$SOE");
-    if (!data_start) { json_decref(root); return -1; }
-    const char *x_ptr = strstr(data_start, "X =");
-    const char *y_ptr = strstr(data_start, "Y =");
-    if (!(x_ptr && y_ptr)) { json_decref(root); return -1; }
-    double x_km, y_km;
-    sscanf(x_ptr, "X =%lf", &x_km);
-    sscanf(y_ptr, "Y =%lf", &y_km);
-    
-    double longitude_rad = atan2(y_km, x_km);
-    *longitude = longitude_rad * (180.0 / M_PI);
-    if (*longitude < 0) *longitude += 360;
-
-    json_decref(root);
+    slot->busy = 1;
     return 0;
 }
 
-int main(void) {
+// Reports a short reply and marks the slot's rows as no longer pending.
+static void finish_fetch(struct FetchSlot *slot, struct Planet *planets, char (*dates)[TIMEBASE_LABEL_LEN]) {
+    if (slot->rows < slot->count) {
+        fprintf(stderr, "  - Error: Request for %s from %s returned %d of %d rows.\n",
+                planets[slot->planet].name, dates[slot->first_row], slot->rows, slot->count);
+    }
+    for (int r = slot->first_row; r < slot->first_row + slot->count; r++) slot->table->pending[r]--;
+}
+
+// Fits the fetched vectors with Chebyshev series (see common/chebyshev.h)
+// and writes them to `path`. Segment s spans [s, s + 1] * segment_days from
+// the start; rows on both ends are fitted, so neighbouring segments meet.
+// Rows whose request failed are left out of the fit. Returns 0 on success.
+static int write_chebyshev(const struct LogTable *table, const struct Planet *planets, int num_rows,
+                           int64_t start_t, int64_t step, int segment_days, int num_coeffs, const char *path) {
+    int num_planets = table->num_planets;
+    int64_t segment_seconds = (int64_t)segment_days * TIMEBASE_SECONDS_PER_DAY;
+    int64_t span = num_rows > 1 ? (int64_t)(num_rows - 1) * step : 0;
+    long num_segments = span > 0 ? (long)((span + segment_seconds - 1) / segment_seconds) : 1;
+    const char *names[CHEBYSHEV_MAX_BODIES];
+    for (int i = 0; i < num_planets; i++) names[i] = planets[i].name;
+
+    struct ChebyshevWriter writer;
+    if (chebyshev_writer_open(&writer, path, names, num_planets, num_coeffs, CHEBYSHEV_CENTRE_EARTH, num_segments,
+                              start_t, segment_seconds, start_t + span) != 0) {
+        return -1;
+    }
+    size_t record_len = (size_t)num_planets * 3 * num_coeffs;
+    size_t max_points = (size_t)(segment_seconds / step) + 2;
+    double *record = malloc(record_len * sizeof(double));
+    double *tau = malloc(max_points * sizeof(double));
+    double *values = malloc(max_points * sizeof(double));
+    int status = (record && tau && values) ? 0 : -1;
+    if (status != 0) fprintf(stderr, "Error: Out of memory.\n");
+
+    for (long s = 0; s < num_segments && status == 0; s++) {
+        int64_t segment_start = (int64_t)s * segment_seconds;
+        long first = (long)((segment_start + step - 1) / step);
+        long last = (long)((segment_start + segment_seconds) / step);
+        if (last > num_rows - 1) last = num_rows - 1;
+        memset(record, 0, record_len * sizeof(double));
+        for (int i = 0; i < num_planets && status == 0; i++) {
+            for (int axis = 0; axis < 3; axis++) {
+                int count = 0;
+                for (long row = first; row <= last; row++) {
+                    size_t idx = (size_t)row * num_planets + i;
+                    if (!table->parsed[idx]) continue;
+                    tau[count] = 2.0 * (double)(row * step - segment_start) / (double)segment_seconds - 1.0;
+                    values[count++] = table->vectors[idx * 3 + axis];
+                }
+                // Short final segments get a lower-degree fit.
+                int n = count < num_coeffs ? count : num_coeffs;
+                double *coeffs = record + ((size_t)i * 3 + axis) * num_coeffs;
+                if (n == 0 || chebyshev_fit_points(tau, values, count, n, coeffs) != 0) {
+                    fprintf(stderr, "Error: Not enough vectors to fit %s in segment %ld.\n", planets[i].name, s);
+                    status = -1;
+                    break;
+                }
+            }
+        }
+        if (status == 0) status = chebyshev_writer_put(&writer, record);
+    }
+    free(record);
+    free(tau);
+    free(values);
+    if (chebyshev_writer_close(&writer) != 0) status = -1;
+    return status;
+}
+
+int main(int argc, char *argv[]) {
     struct Planet planets[] = {
         {"Sun", "10"}, {"Moon", "301"}, {"Mercury", "199"}, {"Venus", "299"},
         {"Mars", "499"}, {"Jupiter", "599"}, {"Saturn", "699"}, {"Uranus", "799"},
@@ -87,22 +251,71 @@ int main(void) {
     };
     int num_planets = sizeof(planets) / sizeof(planets[0]);
 
+    // Check for concurrency flag
+    int max_in_flight = DEFAULT_MAX_IN_FLIGHT;
+    int range_mode = 0;
+    int range_chunk_rows = DEFAULT_RANGE_CHUNK_ROWS;
+    const char *chebyshev_path = NULL;
+    int segment_days = DEFAULT_SEGMENT_DAYS, num_coeffs = DEFAULT_COEFFICIENTS;
+    static const char *const param_names[] = {"start", "days", "output", "step", NULL};
+    struct CliParams params;
+    cli_init(&params, param_names);
+    for (int a = 1; a < argc; a++) {
+        int used = cli_parse_option(argc, argv, &a, &params);
+        if (used < 0) return 1;
+        if (used || cache_parse_option(argc, argv, &a) || stats_parse_option(argc, argv, &a)) {
+            continue;
+        } else if (strcmp(argv[a], "-j") == 0 && a + 1 < argc) {
+            max_in_flight = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-range") == 0) {
+            range_mode = 1;
+        } else if (strcmp(argv[a], "-chunk") == 0 && a + 1 < argc) {
+            range_chunk_rows = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-chebyshev") == 0 && a + 1 < argc) {
+            chebyshev_path = argv[++a];
+        } else if (strcmp(argv[a], "-segment-days") == 0 && a + 1 < argc) {
+            segment_days = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-coefficients") == 0 && a + 1 < argc) {
+            num_coeffs = atoi(argv[++a]);
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'.\n", argv[a]);
+            return 1;
+        }
+    }
+    if (chebyshev_path && (segment_days < 1 || num_coeffs < 1 || num_coeffs > CHEBYSHEV_MAX_COEFFS)) {
+        fprintf(stderr, "Error: -segment-days must be at least 1 and -coefficients between 1 and %d.\n",
+                CHEBYSHEV_MAX_COEFFS);
+        return 1;
+    }
+    if (range_chunk_rows < 1) range_chunk_rows = 1;
+    if (max_in_flight < 1) max_in_flight = 1;
+    if (max_in_flight > MAX_IN_FLIGHT_LIMIT) max_in_flight = MAX_IN_FLIGHT_LIMIT;
+    cli_begin(&params);
+
     // --- Get User Input ---
-    char start_date_input[11];
+    char start_date_input[TIMEBASE_LABEL_LEN];
     int num_days_to_log;
     char output_filename[100];
 
     printf("--- NASA Planetary Data Logger ---\n");
     printf("This tool will generate a CSV file with daily planetary longitudes.\n");
-    printf("Enter Start Date (YYYY-MM-DD): ");
-    scanf("%10s", start_date_input);
-    printf("Enter Number of Days to Log: ");
-    scanf("%d", &num_days_to_log);
-    printf("Enter Output Filename (e.g., data.csv): ");
-    scanf("%99s", output_filename);
+    if (cli_prompt_string(&params, "start", "Enter Start Date (YYYY-MM-DD): ", start_date_input, sizeof(start_date_input)) != 0 ||
+        cli_prompt_int(&params, "days", "Enter Number of Days to Log: ", &num_days_to_log) != 0 ||
+        cli_prompt_string(&params, "output", "Enter Output Filename (e.g., data.csv): ", output_filename, sizeof(output_filename)) != 0) {
+        return 1;
+    }
+    int64_t start_t, step = TIMEBASE_DEFAULT_STEP;
+    if (timebase_parse(start_date_input, &start_t) != 0) {
+        fprintf(stderr, "Error: The start date must be YYYY-MM-DD or YYYY-MM-DD HH:MM.\n");
+        return 1;
+    }
+    if (cli_get(&params, "step") && timebase_parse_step(cli_get(&params, "step"), &step) != 0) {
+        fprintf(stderr, "Error: -step must be %s.\n", TIMEBASE_STEP_HELP);
+        return 1;
+    }
 
     // --- Open File for Writing ---
-    FILE *outfile = fopen(output_filename, "w");
+    FILE *outfile = cli_open_output(output_filename, "w");
     if (outfile == NULL) {
         perror("Error opening output file");
         return 1;
@@ -116,59 +329,154 @@ int main(void) {
     fprintf(outfile, "\n");
 
     // --- Main Data Fetching Loop ---
-    curl_global_init(CURL_GLOBAL_ALL);
-
-    // Convert start date string to a time_t object
-    struct tm start_tm = {0};
-    sscanf(start_date_input, "%d-%d-%d", &start_tm.tm_year, &start_tm.tm_mon, &start_tm.tm_mday);
-    start_tm.tm_year -= 1900;
-    start_tm.tm_mon -= 1;
-    time_t current_t = mktime(&start_tm);
-
-    for (int day = 0; day < num_days_to_log; day++) {
-        struct tm *current_tm = localtime(&current_t);
-        char date_str[11], next_date_str[11];
-        strftime(date_str, sizeof(date_str), "%Y-%m-%d", current_tm);
-        
-        time_t next_t = current_t + (24 * 60 * 60);
-        struct tm *next_tm = localtime(&next_t);
-        strftime(next_date_str, sizeof(next_date_str), "%Y-%m-%d", next_tm);
-
-        printf("Processing: %s\n", date_str);
-        fprintf(outfile, "%s", date_str);
-
-        for (int i = 0; i < num_planets; i++) {
-            CURL *curl_handle = curl_easy_init();
-            if (curl_handle) {
-                struct MemoryStruct chunk = { .memory = malloc(1), .size = 0 };
-                char url[512];
-                snprintf(url, sizeof(url),
-                         "https://ssd.jpl.nasa.gov/api/horizons.api?format=json&COMMAND='%s'&OBJ_DATA='NO'&MAKE_EPHEM='YES'&EPHEM_TYPE='VECTORS'&CENTER='@399'&START_TIME='%s'&STOP_TIME='%s'&STEP_SIZE='1d'&VEC_TABLE='1'",
-                         planets[i].id, date_str, next_date_str);
-
-                curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYPEER, 0L);
-                curl_easy_setopt(curl_handle, CURLOPT_SSL_VERIFYHOST, 0L);
-                curl_easy_setopt(curl_handle, CURLOPT_URL, url);
-                curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
-                curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, (void *)&chunk);
-                if (curl_easy_perform(curl_handle) == CURLE_OK) {
-                    parse_planet_data(chunk.memory, &planets[i].longitude);
-                }
-                curl_easy_cleanup(curl_handle);
-                free(chunk.memory);
+    if (fetch_init() != 0) {
+        fprintf(stderr, "Error: Could not initialise libcurl.\n");
+        return 1;
+    }
+
+    // Rows cover the requested days one step apart.
+    if (num_days_to_log < 0) num_days_to_log = 0;
+    int64_t span = (int64_t)num_days_to_log * TIMEBASE_SECONDS_PER_DAY;
+    if ((span + step - 1) / step > INT32_MAX / num_planets / 3) {
+        fprintf(stderr, "Error: Too many rows; use a longer -step or fewer days.\n");
+        return 1;
+    }
+    int num_rows = (int)((span + step - 1) / step);
+    char step_size[32];
+    timebase_horizons_step(step, step_size, sizeof(step_size));
+
+    // Precompute every row label up front; a request for rows
+    // [first, first + count) asks for the range dates[first]..dates[first + count].
+    char (*dates)[TIMEBASE_LABEL_LEN] = malloc((size_t)(num_rows + 1) * sizeof(*dates));
+    double *longitudes = malloc((size_t)num_rows * num_planets * sizeof(double));
+    int *parsed = calloc((size_t)num_rows * num_planets, sizeof(int));
+    int *pending = malloc((size_t)num_rows * sizeof(int));
+    double *vectors = NULL;
+    if (chebyshev_path) vectors = malloc((size_t)num_rows * num_planets * 3 * sizeof(double) + 1);
+    if (!dates || !longitudes || !parsed || !pending || (chebyshev_path && !vectors)) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return 1;
+    }
+    struct LogTable table = { longitudes, parsed, pending, vectors, num_planets };
+    struct TimeLabel date;
+    time_label_init(&date, start_t, timebase_has_time(start_t, step));
+    for (int row = 0; row <= num_rows; row++) {
+        memcpy(dates[row], date.text, sizeof(dates[row]));
+        time_label_advance(&date, step);
+        if (row < num_rows) pending[row] = num_planets;
+    }
+
+    struct CsvWriter writer;
+    struct Progress progress;
+    if (csv_writer_init(&writer, outfile, 0) != 0) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return 1;
+    }
+    progress_init(&progress, 0);
+
+    CURLM *multi = curl_multi_init();
+    struct FetchSlot slots[MAX_IN_FLIGHT_LIMIT];
+    for (int s = 0; s < max_in_flight; s++) {
+        slots[s].handle = fetch_handle_acquire();
+        slots[s].table = &table;
+        slots[s].busy = 0;
+        if (!slots[s].handle) {
+            fprintf(stderr, "Error: Could not initialise curl handles.\n");
+            return 1;
+        }
+        curl_easy_setopt(slots[s].handle, CURLOPT_WRITEFUNCTION, fetch_stream_callback);
+        curl_easy_setopt(slots[s].handle, CURLOPT_WRITEDATA, (void *)&slots[s].stream);
+        curl_easy_setopt(slots[s].handle, CURLOPT_PRIVATE, (void *)&slots[s]);
+    }
+
+    // Daily mode is simply range mode with one-day chunks.
+    int rows_per_day = step < TIMEBASE_SECONDS_PER_DAY ? (int)(TIMEBASE_SECONDS_PER_DAY / step) : 1;
+    int chunk_rows = range_mode ? range_chunk_rows : rows_per_day;
+    int num_chunks = (num_rows + chunk_rows - 1) / chunk_rows;
+    int total_jobs = num_chunks * num_planets;
+    int next_job = 0;       // Next (chunk, planet) request to issue, in date order
+    int next_row = 0;       // Next row to write to the CSV
+    int in_flight = 0;
+
+    while (next_row < num_rows) {
+        // Keep the pipeline full
+        for (int s = 0; s < max_in_flight && next_job < total_jobs; s++) {
+            if (slots[s].busy) continue;
+            int first_row = (next_job / num_planets) * chunk_rows;
+            int planet = next_job % num_planets;
+            int count = num_rows - first_row;
+            if (count > chunk_rows) count = chunk_rows;
+            next_job++;
+            if (start_fetch(multi, &slots[s], planets, dates, step_size, first_row, count, planet) == 0) {
+                in_flight++;
+            } else {
+                // Cache hits complete immediately; failures leave the rows unfetched
+                finish_fetch(&slots[s], planets, dates);
             }
-            fprintf(outfile, ",%.4f", planets[i].longitude);
         }
-        fprintf(outfile, "\n");
-        
-        // Move to the next day
-        current_t = next_t;
+
+        int still_running = 0;
+        curl_multi_perform(multi, &still_running);
+
+        // Collect finished transfers
+        CURLMsg *msg;
+        int msgs_left;
+        while ((msg = curl_multi_info_read(multi, &msgs_left)) != NULL) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            struct FetchSlot *slot;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&slot);
+            fetch_stream_end(&slot->stream, msg->data.result == CURLE_OK);
+            finish_fetch(slot, planets, dates);
+            curl_multi_remove_handle(multi, slot->handle);
+            slot->busy = 0;
+            in_flight--;
+        }
+
+        // Write out every leading row that is now complete
+        while (next_row < num_rows && pending[next_row] == 0) {
+            if (progress_due(&progress) || next_row == num_rows - 1) {
+                printf("Processing: %s\r", dates[next_row]);
+                fflush(stdout);
+            }
+            csv_writer_puts(&writer, dates[next_row]);
+            for (int i = 0; i < num_planets; i++) {
+                int idx = next_row * num_planets + i;
+                // A failed request repeats the body's previous value
+                if (parsed[idx]) planets[i].longitude = longitudes[idx];
+                csv_writer_field_fixed(&writer, planets[i].longitude, 4);
+            }
+            csv_writer_write(&writer, "\n", 1);
+            STATS_ADD(rows_written, 1);
+            next_row++;
+        }
+
+        if (in_flight > 0) {
+            curl_multi_poll(multi, NULL, 0, 1000, NULL);
+        }
     }
 
     // --- Cleanup ---
+    for (int s = 0; s < max_in_flight; s++) {
+        fetch_handle_release(slots[s].handle);
+    }
+    curl_multi_cleanup(multi);
+    int chebyshev_failed = chebyshev_path &&
+        write_chebyshev(&table, planets, num_rows, start_t, step, segment_days, num_coeffs, chebyshev_path) != 0;
+    free(dates);
+    free(longitudes);
+    free(parsed);
+    free(pending);
+    free(vectors);
+    int write_failed = csv_writer_finish(&writer) != 0;
     fclose(outfile);
-    curl_global_cleanup();
-    printf("\nData logging complete. File '%s' has been created.\n", output_filename);
+    fetch_cleanup();
+    if (write_failed) {
+        perror("Error writing output file");
+        return 1;
+    }
+    if (chebyshev_failed) return 1;
+    printf("\n\nData logging complete. File '%s' has been created.\n", output_filename);
+    if (chebyshev_path) printf("Chebyshev segments written to '%s'.\n", chebyshev_path);
 
     return 0;
 }
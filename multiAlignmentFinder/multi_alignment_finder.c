@@ -6,8 +6,47 @@
  * allows the user to run different types of analysis, such as finding
  * conjunctions, oppositions, squares, or the closest approach between two planets.
  *
+ * The input may also be a binary ephemeris written with "kepler_sim_3d
+ * -binary" (see common/ephemeris.h); the format is detected automatically.
+ * Either way the file is memory-mapped and analysed through per-body column
+ * views (see common/dataset.h), so loading does not copy frame by frame.
+ * Longitudes are computed once per planet, on first use, and cached for the
+ * rest of the session (see common/frame_store.h).
+ *
+ * Aspects are found as events (see common/events.h): each aspect in a
+ * user-chosen table (see common/aspects.h) is reported once, at the time it
+ * is exact, with every aspect classified in the same pass over the data. Groups are the maximal
+ * clusters found by a sorted circular sweep of each day's longitudes (see
+ * common/clusters.h), each reported once per run of days it stays together,
+ * at its tightest moment (see common/groups.h). Closest approaches are
+ * refined between samples and can be ranked across every pair at once (see
+ * common/approaches.h).
+ *
+ * Every prompt can be answered from the command line instead (see
+ * common/cli.h): "-input FILE -analysis aspects -threshold 2 -aspects major"
+ * runs without the menu, and "-input -" reads the data from stdin, e.g.
+ * piped straight from "kepler_sim_3d -output -". "-from" and "-to"
+ * (YYYY-MM-DD or "YYYY-MM-DD HH:MM") analyse just that slice of the file,
+ * and only that slice is read: "-from 2032-01-01 -to 2032-12-31" finds
+ * the alignments of 2032 without parsing the rest (see dataset_open_range
+ * in common/dataset.h).
+ *
+ * Each analysis runs over chunks of rows on "-threads N" worker threads
+ * (default: one per CPU, 0 also means that; see common/chunk_scan.h). A
+ * window that spans a chunk boundary is found whole by one of the two
+ * chunks, so the report is the same for any number of threads.
+ *
+ * All the analyses of a run share that single pass over the data, each one
+ * working through the same block of rows while it is in cache. Besides the
+ * "-analysis" list, "-queries FILE" adds one or more analyses per line of
+ * FILE, written as options: a whole report of queries at different
+ * thresholds, aspect tables and pairs costs about one scan, not one each.
+ *
+ * "-stats" prints load and parse times and the time spent in each kind of
+ * detector at exit (see common/stats.h).
+ *
  * Compilation:
- * gcc multi_alignment_finder.c -o multi_alignment_finder -lm
+ * gcc multi_alignment_finder.c ../common/chunk_scan.c ../common/chunk_pool.c ../common/cli.c ../common/approaches.c ../common/groups.c ../common/clusters.c ../common/events.c ../common/aspects.c ../common/frame_store.c ../common/dataset.c ../common/ephemeris.c ../common/timebase.c ../common/stats.c -I../common -o multi_alignment_finder -lm -pthread
  */
 
 #define _GNU_SOURCE
@@ -15,106 +54,110 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-
-#define MAX_PLANETS 10
-#define MAX_LINE_LEN 1024
-
-// Struct to hold a single planet's 3D coordinates
-struct PlanetPosition {
-    double x, y, z;
-};
-
-// Struct to hold a full frame of data for all planets on a single day
-struct Frame {
-    char date[11];
-    struct PlanetPosition positions[MAX_PLANETS];
-};
-
-// Struct to hold a planet's name and longitude for analysis
-struct PlanetData {
-    char *name;
-    double longitude;
-};
-
+#include "dataset.h"
+#include "frame_store.h"
+#include "events.h"
+#include "groups.h"
+#include "approaches.h"
+#include "chunk_scan.h"
+#include "cli.h"
+#include "stats.h"
+
+#define MAX_PLANETS DATASET_MAX_BODIES
+#define MAX_QUERY_WORDS 64   // Options and values on one line of a -queries file
+
+// Time spent in each kind of detector, summed over queries and chunks.
+static struct StatsEntry alignments_time = STATS_ENTRY("detect.alignments", STATS_TIMER, "ns");
+static struct StatsEntry aspects_time = STATS_ENTRY("detect.aspects", STATS_TIMER, "ns");
+static struct StatsEntry approaches_time = STATS_ENTRY("detect.approaches", STATS_TIMER, "ns");
 
 // --- Function Prototypes ---
 double angle_diff(double l1, double l2);
-double distance_3d(struct PlanetPosition p1, struct PlanetPosition p2);
-void find_multi_alignments(struct Frame *frames, int frame_count, char *planet_names[], int num_planets);
-void find_oppositions_and_squares(struct Frame *frames, int frame_count, char *planet_names[], int num_planets);
-void find_closest_approach(struct Frame *frames, int frame_count, char *planet_names[], int num_planets);
+int find_multi_alignments(struct FrameStore *store, const struct Dataset *data, char *planet_names[], int num_planets, struct CliParams *params, int num_threads);
+int find_aspects(struct FrameStore *store, const struct Dataset *data, char *planet_names[], int num_planets, struct CliParams *params, int num_threads);
+int find_closest_approach(struct FrameStore *store, const struct Dataset *data, char *planet_names[], int num_planets, struct CliParams *params, int num_threads);
+static int load_longitudes(struct FrameStore *store, const double *longitudes[], int num_planets);
+static int run_analyses(struct FrameStore *store, const struct Dataset *data, char *planet_names[], int num_planets,
+                        struct CliParams *params, int num_threads);
 
 
-int main(void) {
+int main(int argc, char *argv[]) {
     char input_filename[100];
-    struct Frame *frames = NULL;
-    int frame_count = 0;
+    struct Dataset data;
+    struct FrameStore store;
     char *planet_names[MAX_PLANETS];
     int num_planets = 0;
 
-    printf("--- Planetary Data Analysis Tool ---\n");
-    printf("Enter Input CSV Filename (e.g., data_3d.csv): ");
-    if (scanf("%99s", input_filename) != 1) { fprintf(stderr, "Invalid input.\n"); return 1; }
+    static const char *const param_names[] = {"input", "analysis", "threshold", "min-planets", "aspects",
+                                              "first", "second", "count", "from", "to", "queries", NULL};
+    int num_threads = chunk_pool_default_threads();
+    struct CliParams params;
+    cli_init(&params, param_names);
+    for (int a = 1; a < argc; a++) {
+        int used = cli_parse_option(argc, argv, &a, &params);
+        if (used < 0) return 1;
+        if (!used && !stats_parse_option(argc, argv, &a) && !chunk_pool_parse_option(argc, argv, &a, &num_threads)) {
+            fprintf(stderr, "Error: Unknown option '%s'.\n", argv[a]);
+            return 1;
+        }
+    }
+    cli_begin(&params);
 
-    // --- Load Data File into Memory ---
-    FILE *infile = fopen(input_filename, "r");
-    if (infile == NULL) {
-        perror("Error opening input file");
+    printf("--- Planetary Data Analysis Tool ---\n");
+    if (cli_prompt_string(&params, "input", "Enter Input CSV Filename (e.g., data_3d.csv): ",
+                          input_filename, sizeof(input_filename)) != 0) {
         return 1;
     }
 
-    char line[MAX_LINE_LEN];
-    // Read header
-    if (fgets(line, sizeof(line), infile)) {
-        line[strcspn(line, "\n")] = 0;
-        char *token = strtok(line, ","); // Skip "Date"
-        while ((token = strtok(NULL, ",")) != NULL && num_planets < MAX_PLANETS) {
-            char *p_name = strdup(token);
-            *strchr(p_name, '_') = '\0';
-            planet_names[num_planets++] = p_name;
-            strtok(NULL, ","); strtok(NULL, ","); // Skip _y and _z
-        }
+    // --- Map Data File ---
+    int64_t from_t, to_t;
+    if (dataset_parse_range(cli_get(&params, "from"), cli_get(&params, "to"), &from_t, &to_t) != 0 ||
+        dataset_open_range(&data, input_filename, from_t, to_t) != 0) {
+        return 1;
     }
-
-    // Read data frames
-    while (fgets(line, sizeof(line), infile)) {
-        frames = realloc(frames, (frame_count + 1) * sizeof(struct Frame));
-        char *line_ptr = line;
-        
-        char *token = strsep(&line_ptr, ",");
-        strncpy(frames[frame_count].date, token, 10);
-        frames[frame_count].date[10] = '\0';
-
-        for (int i = 0; i < num_planets; i++) {
-            frames[frame_count].positions[i].x = atof(strsep(&line_ptr, ","));
-            frames[frame_count].positions[i].y = atof(strsep(&line_ptr, ","));
-            frames[frame_count].positions[i].z = atof(strsep(&line_ptr, ","));
-        }
-        frame_count++;
+    if (data.values_per_body != 3) {
+        fprintf(stderr, "Error: %s holds longitudes only; this tool needs x/y/z positions.\n", input_filename);
+        dataset_close(&data);
+        return 1;
+    }
+    num_planets = data.num_bodies < MAX_PLANETS ? data.num_bodies : MAX_PLANETS;
+    for (int i = 0; i < num_planets; i++) {
+        planet_names[i] = data.names[i];
+    }
+    frame_store_from_dataset(&store, &data);
+    printf("Loaded %ld rows of data.\n", data.num_rows);
+
+    // "-analysis" and "-queries" run the listed analyses instead of the menu.
+    if (cli_get(&params, "analysis") != NULL || cli_get(&params, "queries") != NULL || params.batch) {
+        int status = run_analyses(&store, &data, planet_names, num_planets, &params, num_threads);
+        frame_store_free(&store);
+        dataset_close(&data);
+        return status == 0 ? 0 : 1;
     }
-    fclose(infile);
-    printf("Loaded %d days of data.\n", frame_count);
 
     // --- Main Menu ---
     int choice = 0;
     while (choice != 4) {
         printf("\nPlease select an analysis function:\n");
         printf("  1. Find Multiple Alignments (Conjunctions)\n");
-        printf("  2. Find Oppositions and Squares\n");
-        printf("  3. Find Closest Approach Between Two Planets\n");
+        printf("  2. Find Aspects (Oppositions, Squares, Trines, ...)\n");
+        printf("  3. Find Closest Approaches (One Pair or All Pairs)\n");
         printf("  4. Exit\n");
         printf("Enter your choice: ");
-        if (scanf("%d", &choice) != 1) { choice = 0; } // Clear invalid input
+        if (scanf("%d", &choice) != 1) {
+            if (feof(stdin)) break;
+            choice = 0; // Clear invalid input
+        }
 
         switch (choice) {
             case 1:
-                find_multi_alignments(frames, frame_count, planet_names, num_planets);
+                find_multi_alignments(&store, &data, planet_names, num_planets, &params, num_threads);
                 break;
             case 2:
-                find_oppositions_and_squares(frames, frame_count, planet_names, num_planets);
+                find_aspects(&store, &data, planet_names, num_planets, &params, num_threads);
                 break;
             case 3:
-                find_closest_approach(frames, frame_count, planet_names, num_planets);
+                find_closest_approach(&store, &data, planet_names, num_planets, &params, num_threads);
                 break;
             case 4:
                 printf("Exiting.\n");
@@ -122,23 +165,29 @@ int main(void) {
             default:
                 printf("Invalid choice. Please try again.\n");
                 // Clear stdin buffer
-                while(getchar() != '\n');
+                for (int c = getchar(); c != '\n' && c != EOF; c = getchar());
                 break;
         }
     }
 
     // --- Cleanup ---
-    for (int i = 0; i < num_planets; i++) {
-        free(planet_names[i]);
-    }
-    free(frames);
+    frame_store_free(&store);
+    dataset_close(&data);
 
     return 0;
 }
 
-
 // --- Analysis Functions ---
 
+// Fetches every planet's cached longitude column. Returns 0 on success.
+static int load_longitudes(struct FrameStore *store, const double *longitudes[], int num_planets) {
+    for (int i = 0; i < num_planets; i++) {
+        longitudes[i] = frame_store_longitudes(store, i);
+        if (longitudes[i] == NULL) return -1;
+    }
+    return 0;
+}
+
 double angle_diff(double l1, double l2) {
     double diff = fabs(l1 - l2);
     if (diff > 180) {
@@ -147,119 +196,747 @@ double angle_diff(double l1, double l2) {
     return diff;
 }
 
-double distance_3d(struct PlanetPosition p1, struct PlanetPosition p2) {
-    double dx = p1.x - p2.x;
-    double dy = p1.y - p2.y;
-    double dz = p1.z - p2.z;
-    return sqrt(dx*dx + dy*dy + dz*dz);
+// Appends every record of a chunk's output (see chunk_scan.h) to a growing
+// array of `size`-byte items. Returns 0, or -1 if out of memory.
+static int append_records(void **items, size_t *count, size_t *cap, size_t size, const struct ChunkBuffer *out) {
+    size_t num = out->len / size;
+    if (*count + num > *cap) {
+        size_t new_cap = *cap ? *cap : 64;
+        while (new_cap < *count + num) new_cap *= 2;
+        void *grown = realloc(*items, new_cap * size);
+        if (grown == NULL) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            return -1;
+        }
+        *items = grown;
+        *cap = new_cap;
+    }
+    if (num > 0) memcpy((char *)*items + *count * size, out->data, num * size);
+    *count += num;
+    return 0;
+}
+
+// --- Multi-Body Windows ---
+
+// A closed alignment window, kept until every window has been found.
+struct FoundGroup {
+    double row;
+    double spread;
+    int members[GROUP_MAX_BODIES];   // Body indices, ascending
+    int count;
+    long start, last;
+    uint64_t key;
+};
+
+struct FoundGroups {
+    struct FoundGroup *items;
+    size_t count, cap;
+};
+
+static int compare_found_groups(const void *pa, const void *pb) {
+    const struct FoundGroup *a = pa, *b = pb;
+    if (a->row != b->row) return a->row < b->row ? -1 : 1;
+    return (a->key > b->key) - (a->key < b->key);
 }
 
-void find_multi_alignments(struct Frame *frames, int frame_count, char *planet_names[], int num_planets) {
+// An alignment query: one tracker over every body, as a chunk_scan detector.
+struct GroupJob {
+    const double *longitudes[MAX_PLANETS];
+    int num_planets;
     double threshold;
     int min_planets;
-    
-    printf("\nEnter Alignment Threshold in Degrees (e.g., 5.0): ");
-    if (scanf("%lf", &threshold) != 1) { fprintf(stderr, "Invalid input.\n"); return; }
-    printf("Enter Minimum Planets for Alignment (e.g., 3): ");
-    if (scanf("%d", &min_planets) != 1) { fprintf(stderr, "Invalid input.\n"); return; }
-
-    printf("\n--- Found Multiple Conjunctions (Threshold: %.2f°, Min Planets: %d) ---\n", threshold, min_planets);
-
-    for (int d = 0; d < frame_count; d++) {
-        struct PlanetData day_data[MAX_PLANETS];
-        for(int i=0; i < num_planets; i++) {
-            day_data[i].name = planet_names[i];
-            day_data[i].longitude = atan2(frames[d].positions[i].y, frames[d].positions[i].x) * 180.0 / M_PI;
-            if (day_data[i].longitude < 0) day_data[i].longitude += 360;
-        }
+    struct FoundGroups groups;
+};
 
-        for (int i = 0; i < num_planets; i++) {
-            struct PlanetData group[MAX_PLANETS];
-            int group_count = 0;
-            group[group_count++] = day_data[i];
-
-            for (int j = i + 1; j < num_planets; j++) {
-                if (angle_diff(day_data[i].longitude, day_data[j].longitude) <= threshold) {
-                    group[group_count++] = day_data[j];
-                }
-            }
+struct GroupChunk {
+    struct GroupTracker tracker;
+    int keep;
+    struct ChunkBuffer *out;
+};
 
-            if (group_count >= min_planets) {
-                printf("%s: ", frames[d].date);
-                for (int k = 0; k < group_count; k++) {
-                    printf("%s ", group[k].name);
-                }
-                printf("(within %.2f°)\n", threshold);
-            }
-        }
+static int write_group(const struct GroupEvent *event, void *userp) {
+    struct GroupChunk *chunk = userp;
+    if (!chunk->keep) return 0;
+    struct FoundGroup group = {event->row, event->spread, {0}, event->count, event->start, event->last, event->key};
+    memcpy(group.members, event->members, event->count * sizeof(int));
+    if (chunk_buffer_write(chunk->out, &group, sizeof(group)) != 0) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int group_start(void *scan, long origin, void *userp) {
+    struct GroupChunk *chunk = scan;
+    const struct GroupJob *job = userp;
+    if (group_tracker_init(&chunk->tracker, job->num_planets, job->threshold, job->min_planets) != 0) return -1;
+    group_tracker_set_origin(&chunk->tracker, origin);
+    return 0;
+}
+
+static int group_feed(void *scan, int lane, long first, long count, int keep, struct ChunkBuffer *out,
+                      void *userp) {
+    (void)lane;
+    struct GroupChunk *chunk = scan;
+    const struct GroupJob *job = userp;
+    const double *columns[MAX_PLANETS];
+    for (int i = 0; i < job->num_planets; i++) columns[i] = job->longitudes[i] + first;
+    chunk->keep = keep;
+    chunk->out = out;
+    return group_tracker_feed(&chunk->tracker, columns, count, write_group, chunk);
+}
+
+static int group_quiet(const void *scan, int lane, void *userp) {
+    (void)lane;
+    (void)userp;
+    const struct GroupChunk *chunk = scan;
+    return group_tracker_quiet(&chunk->tracker);
+}
+
+static int group_finish(void *scan, int lane, struct ChunkBuffer *out, void *userp) {
+    (void)lane;
+    (void)userp;
+    struct GroupChunk *chunk = scan;
+    chunk->keep = 1;
+    chunk->out = out;
+    return group_tracker_finish(&chunk->tracker, write_group, chunk);
+}
+
+static int group_stop(void *scan, struct ChunkBuffer *out, void *userp) {
+    (void)out;
+    (void)userp;
+    struct GroupChunk *chunk = scan;
+    group_tracker_free(&chunk->tracker);
+    return 0;
+}
+
+static int merge_groups(long chunk, const struct ChunkBuffer *out, void *userp) {
+    (void)chunk;
+    struct GroupJob *job = userp;
+    struct FoundGroups *groups = &job->groups;
+    return append_records((void **)&groups->items, &groups->count, &groups->cap, sizeof(*groups->items), out);
+}
+
+// Reads the alignment settings. Returns 0, or -1 on error.
+static int alignments_setup(struct GroupJob *job, struct ChunkScanDetector *detector, struct FrameStore *store,
+                            int num_planets, struct CliParams *params) {
+    if (cli_prompt_double(params, "threshold", "Enter Alignment Threshold in Degrees (e.g., 5.0): ", &job->threshold) != 0 ||
+        cli_prompt_int(params, "min-planets", "Enter Minimum Planets for Alignment (e.g., 3): ", &job->min_planets) != 0) {
+        return -1;
+    }
+    if (job->min_planets < 2) job->min_planets = 2;
+    if (load_longitudes(store, job->longitudes, num_planets) != 0) return -1;
+    job->num_planets = num_planets;
+
+    // Each run of days a cluster stays together is one window (see groups.h).
+    struct ChunkScanDetector windows = {sizeof(struct GroupChunk), 1, GROUP_TRACKER_LEAD_ROWS, group_start,
+                                        group_feed, group_quiet, group_finish, group_stop, merge_groups, job,
+                                        &alignments_time};
+    *detector = windows;
+    return 0;
+}
+
+static int alignments_report(struct GroupJob *job, const struct Dataset *data, char *planet_names[], int failed) {
+    printf("\n\n--- Found Multiple Conjunctions (Threshold: %.2f°, Min Planets: %d) ---\n", job->threshold,
+           job->min_planets);
+    struct FoundGroups *groups = &job->groups;
+    qsort(groups->items, groups->count, sizeof(*groups->items), compare_found_groups);
+    for (size_t k = 0; k < groups->count && !failed; k++) {
+        const struct FoundGroup *group = &groups->items[k];
+        char when[DATASET_TIME_LEN], first[DATASET_DATE_LEN], last[DATASET_DATE_LEN];
+        dataset_time_label(data, group->row, when);
+        dataset_date(data, group->start, first);
+        dataset_date(data, group->last, last);
+        printf("%s: ", when);
+        for (int i = 0; i < group->count; i++) printf("%s ", planet_names[group->members[i]]);
+        printf("(within %.2f° from %s to %s, tightest %.2f°)\n", job->threshold, first, last, group->spread);
     }
     printf("--- Analysis Complete ---\n");
+    return failed ? -1 : 0;
+}
+
+static void alignments_free(struct GroupJob *job) {
+    free(job->groups.items);
 }
 
-void find_oppositions_and_squares(struct Frame *frames, int frame_count, char *planet_names[], int num_planets) {
+// --- Pairwise Aspects ---
+
+// An aspect query: one lane per pair of bodies, so each pair hands over
+// between chunks as soon as it is out of every orb.
+struct AspectJob {
+    const double *longitudes[MAX_PLANETS];
     double threshold;
-    printf("\nEnter Aspect Threshold in Degrees (e.g., 5.0): ");
-    if (scanf("%lf", &threshold) != 1) { fprintf(stderr, "Invalid input.\n"); return; }
+    struct AspectTable table;
+    int num_pairs;
+    int (*pairs)[2];
+    struct EventList events;
+};
 
-    printf("\n--- Found Oppositions and Squares (Threshold: %.2f°) ---\n", threshold);
+struct AspectChunk {
+    struct SeparationScan *scans;   // One per pair
+    int keep;
+    int body_a, body_b;             // Pair being fed
+    struct ChunkBuffer *out;
+    int failed;
+};
 
-    for (int d = 0; d < frame_count; d++) {
-        struct PlanetData day_data[MAX_PLANETS];
-        for(int i=0; i < num_planets; i++) {
-            day_data[i].name = planet_names[i];
-            day_data[i].longitude = atan2(frames[d].positions[i].y, frames[d].positions[i].x) * 180.0 / M_PI;
-            if (day_data[i].longitude < 0) day_data[i].longitude += 360;
-        }
+// Stamps each event with the pair being scanned and keeps it.
+static void write_event(const struct SeparationEvent *event, void *userp) {
+    struct AspectChunk *chunk = userp;
+    if (!chunk->keep) return;
+    struct SeparationEvent stamped = *event;
+    stamped.body_a = chunk->body_a;
+    stamped.body_b = chunk->body_b;
+    if (chunk_buffer_write(chunk->out, &stamped, sizeof(stamped)) != 0) chunk->failed = 1;
+}
 
-        for (int i = 0; i < num_planets; i++) {
-            for (int j = i + 1; j < num_planets; j++) {
-                double diff = angle_diff(day_data[i].longitude, day_data[j].longitude);
-                
-                if (fabs(diff - 180.0) <= threshold) {
-                    printf("%s: %s and %s are in Opposition (%.2f° apart).\n", frames[d].date, planet_names[i], planet_names[j], diff);
-                } else if (fabs(diff - 90.0) <= threshold) {
-                    printf("%s: %s and %s are in a Square (%.2f° apart).\n", frames[d].date, planet_names[i], planet_names[j], diff);
-                }
-            }
+static int aspect_start(void *scan, long origin, void *userp) {
+    struct AspectChunk *chunk = scan;
+    const struct AspectJob *job = userp;
+    chunk->scans = malloc((job->num_pairs > 0 ? job->num_pairs : 1) * sizeof(*chunk->scans));
+    if (chunk->scans == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    for (int p = 0; p < job->num_pairs; p++) {
+        event_scan_init(&chunk->scans[p], &job->table);
+        event_scan_set_origin(&chunk->scans[p], origin);
+    }
+    return 0;
+}
+
+static int aspect_feed(void *scan, int lane, long first, long count, int keep, struct ChunkBuffer *out,
+                       void *userp) {
+    struct AspectChunk *chunk = scan;
+    const struct AspectJob *job = userp;
+    chunk->keep = keep;
+    chunk->body_a = job->pairs[lane][0];
+    chunk->body_b = job->pairs[lane][1];
+    chunk->out = out;
+    event_scan_feed(&chunk->scans[lane], job->longitudes[chunk->body_a] + first,
+                    job->longitudes[chunk->body_b] + first, count, write_event, chunk);
+    if (chunk->failed) fprintf(stderr, "Error: Out of memory.\n");
+    return chunk->failed ? -1 : 0;
+}
+
+static int aspect_quiet(const void *scan, int lane, void *userp) {
+    (void)userp;
+    const struct AspectChunk *chunk = scan;
+    return event_scan_quiet(&chunk->scans[lane]);
+}
+
+static int aspect_finish(void *scan, int lane, struct ChunkBuffer *out, void *userp) {
+    struct AspectChunk *chunk = scan;
+    const struct AspectJob *job = userp;
+    chunk->keep = 1;
+    chunk->body_a = job->pairs[lane][0];
+    chunk->body_b = job->pairs[lane][1];
+    chunk->out = out;
+    event_scan_finish(&chunk->scans[lane], write_event, chunk);
+    if (chunk->failed) fprintf(stderr, "Error: Out of memory.\n");
+    return chunk->failed ? -1 : 0;
+}
+
+static int aspect_stop(void *scan, struct ChunkBuffer *out, void *userp) {
+    (void)out;
+    (void)userp;
+    struct AspectChunk *chunk = scan;
+    free(chunk->scans);
+    return 0;
+}
+
+static int merge_events(long chunk, const struct ChunkBuffer *out, void *userp) {
+    (void)chunk;
+    struct AspectJob *job = userp;
+    struct EventList *events = &job->events;
+    return append_records((void **)&events->items, &events->count, &events->cap, sizeof(*events->items), out);
+}
+
+// Reads the aspect table. Returns 0, or -1 on error.
+static int aspects_setup(struct AspectJob *job, struct ChunkScanDetector *detector, struct FrameStore *store,
+                         int num_planets, struct CliParams *params) {
+    char spec[256];
+    if (cli_prompt_double(params, "threshold", "Enter Aspect Threshold in Degrees (e.g., 5.0): ", &job->threshold) != 0 ||
+        cli_prompt_string(params, "aspects", "Enter Aspects (" ASPECT_SPEC_HELP "): ", spec, sizeof(spec)) != 0) {
+        return -1;
+    }
+    aspect_table_init(&job->table);
+    if (aspect_table_parse(&job->table, spec, job->threshold) != 0) return -1;
+    if (load_longitudes(store, job->longitudes, num_planets) != 0) return -1;
+
+    // One pass per pair classifies every aspect at once; each exact aspect
+    // (or near miss inside its orb) is one event.
+    job->pairs = malloc((num_planets * (num_planets - 1) / 2 + 1) * sizeof(*job->pairs));
+    if (job->pairs == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    for (int i = 0; i < num_planets; i++) {
+        for (int j = i + 1; j < num_planets; j++) {
+            job->pairs[job->num_pairs][0] = i;
+            job->pairs[job->num_pairs][1] = j;
+            job->num_pairs++;
         }
     }
+    struct ChunkScanDetector scans = {sizeof(struct AspectChunk), job->num_pairs, EVENT_SCAN_LEAD_ROWS,
+                                      aspect_start, aspect_feed, aspect_quiet, aspect_finish, aspect_stop,
+                                      merge_events, job, &aspects_time};
+    *detector = scans;
+    return 0;
+}
+
+static int aspects_report(struct AspectJob *job, const struct Dataset *data, char *planet_names[], int failed) {
+    const struct AspectTable *aspects = &job->table;
+    printf("\n\n--- Found Aspects (Threshold: %.2f°) ---\n", job->threshold);
+    for (int a = 0; a < aspects->count; a++) {
+        printf("  %s: %.2f° (orb %.2f°)\n", aspects->aspects[a].name, aspects->aspects[a].angle, aspects->aspects[a].orb);
+    }
+
+    event_list_sort(&job->events);
+    for (size_t k = 0; k < job->events.count && !failed; k++) {
+        const struct SeparationEvent *event = &job->events.items[k];
+        char when[DATASET_TIME_LEN];
+        dataset_time_label(data, event->row, when);
+        double diff = fabs(event_wrap180(event->target + event->separation));
+        printf("%s: %s and %s are in %s (%.2f° apart).\n", when, planet_names[event->body_a],
+               planet_names[event->body_b], aspects->aspects[event->aspect].name, diff);
+    }
     printf("--- Analysis Complete ---\n");
+    return failed ? -1 : 0;
+}
+
+static void aspects_free(struct AspectJob *job) {
+    free(job->pairs);
+    event_list_free(&job->events);
 }
 
 
-void find_closest_approach(struct Frame *frames, int frame_count, char *planet_names[], int num_planets) {
-    int p1_idx = -1, p2_idx = -1;
+// --- Closest Approaches ---
 
-    printf("\nSelect two planets to compare:\n");
+// Reads a planet choice: its menu number, its name, or "all" (0).
+static int prompt_planet(struct CliParams *params, const char *name, const char *prompt,
+                         char *planet_names[], int num_planets, int *out) {
+    char text[DATASET_NAME_LEN];
+    if (cli_prompt_string(params, name, prompt, text, sizeof(text)) != 0) return -1;
+    char *end;
+    long number = strtol(text, &end, 10);
+    if (end != text && *end == '\0') {
+        *out = (int)number;
+        return 0;
+    }
+    if (strcmp(text, "all") == 0) {
+        *out = 0;
+        return 0;
+    }
     for (int i = 0; i < num_planets; i++) {
-        printf("  %d) %s\n", i + 1, planet_names[i]);
+        if (strcmp(planet_names[i], text) == 0) {
+            *out = i + 1;
+            return 0;
+        }
+    }
+    fprintf(stderr, "Error: Unknown planet '%s'.\n", text);
+    return -1;
+}
+
+// A closest-approach query: a single lane over every pair, each chunk
+// ranking its own minima in a heap of the same size.
+struct ApproachJob {
+    const struct FrameStore *store;
+    int bodies[MAX_PLANETS];
+    int num_bodies;
+    int all_pairs;               // Rank every pair, else the one pair in bodies
+    struct ApproachHeap heap;    // Every chunk's approaches, merged
+    long found;
+};
+
+struct ApproachChunk {
+    struct ApproachScan scan;
+    struct ApproachHeap heap;
+    struct ApproachHeap dropped;   // Minima of the lead-in rows
+};
+
+// Header of a chunk's output, followed by `count` approaches.
+struct ApproachRecord {
+    long found;
+    long count;
+};
+
+static int approach_start(void *scan, long origin, void *userp) {
+    struct ApproachChunk *chunk = scan;
+    const struct ApproachJob *job = userp;
+    if (approach_heap_init(&chunk->heap, job->heap.capacity) != 0 || approach_heap_init(&chunk->dropped, 1) != 0 ||
+        approach_scan_init(&chunk->scan, job->bodies, job->num_bodies) != 0) {
+        return -1;
+    }
+    approach_scan_set_origin(&chunk->scan, origin);
+    return 0;
+}
+
+static int approach_feed(void *scan, int lane, long first, long count, int keep, struct ChunkBuffer *out,
+                         void *userp) {
+    (void)lane;
+    (void)out;
+    struct ApproachChunk *chunk = scan;
+    const struct ApproachJob *job = userp;
+    struct FrameStore view = *job->store;
+    view.num_rows = count;
+    for (int i = 0; i < view.num_bodies; i++) {
+        view.x[i] += first;
+        view.y[i] += first;
+        view.z[i] += first;
     }
-    printf("Enter number for first planet: ");
-    if (scanf("%d", &p1_idx) != 1) { fprintf(stderr, "Invalid input.\n"); return; }
-    printf("Enter number for second planet: ");
-    if (scanf("%d", &p2_idx) != 1) { fprintf(stderr, "Invalid input.\n"); return; }
+    long found = chunk->scan.found;
+    approach_scan_feed(&chunk->scan, &view, keep ? &chunk->heap : &chunk->dropped);
+    if (!keep) chunk->scan.found = found;
+    return 0;
+}
+
+// A pair's state is just its last two distances, settled after the lead.
+static int approach_quiet(const void *scan, int lane, void *userp) {
+    (void)scan;
+    (void)lane;
+    (void)userp;
+    return 1;
+}
 
-    p1_idx--; p2_idx--; // Adjust for 0-based indexing
+static int approach_finish(void *scan, int lane, struct ChunkBuffer *out, void *userp) {
+    (void)scan;
+    (void)lane;
+    (void)out;
+    (void)userp;
+    return 0;
+}
+
+static int approach_stop(void *scan, struct ChunkBuffer *out, void *userp) {
+    (void)userp;
+    struct ApproachChunk *chunk = scan;
+    int status = 0;
+    if (out) {
+        struct ApproachRecord record = {chunk->scan.found, chunk->heap.count};
+        if (chunk_buffer_write(out, &record, sizeof(record)) != 0 ||
+            chunk_buffer_write(out, chunk->heap.items, (size_t)chunk->heap.count * sizeof(*chunk->heap.items)) != 0) {
+            fprintf(stderr, "Error: Out of memory.\n");
+            status = -1;
+        }
+    }
+    approach_scan_free(&chunk->scan);
+    approach_heap_free(&chunk->heap);
+    approach_heap_free(&chunk->dropped);
+    return status;
+}
+
+static int merge_approaches(long chunk, const struct ChunkBuffer *out, void *userp) {
+    (void)chunk;
+    struct ApproachJob *job = userp;
+    struct ApproachRecord record;
+    memcpy(&record, out->data, sizeof(record));
+    job->found += record.found;
+    const struct Approach *items = (const struct Approach *)(out->data + sizeof(record));
+    for (long k = 0; k < record.count; k++) approach_heap_push(&job->heap, &items[k]);
+    return 0;
+}
+
+// Reads the planet choice: both planets of one pair, or "all" and how many
+// of the closest approaches to list. Returns 0, or -1 on error.
+static int approaches_setup(struct ApproachJob *job, struct ChunkScanDetector *detector, struct FrameStore *store,
+                            char *planet_names[], int num_planets, struct CliParams *params) {
+    int p1_idx = -1, p2_idx = -1, count = 1;
+
+    if (cli_get(params, "first") == NULL) {
+        printf("\nSelect two planets to compare:\n");
+        printf("  0) All pairs\n");
+        for (int i = 0; i < num_planets; i++) {
+            printf("  %d) %s\n", i + 1, planet_names[i]);
+        }
+    }
+    if (prompt_planet(params, "first", "Enter number for first planet: ", planet_names, num_planets, &p1_idx) != 0) return -1;
+    if (p1_idx == 0) {
+        if (cli_prompt_int(params, "count", "Enter Number of Approaches to List (e.g., 20): ", &count) != 0) return -1;
+        if (count < 1) { fprintf(stderr, "Invalid input.\n"); return -1; }
+        job->all_pairs = 1;
+        job->num_bodies = num_planets;
+        for (int i = 0; i < num_planets; i++) job->bodies[i] = i;
+    } else {
+        if (prompt_planet(params, "second", "Enter number for second planet: ", planet_names, num_planets, &p2_idx) != 0) return -1;
+
+        p1_idx--; p2_idx--; // Adjust for 0-based indexing
+
+        if (p1_idx < 0 || p1_idx >= num_planets || p2_idx < 0 || p2_idx >= num_planets || p1_idx == p2_idx) {
+            fprintf(stderr, "Invalid planet selection.\n");
+            return -1;
+        }
+        job->num_bodies = 2;
+        job->bodies[0] = p1_idx;
+        job->bodies[1] = p2_idx;
+    }
+    if (approach_heap_init(&job->heap, count) != 0) return -1;
+    job->store = store;
+
+    // Too few rows for a minimum: a detector with no lanes finds none.
+    int num_lanes = job->num_bodies >= 2 && store->num_rows >= 3;
+    struct ChunkScanDetector minima = {sizeof(struct ApproachChunk), num_lanes, APPROACH_SCAN_LEAD_ROWS, approach_start,
+                                       approach_feed, approach_quiet, approach_finish, approach_stop,
+                                       merge_approaches, job, &approaches_time};
+    *detector = minima;
+    return 0;
+}
 
-    if (p1_idx < 0 || p1_idx >= num_planets || p2_idx < 0 || p2_idx >= num_planets || p1_idx == p2_idx) {
-        fprintf(stderr, "Invalid planet selection.\n");
-        return;
+// Lists the closest approaches between any two planets.
+static void report_all_closest_approaches(struct ApproachJob *job, const struct Dataset *data,
+                                          char *planet_names[]) {
+    struct ApproachHeap *heap = &job->heap;
+    approach_heap_sort(heap);
+
+    printf("\n--- Closest Approaches (%d of %ld found across %d pairs) ---\n",
+           heap->count, job->found, job->num_bodies * (job->num_bodies - 1) / 2);
+    for (int k = 0; k < heap->count; k++) {
+        const struct Approach *approach = &heap->items[k];
+        char when[DATASET_TIME_LEN];
+        dataset_time_label(data, approach->row, when);
+        printf("%s: %s and %s at %.4f AU\n", when, planet_names[approach->body_a],
+               planet_names[approach->body_b], approach->distance);
     }
+    printf("----------------------------\n");
+}
 
-    double min_dist = -1.0;
-    char closest_date[11] = "";
+static int approaches_report(struct ApproachJob *job, const struct Dataset *data, char *planet_names[], int failed) {
+    if (failed) return -1;
+    if (job->all_pairs) {
+        report_all_closest_approaches(job, data, planet_names);
+        return 0;
+    }
 
-    for (int d = 0; d < frame_count; d++) {
-        double current_dist = distance_3d(frames[d].positions[p1_idx], frames[d].positions[p2_idx]);
-        if (min_dist < 0 || current_dist < min_dist) {
-            min_dist = current_dist;
-            strcpy(closest_date, frames[d].date);
+    // The closest refined local minimum, unless the distance is still
+    // falling at either end of the data.
+    const struct FrameStore *store = job->store;
+    int p1_idx = job->bodies[0], p2_idx = job->bodies[1];
+    struct Approach closest = {-1, -1.0, p1_idx, p2_idx};
+    if (job->heap.count > 0) closest = job->heap.items[0];
+
+    long ends[2] = {0, store->num_rows - 1};
+    for (int e = 0; e < 2 && store->num_rows > 0; e++) {
+        long d = ends[e];
+        double dx = store->x[p1_idx][d] - store->x[p2_idx][d];
+        double dy = store->y[p1_idx][d] - store->y[p2_idx][d];
+        double dz = store->z[p1_idx][d] - store->z[p2_idx][d];
+        double dist = sqrt(dx*dx + dy*dy + dz*dz);
+        if (closest.distance < 0 || dist < closest.distance) {
+            closest.row = (double)d;
+            closest.distance = dist;
         }
     }
 
+    char closest_date[DATASET_TIME_LEN] = "";
+    if (closest.row >= 0) dataset_time_label(data, closest.row, closest_date);
+
     printf("\n--- Closest Approach Found ---\n");
     printf("Planets: %s and %s\n", planet_names[p1_idx], planet_names[p2_idx]);
     printf("Date of Closest Approach: %s\n", closest_date);
-    printf("Minimum Distance: %.4f AU\n", min_dist);
+    printf("Minimum Distance: %.4f AU\n", closest.distance);
     printf("----------------------------\n");
+    return 0;
+}
+
+static void approaches_free(struct ApproachJob *job) {
+    approach_heap_free(&job->heap);
+}
+
+
+// --- Queries ---
+
+// One analysis with its own settings. Queries are set up first, then run
+// together in a single pass over the rows (see common/chunk_scan.h), then
+// reported in the order they were given.
+enum QueryKind { QUERY_ALIGNMENTS, QUERY_ASPECTS, QUERY_APPROACHES };
+
+struct Query {
+    enum QueryKind kind;
+    union {
+        struct GroupJob alignments;
+        struct AspectJob aspects;
+        struct ApproachJob approaches;
+    } job;
+    struct ChunkScanDetector detector;   // userp is set when the queries run
+};
+
+struct QueryList {
+    struct Query *items;
+    int count, cap;
+};
+
+static void free_queries(struct QueryList *list) {
+    for (int k = 0; k < list->count; k++) {
+        struct Query *query = &list->items[k];
+        if (query->kind == QUERY_ALIGNMENTS) alignments_free(&query->job.alignments);
+        else if (query->kind == QUERY_ASPECTS) aspects_free(&query->job.aspects);
+        else approaches_free(&query->job.approaches);
+    }
+    free(list->items);
+    memset(list, 0, sizeof(*list));
+}
+
+// Sets up one query per name in the comma-separated `names` (alignments,
+// aspects, approaches), reading their settings from `params`. Returns 0, or
+// -1 on error.
+static int add_queries(struct QueryList *list, const char *names, struct FrameStore *store, char *planet_names[],
+                       int num_planets, struct CliParams *params) {
+    char copy[CLI_VALUE_LEN];
+    snprintf(copy, sizeof(copy), "%s", names);
+    char *save = NULL;
+    for (char *name = strtok_r(copy, ",", &save); name != NULL; name = strtok_r(NULL, ",", &save)) {
+        if (list->count == list->cap) {
+            int cap = list->cap ? list->cap * 2 : 8;
+            struct Query *items = realloc(list->items, cap * sizeof(*items));
+            if (items == NULL) {
+                fprintf(stderr, "Error: Out of memory.\n");
+                return -1;
+            }
+            list->items = items;
+            list->cap = cap;
+        }
+        struct Query *query = &list->items[list->count];
+        memset(query, 0, sizeof(*query));
+        int status;
+        if (strcmp(name, "alignments") == 0) {
+            query->kind = QUERY_ALIGNMENTS;
+            status = alignments_setup(&query->job.alignments, &query->detector, store, num_planets, params);
+        } else if (strcmp(name, "aspects") == 0) {
+            query->kind = QUERY_ASPECTS;
+            status = aspects_setup(&query->job.aspects, &query->detector, store, num_planets, params);
+        } else if (strcmp(name, "approaches") == 0) {
+            query->kind = QUERY_APPROACHES;
+            status = approaches_setup(&query->job.approaches, &query->detector, store, planet_names, num_planets,
+                                      params);
+        } else {
+            fprintf(stderr, "Error: Unknown analysis '%s' (expected alignments, aspects or approaches).\n", name);
+            return -1;
+        }
+        list->count++;   // Counted even on failure, so free_queries releases it
+        if (status != 0) return -1;
+    }
+    return 0;
+}
+
+// Sets up the queries of a "-queries" file: one or more per line, written
+// as options ("-analysis aspects -threshold 2 -aspects major"). Settings a
+// line leaves out are taken from the command line. Blank lines and lines
+// starting with '#' are skipped. Returns 0, or -1 on error.
+static int add_query_file(struct QueryList *list, const char *path, struct FrameStore *store,
+                          char *planet_names[], int num_planets, const struct CliParams *defaults) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error: Cannot open query file '%s'.\n", path);
+        return -1;
+    }
+    char line[1024];
+    int line_number = 0, status = 0;
+    while (status == 0 && fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char *words[MAX_QUERY_WORDS + 1] = {"-queries"};
+        int num_words = 1;
+        char *save = NULL;
+        for (char *word = strtok_r(line, " \t\r\n", &save); word != NULL; word = strtok_r(NULL, " \t\r\n", &save)) {
+            if (num_words > MAX_QUERY_WORDS) {
+                fprintf(stderr, "Error: %s:%d: Too many options.\n", path, line_number);
+                status = -1;
+                break;
+            }
+            words[num_words++] = word;
+        }
+        if (status != 0 || num_words == 1 || words[1][0] == '#') continue;
+
+        struct CliParams params = *defaults;
+        params.batch = 1;
+        int has_analysis = 0;
+        for (int a = 1; a < num_words && status == 0; a++) {
+            if (strcmp(words[a], "-analysis") == 0) has_analysis = 1;
+            int used = cli_parse_option(num_words, words, &a, &params);
+            if (used == 0) fprintf(stderr, "Error: %s:%d: Unknown option '%s'.\n", path, line_number, words[a]);
+            if (used <= 0) status = -1;
+        }
+        if (status == 0 && !has_analysis) {
+            fprintf(stderr, "Error: %s:%d: Each query needs -analysis.\n", path, line_number);
+            status = -1;
+        }
+        if (status == 0) status = add_queries(list, cli_get(&params, "analysis"), store, planet_names, num_planets, &params);
+    }
+    fclose(file);
+    return status;
+}
+
+// Runs every query in a single pass over the rows, then reports each in
+// order. Returns 0 if all of them succeed.
+static int run_queries(struct QueryList *list, const struct FrameStore *store, const struct Dataset *data,
+                       char *planet_names[], int num_threads) {
+    struct ChunkScanDetector *detectors = malloc((list->count > 0 ? list->count : 1) * sizeof(*detectors));
+    if (detectors == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    for (int k = 0; k < list->count; k++) {
+        struct Query *query = &list->items[k];
+        detectors[k] = query->detector;
+        detectors[k].userp = &query->job;
+    }
+    int failed = chunk_scan_run(detectors, list->count, store->num_rows,
+                                chunk_scan_rows(store->num_rows, num_threads), num_threads) != 0;
+    free(detectors);
+
+    int status = failed ? -1 : 0;
+    for (int k = 0; k < list->count; k++) {
+        struct Query *query = &list->items[k];
+        int reported;
+        if (query->kind == QUERY_ALIGNMENTS) reported = alignments_report(&query->job.alignments, data, planet_names, failed);
+        else if (query->kind == QUERY_ASPECTS) reported = aspects_report(&query->job.aspects, data, planet_names, failed);
+        else reported = approaches_report(&query->job.approaches, data, planet_names, failed);
+        if (reported != 0) status = -1;
+    }
+    return status;
+}
+
+// Runs the analyses named in the comma-separated `names` as one batch.
+static int run_named(const char *names, struct FrameStore *store, const struct Dataset *data, char *planet_names[],
+                     int num_planets, struct CliParams *params, int num_threads) {
+    struct QueryList list = {0};
+    int status = add_queries(&list, names, store, planet_names, num_planets, params);
+    if (status == 0) status = run_queries(&list, store, data, planet_names, num_threads);
+    free_queries(&list);
+    return status;
+}
+
+int find_multi_alignments(struct FrameStore *store, const struct Dataset *data, char *planet_names[], int num_planets,
+                          struct CliParams *params, int num_threads) {
+    return run_named("alignments", store, data, planet_names, num_planets, params, num_threads);
+}
+
+int find_aspects(struct FrameStore *store, const struct Dataset *data, char *planet_names[], int num_planets,
+                 struct CliParams *params, int num_threads) {
+    return run_named("aspects", store, data, planet_names, num_planets, params, num_threads);
+}
+
+int find_closest_approach(struct FrameStore *store, const struct Dataset *data, char *planet_names[], int num_planets,
+                          struct CliParams *params, int num_threads) {
+    return run_named("approaches", store, data, planet_names, num_planets, params, num_threads);
+}
+
+// Runs the analyses of the comma-separated "-analysis" list (alignments,
+// aspects, approaches) and of the "-queries" file together, in a single
+// pass over the data. Returns 0 if all of them succeed.
+static int run_analyses(struct FrameStore *store, const struct Dataset *data, char *planet_names[], int num_planets,
+                        struct CliParams *params, int num_threads) {
+    const char *names = cli_get(params, "analysis");
+    const char *path = cli_get(params, "queries");
+    if (names == NULL && path == NULL) {
+        fprintf(stderr, "Error: -analysis or -queries is required in batch mode.\n");
+        return -1;
+    }
+    struct QueryList list = {0};
+    int status = 0;
+    if (names != NULL) status = add_queries(&list, names, store, planet_names, num_planets, params);
+    if (status == 0 && path != NULL) {
+        status = add_query_file(&list, path, store, planet_names, num_planets, params);
+    }
+    if (status == 0) status = run_queries(&list, store, data, planet_names, num_threads);
+    free_queries(&list);
+    return status;
 }
@@ -8,11 +8,62 @@
  *
  * Use the mouse wheel to zoom in and out.
  * Click the mouse button to pause/resume the animation.
+ * Drag left/right to scrub through time (further per pixel at higher speeds).
  * Use the UP/DOWN arrow keys to change the animation speed.
  * Use the LEFT/RIGHT arrow keys to change the playback direction.
  *
+ * The input may also be a binary ephemeris written with "kepler_sim_3d
+ * -binary" (see common/ephemeris.h); the format is detected automatically.
+ * "-input FILE" skips the prompt, and "-input -" reads the data from stdin
+ * (see common/cli.h).
+ *
+ * "-live" needs no file at all: the planets' orbital elements are fetched
+ * for "-start" (see common/elements.h; the fetch and cache flags of
+ * kepler_sim_3d apply) and every frame is propagated on demand by the
+ * Kepler propagator in common/kepler.h, one "-step" apart (default 1d).
+ * The timeline runs LIVE_SPAN_YEARS either side of the start, so playback
+ * and scrubbing work in both directions with fixed memory use.
+ *
+ * Files of any length open at once: the file is memory-mapped lazily (see
+ * dataset_open_lazy in common/dataset.h) and only two windows of
+ * WINDOW_FRAMES rows are parsed into memory, one around the playback
+ * position and one around the far end of the trail, each reloaded as its
+ * end moves out of it. A CSV is indexed a few megabytes per drawn frame, so
+ * playback starts immediately and the end of the data moves out as rows
+ * are found.
+ *
+ * Drawing is batched: each trail is one SDL_RenderDrawLines call over its
+ * distinct screen points and the planet dots are one SDL_RenderFillRects
+ * call. The name labels are rendered to textures once at startup, and the
+ * info line is re-rendered only when its text changes, so a frame makes no
+ * SDL_ttf calls and creates no textures while it stays the same.
+ *
+ * Trails cover the last "-trail N" frames (default DEFAULT_TRAIL_FRAMES;
+ * about 60200 daily frames make a whole Neptune orbit). Their positions
+ * are kept in a per-body ring indexed by frame, under a pyramid of
+ * aligned spans of 2, 4, 8... frames. Each span stores a bound on how far
+ * its frames stray from the chord between its ends. A trail is drawn by
+ * walking the pyramid and emitting a span as one segment once its bound
+ * is under TRAIL_TOLERANCE_PX on screen, or once it lies off screen. The
+ * segment count therefore follows what is visible rather than the trail
+ * length. Advancing (or reversing) adds only the frames that enter the
+ * trail and the spans they complete. Playback runs on a
+ * fixed timestep, independent of render cost, and the dots are
+ * interpolated between data frames; frames are paced by vsync where the
+ * renderer offers it.
+ *
+ * "-bench N" times N frames headless and exits: no window is opened, each
+ * frame is drawn by SDL's software renderer into an off-screen surface and
+ * advances playback by exactly BENCH_FRAME_SECONDS, with no vsync or frame
+ * cap. The result is printed in the format of benchmarks/planetary_bench.c,
+ * e.g. "BenchmarkVisualizerFrame  600  812345.00 ns/op  1231 frames/s", so
+ * a run on the same file is comparable between builds.
+ *
+ * "-stats" prints load, index and per-frame drawing times at exit (see
+ * common/stats.h).
+ *
  * Compilation:
- * gcc visualizer.c -o sdl_visualizer `sdl2-config --cflags --libs` -lSDL2_ttf -lm
+ * gcc visualizer.c ../common/cli.c ../common/dataset.c ../common/ephemeris.c ../common/timebase.c ../common/fetch.c ../common/cache.c ../common/horizons_parse.c ../common/kepler.c ../common/elements.c ../common/stats.c -I../common -o sdl_visualizer `sdl2-config --cflags --libs` -lSDL2_ttf -lcurl -lm
  */
 
 #define _GNU_SOURCE
@@ -22,79 +73,483 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <math.h>
+#include "dataset.h"
+#include "cli.h"
+#include "cache.h"
+#include "fetch.h"
+#include "kepler.h"
+#include "elements.h"
+#include "timebase.h"
+#include "stats.h"
 
 #define MAX_PLANETS 10
-#define MAX_LINE_LEN 1024
 #define SCREEN_WIDTH 800
 #define SCREEN_HEIGHT 800
 #define PIXELS_PER_AU 100.0 // At 1x zoom, 1 AU = 100 pixels
-#define MAX_TRAIL_LENGTH 500 // Draw the last 500 segments of the trail
+#define DEFAULT_TRAIL_FRAMES 500 // Frames behind the dots drawn as trails
+#define MAX_TRAIL_FRAMES (1L << 20)
+#define TRAIL_TOLERANCE_PX 0.5 // Largest on-screen deviation of a decimated trail
+#define PLAYBACK_RATE 20.0 // Data frames per second at 1x speed
+#define TICK_SECONDS (1.0 / 120.0) // Fixed playback timestep
+#define MAX_ELAPSED 0.25 // Longest real-time gap caught up in one go, seconds
+#define MIN_FRAME_MS 16 // Frame cap when the renderer has no vsync
+#define WINDOW_FRAMES 4096 // Data frames held in memory around the playback position
+#define INDEX_BYTES_PER_FRAME ((size_t)4 << 20) // CSV bytes indexed per drawn frame
+#define LIVE_SPAN_YEARS 1000 // Live timeline either side of the start date
+#define SCRUB_FRAMES_PER_PIXEL 1.0 // Frames a drag moves per pixel at 1x speed
 #define VERSION "v1.1"
+#define TEXT_MAX 160
+#define BENCH_FRAME_SECONDS (1.0 / 60.0) // Playback time per frame under -bench
 
-// Struct to hold a single frame of data for all planets
-struct Frame {
-    char date[11];
-    double x[MAX_PLANETS];
-    double y[MAX_PLANETS];
+static struct StatsEntry frame_time = STATS_ENTRY("render.frame", STATS_TIMER, "ns");
+
+// WINDOW_FRAMES consecutive data frames, laid out as by dataset_read_rows.
+struct FrameWindow {
+    double *rows;
+    long first, count;  // Frames the window holds
 };
 
-int main(int argc, char *argv[]) {
-    char input_filename[100];
-    struct Frame *frames = NULL;
-    int frame_count = 0;
-    char *planet_names[MAX_PLANETS];
-    int num_planets = 0;
-    int earth_idx = -1, moon_idx = -1; // Indices for Earth and Moon
+// The bodies on screen and windows of data frames around the playback
+// position and the far end of the trail, read from a dataset or, in live
+// mode, propagated. Keeping the trail's far end apart means playing back
+// or scrubbing with a trail longer than WINDOW_FRAMES / 2 does not reload
+// one window twice per frame.
+struct Bodies {
+    int count;
+    const char *names[MAX_PLANETS];
+    int earth_idx, moon_idx;          // -1 when absent
+    const struct Dataset *data;       // NULL in live mode
+    const struct KeplerBatch *batch;  // Live mode: the planets' propagation constants
+    int64_t origin, step;             // Live mode: time of frame 0 and between frames
+    int with_time;                    // Live mode: labels carry the time of day
+    double *scratch;                  // Live mode: times and per-body columns
+    int row_len;                      // Values per window row
+    long num_frames;                  // Frames available so far
+    struct FrameWindow view;          // Around the playback position
+    struct FrameWindow tail;          // Around the far end of the trail
+};
 
-    printf("--- SDL Solar System Visualizer ---\n");
-    printf("Enter Input CSV Filename (e.g., data_3d.csv): ");
-    if (scanf("%99s", input_filename) != 1) {
-        fprintf(stderr, "Invalid input.\n");
-        return 1;
+// Heliocentric positions of frames [first, last] for every body, frame f
+// in slot f & (capacity - 1), with the error pyramid over them. Span (L, k)
+// covers frames [k << L, (k + 1) << L]; its bound (AU) is kept for L >= 1
+// in `error`, level L starting at capacity - (capacity >> (L - 1)).
+struct TrailPyramid {
+    long capacity;      // Power of two above the trail length
+    int levels;         // log2(capacity)
+    double *xs[MAX_PLANETS], *ys[MAX_PLANETS];
+    float *error[MAX_PLANETS];
+    long first, last;   // Empty when first > last
+};
+
+// Text rendered once and kept as a texture until it changes.
+struct TextTexture {
+    SDL_Texture *texture;
+    int w, h;
+    char text[TEXT_MAX];
+};
+
+// Propagates frames [first, first + count) into `window`.
+static void live_read_frames(struct Bodies *bodies, struct FrameWindow *window, long first, long count) {
+    double *days = bodies->scratch, *xs = days + WINDOW_FRAMES;
+    double *ys = xs + (size_t)bodies->count * WINDOW_FRAMES, *zs = ys + (size_t)bodies->count * WINDOW_FRAMES;
+    for (long r = 0; r < count; r++) {
+        days[r] = (double)(bodies->origin + (int64_t)(first + r) * bodies->step) / KEPLER_SECONDS_PER_DAY;
     }
+    kepler_batch_propagate(bodies->batch, days, (int)count, xs, ys, zs);
+    for (long r = 0; r < count; r++) {
+        double *row = window->rows + (size_t)r * bodies->row_len;
+        for (int b = 0; b < bodies->count; b++) {
+            row[b * 3] = xs[(size_t)b * count + r];
+            row[b * 3 + 1] = ys[(size_t)b * count + r];
+            row[b * 3 + 2] = zs[(size_t)b * count + r];
+        }
+    }
+}
 
-    // --- Load Data File into Memory ---
-    FILE *infile = fopen(input_filename, "r");
-    if (infile == NULL) {
-        perror("Error opening input file");
-        return 1;
+// Values of `frame` (a row that has been indexed), reloading `window`
+// around it when it lies outside.
+static const double *window_row(struct Bodies *bodies, struct FrameWindow *window, long frame) {
+    size_t row_len = (size_t)bodies->row_len;
+    if (frame < window->first || frame >= window->first + window->count) {
+        long first = frame - WINDOW_FRAMES / 2;
+        if (first < 0) first = 0;
+        long count = bodies->num_frames - first;
+        if (count > WINDOW_FRAMES) count = WINDOW_FRAMES;
+        if (bodies->batch) {
+            live_read_frames(bodies, window, first, count);
+        } else if (dataset_read_rows(bodies->data, first, count, window->rows) != 0) {
+            memset(window->rows, 0, row_len * sizeof(double));
+            first = frame;
+            count = 0;
+        }
+        window->first = first;
+        window->count = count;
+        if (count == 0) return window->rows;
+    }
+    return window->rows + (size_t)(frame - window->first) * row_len;
+}
+
+// Heliocentric x/y of `body` at `frame`, read through `window` (the Moon's
+// columns are geocentric).
+static void body_position(struct Bodies *bodies, struct FrameWindow *window, int body, long frame, double *x, double *y) {
+    const double *row = window_row(bodies, window, frame);
+    *x = row[body * 3];
+    *y = row[body * 3 + 1];
+    if (body == bodies->moon_idx && bodies->earth_idx != -1) {
+        *x += row[bodies->earth_idx * 3];
+        *y += row[bodies->earth_idx * 3 + 1];
+    }
+}
+
+static SDL_Point to_screen(double x, double y, double scale) {
+    SDL_Point point = {(int)(SCREEN_WIDTH / 2 + x * scale), (int)(SCREEN_HEIGHT / 2 + y * scale)};
+    return point;
+}
+
+// Allocates a pyramid for trails of up to `frames` frames. Returns 0 on success.
+static int trail_pyramid_init(struct TrailPyramid *pyramid, int bodies, long frames) {
+    pyramid->capacity = 2;
+    pyramid->levels = 1;
+    while (pyramid->capacity < frames + 2) {
+        pyramid->capacity *= 2;
+        pyramid->levels++;
+    }
+    pyramid->first = 1;
+    pyramid->last = 0;
+    for (int p = 0; p < bodies; p++) {
+        pyramid->xs[p] = malloc(pyramid->capacity * sizeof(double));
+        pyramid->ys[p] = malloc(pyramid->capacity * sizeof(double));
+        pyramid->error[p] = malloc(pyramid->capacity * sizeof(float));
+        if (!pyramid->xs[p] || !pyramid->ys[p] || !pyramid->error[p]) return -1;
+    }
+    return 0;
+}
+
+static void trail_pyramid_free(struct TrailPyramid *pyramid, int bodies) {
+    for (int p = 0; p < bodies; p++) {
+        free(pyramid->xs[p]);
+        free(pyramid->ys[p]);
+        free(pyramid->error[p]);
+    }
+}
+
+static float *span_error(const struct TrailPyramid *pyramid, int body, int level, long k) {
+    long offset = pyramid->capacity - (pyramid->capacity >> (level - 1));
+    return &pyramid->error[body][offset + (k & ((pyramid->capacity >> level) - 1))];
+}
+
+// Distance from (px, py) to the segment (ax, ay)-(bx, by).
+static double segment_distance(double px, double py, double ax, double ay, double bx, double by) {
+    double dx = bx - ax, dy = by - ay, len2 = dx * dx + dy * dy;
+    double t = len2 > 0 ? ((px - ax) * dx + (py - ay) * dy) / len2 : 0;
+    if (t < 0) t = 0;
+    if (t > 1) t = 1;
+    return hypot(px - ax - t * dx, py - ay - t * dy);
+}
+
+// Bounds span (level, k) from its two halves: every frame is within a
+// half's bound of that half's chord, which is within the midpoint's
+// distance of the whole chord.
+static void span_compute(struct TrailPyramid *pyramid, int bodies, int level, long k) {
+    long mask = pyramid->capacity - 1;
+    long a = (k << level) & mask, m = ((k << level) + (1L << (level - 1))) & mask, b = ((k + 1) << level) & mask;
+    for (int p = 0; p < bodies; p++) {
+        double halves = 0;
+        if (level > 1) {
+            float left = *span_error(pyramid, p, level - 1, 2 * k), right = *span_error(pyramid, p, level - 1, 2 * k + 1);
+            halves = left > right ? left : right;
+        }
+        const double *xs = pyramid->xs[p], *ys = pyramid->ys[p];
+        *span_error(pyramid, p, level, k) = (float)(halves + segment_distance(xs[m], ys[m], xs[a], ys[a], xs[b], ys[b]));
+    }
+}
+
+// Stores frame `f` just outside the held range and bounds the spans it
+// completes. Frames added at the near end are read through the playback
+// window and frames added at the far end through the trail's own.
+static void trail_pyramid_add(struct TrailPyramid *pyramid, struct Bodies *bodies, long f) {
+    long slot = f & (pyramid->capacity - 1);
+    int forward = f > pyramid->last;
+    struct FrameWindow *window = forward ? &bodies->view : &bodies->tail;
+    for (int p = 0; p < bodies->count; p++) {
+        body_position(bodies, window, p, f, &pyramid->xs[p][slot], &pyramid->ys[p][slot]);
+    }
+    if (forward) pyramid->last = f; else pyramid->first = f;
+    for (int level = 1; level < pyramid->levels && (f & ((1L << level) - 1)) == 0; level++) {
+        if (forward) {
+            if (f - (1L << level) < pyramid->first) break;
+            span_compute(pyramid, bodies->count, level, (f >> level) - 1);
+        } else {
+            if (f + (1L << level) > pyramid->last) break;
+            span_compute(pyramid, bodies->count, level, f >> level);
+        }
+    }
+}
+
+// Moves the pyramid to frames [first, last], adding only the frames it did
+// not already hold.
+static void trail_pyramid_update(struct TrailPyramid *pyramid, struct Bodies *bodies, long first, long last) {
+    if (first > pyramid->last + 1 || last < pyramid->first - 1 || pyramid->first > pyramid->last) {
+        pyramid->first = first;
+        pyramid->last = first - 1;
+    } else {
+        if (pyramid->first < first) pyramid->first = first;
+        if (pyramid->last > last) pyramid->last = last;
     }
+    while (pyramid->first > first) trail_pyramid_add(pyramid, bodies, pyramid->first - 1);
+    while (pyramid->last < last) trail_pyramid_add(pyramid, bodies, pyramid->last + 1);
+}
+
+// Appends `point` unless it is on the same pixel as the last one.
+static void trail_append(SDL_Point *points, int *count, SDL_Point point) {
+    if (*count > 0 && point.x == points[*count - 1].x && point.y == points[*count - 1].y) return;
+    points[(*count)++] = point;
+}
 
-    char line[MAX_LINE_LEN];
-    // Read header and find Earth/Moon indices
-    if (fgets(line, sizeof(line), infile)) {
-        line[strcspn(line, "\n")] = 0;
-        char *token = strtok(line, ","); // Skip "Date"
-        while ((token = strtok(NULL, ",")) != NULL && num_planets < MAX_PLANETS) {
-            char *p_name = strdup(token);
-            *strchr(p_name, '_') = '\0';
-            if (strcmp(p_name, "Earth") == 0) earth_idx = num_planets;
-            if (strcmp(p_name, "Moon") == 0) moon_idx = num_planets;
-            planet_names[num_planets++] = p_name;
-            strtok(NULL, ","); strtok(NULL, ","); // Skip _y and _z
+// Emits the end of span (level, k) of `body`, refining the span first
+// while its error bound is visible and over the tolerance.
+static void trail_emit_span(const struct TrailPyramid *pyramid, int body, int level, long k, double scale,
+                            SDL_Point *points, int *count) {
+    long mask = pyramid->capacity - 1, b = ((k + 1) << level) & mask;
+    SDL_Point end = to_screen(pyramid->xs[body][b], pyramid->ys[body][b], scale);
+    if (level > 0) {
+        double error = *span_error(pyramid, body, level, k) * scale;
+        long a = (k << level) & mask;
+        SDL_Point start = to_screen(pyramid->xs[body][a], pyramid->ys[body][a], scale);
+        int visible = (start.x < end.x ? start.x : end.x) - error < SCREEN_WIDTH &&
+                      (start.x > end.x ? start.x : end.x) + error >= 0 &&
+                      (start.y < end.y ? start.y : end.y) - error < SCREEN_HEIGHT &&
+                      (start.y > end.y ? start.y : end.y) + error >= 0;
+        if (visible && error > TRAIL_TOLERANCE_PX) {
+            trail_emit_span(pyramid, body, level - 1, 2 * k, scale, points, count);
+            trail_emit_span(pyramid, body, level - 1, 2 * k + 1, scale, points, count);
+            return;
         }
     }
+    trail_append(points, count, end);
+}
+
+// Writes the decimated trail of `body` over frames [first, last] (held by
+// the pyramid) into `points`, returning the number of points.
+static int trail_build(const struct TrailPyramid *pyramid, int body, long first, long last, double scale, SDL_Point *points) {
+    int count = 0;
+    long slot = first & (pyramid->capacity - 1);
+    trail_append(points, &count, to_screen(pyramid->xs[body][slot], pyramid->ys[body][slot], scale));
+    for (long f = first; f < last;) {
+        // Largest aligned span starting at f that fits.
+        int level = 0;
+        while (level + 1 < pyramid->levels && (f & ((2L << level) - 1)) == 0 && f + (2L << level) <= last) level++;
+        trail_emit_span(pyramid, body, level, f >> level, scale, points, &count);
+        f += 1L << level;
+    }
+    return count;
+}
+
+// Renders `text` into `cache` unless it already holds that text.
+static void text_texture_set(struct TextTexture *cache, SDL_Renderer *renderer, TTF_Font *font, const char *text) {
+    if (cache->texture && strcmp(cache->text, text) == 0) return;
+    if (cache->texture) SDL_DestroyTexture(cache->texture);
+    cache->texture = NULL;
+    snprintf(cache->text, sizeof(cache->text), "%s", text);
+    SDL_Color white = {255, 255, 255, 255};
+    SDL_Surface *surface = TTF_RenderText_Solid(font, cache->text, white);
+    if (surface == NULL) return;
+    cache->texture = SDL_CreateTextureFromSurface(renderer, surface);
+    cache->w = surface->w;
+    cache->h = surface->h;
+    SDL_FreeSurface(surface);
+}
+
+static void text_texture_draw(const struct TextTexture *cache, SDL_Renderer *renderer, int x, int y) {
+    if (cache->texture == NULL) return;
+    SDL_Rect rect = {x, y, cache->w, cache->h};
+    SDL_RenderCopy(renderer, cache->texture, NULL, &rect);
+}
+
+static void text_texture_free(struct TextTexture *cache) {
+    if (cache->texture) SDL_DestroyTexture(cache->texture);
+    cache->texture = NULL;
+}
+
+// Lazily opens `path` and sets `bodies` up to read it a window at a time.
+// Returns 0 on success.
+static int file_open(struct Bodies *bodies, struct Dataset *data, const char *path) {
+    if (dataset_open_lazy(data, path) != 0) {
+        return -1;
+    }
+    if (data->values_per_body != 3) {
+        fprintf(stderr, "Error: %s holds longitudes only; the visualizer needs x/y/z positions.\n", path);
+        dataset_close(data);
+        return -1;
+    }
+    bodies->count = data->num_bodies < MAX_PLANETS ? data->num_bodies : MAX_PLANETS;
+    for (int i = 0; i < bodies->count; i++) {
+        bodies->names[i] = data->names[i];
+        if (strcmp(bodies->names[i], "Earth") == 0) bodies->earth_idx = i;
+        if (strcmp(bodies->names[i], "Moon") == 0) bodies->moon_idx = i;
+    }
+    bodies->data = data;
+    bodies->row_len = data->num_bodies * 3;
+    bodies->view.rows = malloc((size_t)WINDOW_FRAMES * bodies->row_len * sizeof(double));
+    bodies->tail.rows = malloc((size_t)WINDOW_FRAMES * bodies->row_len * sizeof(double));
+    if (bodies->view.rows == NULL || bodies->tail.rows == NULL) {
+        free(bodies->view.rows);
+        free(bodies->tail.rows);
+        fprintf(stderr, "Error: Out of memory.\n");
+        dataset_close(data);
+        return -1;
+    }
+    while (data->num_rows == 0 && !dataset_index_rows(data, INDEX_BYTES_PER_FRAME)) {
+        // Find the first rows before opening the window.
+    }
+    bodies->num_frames = data->num_rows;
+    if (data->indexed) {
+        printf("Loaded %ld rows of data.\n", data->num_rows);
+    } else {
+        printf("Indexing rows while playing (%ld so far).\n", data->num_rows);
+    }
+    if (data->num_rows == 0) {
+        fprintf(stderr, "Error: No data rows to display.\n");
+        free(bodies->view.rows);
+        free(bodies->tail.rows);
+        dataset_close(data);
+        return -1;
+    }
+    return 0;
+}
+
+// Fetches the planets' elements for the "-start" time and sets `bodies` up
+// to propagate LIVE_SPAN_YEARS either side of it. Returns 0 on success.
+static int live_open(struct Bodies *bodies, struct KeplerBatch *batch, struct CliParams *params, int debug_mode) {
+    char start_input[TIMEBASE_LABEL_LEN];
+    int64_t start_t, step = TIMEBASE_DEFAULT_STEP;
+    if (cli_prompt_string(params, "start", "Enter Start Date (YYYY-MM-DD): ", start_input, sizeof(start_input)) != 0) {
+        return -1;
+    }
+    if (timebase_parse(start_input, &start_t) != 0) {
+        fprintf(stderr, "Error: Dates must be YYYY-MM-DD or YYYY-MM-DD HH:MM.\n");
+        return -1;
+    }
+    if (cli_get(params, "step") && timebase_parse_step(cli_get(params, "step"), &step) != 0) {
+        fprintf(stderr, "Error: -step must be %s.\n", TIMEBASE_STEP_HELP);
+        return -1;
+    }
+
+    // Elements for midnight of the start date, as kepler_sim_3d fetches them.
+    int64_t epoch_t = start_t - start_t % TIMEBASE_SECONDS_PER_DAY;
+    if (start_t % TIMEBASE_SECONDS_PER_DAY < 0) epoch_t -= TIMEBASE_SECONDS_PER_DAY;
+    char epoch_label[TIMEBASE_LABEL_LEN];
+    timebase_format(epoch_t, 0, epoch_label);
+    printf("Fetching orbital elements from NASA for epoch %s...\n", epoch_label);
+    if (fetch_init() != 0) {
+        fprintf(stderr, "Error: Could not initialise libcurl.\n");
+        return -1;
+    }
+    struct KeplerElements elements[ELEMENTS_NUM_PLANETS];
+    int status = 0;
+    for (int i = 0; i < ELEMENTS_NUM_PLANETS && status == 0; i++) {
+        status = elements_fetch(&ELEMENTS_PLANETS[i], epoch_t, debug_mode, &elements[i]);
+    }
+    fetch_cleanup();
+    if (status != 0) {
+        fprintf(stderr, "Error: Could not fetch the orbital elements.\n");
+        return -1;
+    }
+    if (kepler_batch_init(batch, elements, ELEMENTS_NUM_PLANETS) != 0) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+
+    bodies->count = ELEMENTS_NUM_PLANETS;
+    for (int i = 0; i < bodies->count; i++) {
+        bodies->names[i] = ELEMENTS_PLANETS[i].name;
+        if (strcmp(bodies->names[i], "Earth") == 0) bodies->earth_idx = i;
+    }
+    long half = (long)(LIVE_SPAN_YEARS * 365.25 * TIMEBASE_SECONDS_PER_DAY / (double)step);
+    bodies->batch = batch;
+    bodies->step = step;
+    bodies->origin = start_t - (int64_t)half * step;
+    bodies->with_time = timebase_has_time(start_t, step);
+    bodies->num_frames = 2 * half + 1;
+    bodies->row_len = bodies->count * 3;
+    bodies->view.rows = malloc((size_t)WINDOW_FRAMES * bodies->row_len * sizeof(double));
+    bodies->tail.rows = malloc((size_t)WINDOW_FRAMES * bodies->row_len * sizeof(double));
+    bodies->scratch = malloc((size_t)WINDOW_FRAMES * (1 + 3 * bodies->count) * sizeof(double));
+    if (bodies->view.rows == NULL || bodies->tail.rows == NULL || bodies->scratch == NULL) {
+        fprintf(stderr, "Error: Out of memory.\n");
+        return -1;
+    }
+    printf("Propagating live from %s, %d years either way.\n", start_input, LIVE_SPAN_YEARS);
+    return 0;
+}
 
-    // Read data frames
-    while (fgets(line, sizeof(line), infile)) {
-        frames = realloc(frames, (frame_count + 1) * sizeof(struct Frame));
-        char *line_ptr = line;
-        
-        char *token = strsep(&line_ptr, ",");
-        strncpy(frames[frame_count].date, token, 10);
-        frames[frame_count].date[10] = '\0';
+// Writes the date label of `frame`.
+static void frame_date(const struct Bodies *bodies, long frame, char *out) {
+    if (bodies->batch) {
+        timebase_format(bodies->origin + (int64_t)frame * bodies->step, bodies->with_time, out);
+    } else {
+        dataset_date(bodies->data, frame, out);
+    }
+}
 
-        for (int i = 0; i < num_planets; i++) {
-            frames[frame_count].x[i] = atof(strsep(&line_ptr, ","));
-            frames[frame_count].y[i] = atof(strsep(&line_ptr, ","));
-            strsep(&line_ptr, ","); // Skip Z
+int main(int argc, char *argv[]) {
+    char input_filename[100];
+    struct Dataset data = {0};
+    long frame_count = 0;
+    struct Bodies bodies = {0};
+    bodies.earth_idx = bodies.moon_idx = -1;
+    int live_mode = 0, debug_mode = 0;
+
+    static const char *const param_names[] = {"input", "trail", "start", "step", "bench", NULL};
+    struct CliParams params;
+    cli_init(&params, param_names);
+    for (int a = 1; a < argc; a++) {
+        int used = cli_parse_option(argc, argv, &a, &params);
+        if (used < 0) return 1;
+        if (used || cache_parse_option(argc, argv, &a) || stats_parse_option(argc, argv, &a)) {
+            continue;
+        } else if (strcmp(argv[a], "-live") == 0) {
+            live_mode = 1;
+        } else if (strcmp(argv[a], "-debug") == 0) {
+            debug_mode = 1;
+        } else {
+            fprintf(stderr, "Error: Unknown option '%s'.\n", argv[a]);
+            return 1;
         }
-        frame_count++;
     }
-    fclose(infile);
-    printf("Loaded %d days of data.\n", frame_count);
+    cli_begin(&params);
+    long trail_frames = DEFAULT_TRAIL_FRAMES;
+    if (cli_get(&params, "trail")) {
+        char *end;
+        trail_frames = strtol(cli_get(&params, "trail"), &end, 10);
+        if (*end != '\0' || trail_frames < 1 || trail_frames > MAX_TRAIL_FRAMES) {
+            fprintf(stderr, "Error: -trail must be a frame count from 1 to %ld.\n", MAX_TRAIL_FRAMES);
+            return 1;
+        }
+    }
+    long bench_frames = 0;
+    if (cli_get(&params, "bench")) {
+        char *end;
+        bench_frames = strtol(cli_get(&params, "bench"), &end, 10);
+        if (*end != '\0' || bench_frames < 1) {
+            fprintf(stderr, "Error: -bench must be a positive frame count.\n");
+            return 1;
+        }
+    }
+
+    printf("--- SDL Solar System Visualizer ---\n");
+    struct KeplerBatch batch;
+    if (live_mode) {
+        if (live_open(&bodies, &batch, &params, debug_mode) != 0) return 1;
+    } else if (cli_prompt_string(&params, "input", "Enter Input CSV Filename (e.g., data_3d.csv): ",
+                                 input_filename, sizeof(input_filename)) != 0 ||
+               file_open(&bodies, &data, input_filename) != 0) {
+        return 1;
+    }
+    frame_count = bodies.num_frames;
 
     // --- Initialize SDL ---
+    if (bench_frames) setenv("SDL_VIDEODRIVER", "dummy", 0);   // No display needed
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         fprintf(stderr, "Could not initialize SDL: %s\n", SDL_GetError());
         return 1;
@@ -104,10 +559,22 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    SDL_Window *window = SDL_CreateWindow("Solar System Visualizer",
-                                          SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
-                                          SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-    SDL_Renderer *renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    SDL_Window *window = NULL;
+    SDL_Surface *canvas = NULL;   // -bench: the off-screen target
+    SDL_Renderer *renderer;
+    if (bench_frames) {
+        canvas = SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+        renderer = canvas ? SDL_CreateSoftwareRenderer(canvas) : NULL;
+    } else {
+        window = SDL_CreateWindow("Solar System Visualizer", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                  SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+        if (renderer == NULL) renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    }
+    if (renderer == NULL) {
+        fprintf(stderr, "Could not create a renderer: %s\n", SDL_GetError());
+        return 1;
+    }
     TTF_Font *font = TTF_OpenFont("/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf", 14);
     if (!font) {
         fprintf(stderr, "Failed to load font: %s\n", TTF_GetError());
@@ -116,14 +583,32 @@ int main(int argc, char *argv[]) {
              fprintf(stderr, "Failed to load fallback font. Text will not be rendered.\n");
         }
     }
+    struct TextTexture labels[MAX_PLANETS] = {{0}}, info = {0};
+    if (font) {
+        for (int i = 0; i < bodies.count; i++) text_texture_set(&labels[i], renderer, font, bodies.names[i]);
+    }
+    static struct TrailPyramid pyramid;
+    SDL_Point *trail = malloc((size_t)(trail_frames + 2) * sizeof(SDL_Point));
+    if (trail == NULL || trail_pyramid_init(&pyramid, bodies.count, trail_frames) != 0) {
+        fprintf(stderr, "Error: Out of memory for a %ld-frame trail.\n", trail_frames);
+        return 1;
+    }
+    SDL_Rect planet_rects[MAX_PLANETS];
 
     // --- Main Loop ---
     int running = 1;
     int is_paused = 0;
-    int current_frame = 0;
+    double position = live_mode ? (double)(frame_count / 2) : 0; // Playback position in (fractional) frames
+    double previous_position = position; // Position one tick earlier, for interpolation
+    double accumulator = 0;       // Real time not yet played, seconds
+    Uint64 ticks_per_second = SDL_GetPerformanceFrequency();
+    Uint64 last_counter = SDL_GetPerformanceCounter();
     double zoom_level = 1.0;
     int frame_increment = 1;
     int direction = 1;
+    int dragged = 0;              // The mouse moved with the button held
+    long frames_drawn = 0;
+    Uint64 bench_start = SDL_GetPerformanceCounter();
     SDL_Event e;
 
     while (running) {
@@ -136,10 +621,21 @@ int main(int argc, char *argv[]) {
                 if (zoom_level < 0.01) zoom_level = 0.01;
                 if (zoom_level > 200.0) zoom_level = 200.0;
             } else if (e.type == SDL_MOUSEBUTTONDOWN) {
-                if (is_paused && (current_frame >= frame_count - 1 || current_frame <= 0)) {
-                    current_frame = (direction == 1) ? 0 : frame_count - 1;
+                dragged = 0;
+            } else if (e.type == SDL_MOUSEMOTION && (e.motion.state & SDL_BUTTON_LMASK)) {
+                // Scrub: the drag moves the playback position directly.
+                position += e.motion.xrel * frame_increment * SCRUB_FRAMES_PER_PIXEL;
+                if (position < 0) position = 0;
+                if (position > frame_count - 1) position = (double)(frame_count - 1);
+                previous_position = position;
+                accumulator = 0;
+                dragged = 1;
+            } else if (e.type == SDL_MOUSEBUTTONUP && !dragged) {
+                if (is_paused && (position >= frame_count - 1 || position <= 0)) {
+                    position = previous_position = (direction == 1) ? 0 : frame_count - 1;
                 }
                 is_paused = !is_paused;
+                accumulator = 0;
             } else if (e.type == SDL_KEYDOWN) {
                 switch(e.key.keysym.sym) {
                     case SDLK_UP:
@@ -154,125 +650,138 @@ int main(int argc, char *argv[]) {
             }
         }
 
+        // --- Update ---
+        if (!live_mode && !data.indexed) {
+            dataset_index_rows(&data, INDEX_BYTES_PER_FRAME);
+            frame_count = bodies.num_frames = data.num_rows;
+        }
+
+        // Play back in fixed ticks of real time, so the speed does not
+        // depend on how long a frame takes to draw.
+        Uint64 counter = SDL_GetPerformanceCounter();
+        double elapsed = (double)(counter - last_counter) / (double)ticks_per_second;
+        last_counter = counter;
+        if (elapsed > MAX_ELAPSED) elapsed = MAX_ELAPSED;
+        if (bench_frames) elapsed = BENCH_FRAME_SECONDS;
+        if (!is_paused) {
+            accumulator += elapsed;
+            while (accumulator >= TICK_SECONDS) {
+                previous_position = position;
+                position += frame_increment * direction * PLAYBACK_RATE * TICK_SECONDS;
+                accumulator -= TICK_SECONDS;
+                if (position >= frame_count - 1 || position <= 0) {
+                    position = position <= 0 ? 0 : frame_count - 1;
+                    previous_position = position;
+                    accumulator = 0;
+                    // At the last row found so far, wait for indexing instead of ending.
+                    if (position <= 0 || live_mode || data.indexed) is_paused = 1;
+                }
+            }
+        }
+        double shown = previous_position + (position - previous_position) * (accumulator / TICK_SECONDS);
+        long current_frame = (long)shown;
+        long next_frame = current_frame + 1 < frame_count ? current_frame + 1 : current_frame;
+        double fraction = shown - current_frame;
+
         // --- Drawing ---
+        int64_t frame_start = STATS_START();
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
         SDL_RenderClear(renderer);
 
+        // Live positions, interpolated between the two nearest data frames.
+        double scale = PIXELS_PER_AU * zoom_level;
+        SDL_Point live[MAX_PLANETS];
+        for (int i = 0; i < bodies.count; i++) {
+            double x0, y0, x1, y1;
+            body_position(&bodies, &bodies.view, i, current_frame, &x0, &y0);
+            body_position(&bodies, &bodies.view, i, next_frame, &x1, &y1);
+            live[i] = to_screen(x0 + (x1 - x0) * fraction, y0 + (y1 - y0) * fraction, scale);
+        }
+
         // --- Draw Trails ---
-        int trail_start = current_frame - MAX_TRAIL_LENGTH;
-        if (trail_start < 1) trail_start = 1;
-
-        for (int i = trail_start; i <= current_frame; i++) {
-            double earth_x_trail = (earth_idx != -1) ? frames[i].x[earth_idx] : 0;
-            double earth_y_trail = (earth_idx != -1) ? frames[i].y[earth_idx] : 0;
-            double prev_earth_x_trail = (earth_idx != -1) ? frames[i-1].x[earth_idx] : 0;
-            double prev_earth_y_trail = (earth_idx != -1) ? frames[i-1].y[earth_idx] : 0;
-
-            for (int p = 0; p < num_planets; p++) {
-                double x1 = frames[i - 1].x[p];
-                double y1 = frames[i - 1].y[p];
-                double x2 = frames[i].x[p];
-                double y2 = frames[i].y[p];
-
-                if (p == moon_idx && earth_idx != -1) {
-                    x1 += prev_earth_x_trail; y1 += prev_earth_y_trail;
-                    x2 += earth_x_trail; y2 += earth_y_trail;
-                }
-                
-                double sx1 = SCREEN_WIDTH / 2 + (x1 * PIXELS_PER_AU * zoom_level);
-                double sy1 = SCREEN_HEIGHT / 2 + (y1 * PIXELS_PER_AU * zoom_level);
-                double sx2 = SCREEN_WIDTH / 2 + (x2 * PIXELS_PER_AU * zoom_level);
-                double sy2 = SCREEN_HEIGHT / 2 + (y2 * PIXELS_PER_AU * zoom_level);
-                
-                SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
-                SDL_RenderDrawLine(renderer, (int)sx1, (int)sy1, (int)sx2, (int)sy2);
-            }
+        // One decimated polyline per body from the pyramid, ending at the
+        // live dot; consecutive points on the same pixel are merged.
+        long trail_start = current_frame - trail_frames;
+        if (trail_start < 0) trail_start = 0;
+        trail_pyramid_update(&pyramid, &bodies, trail_start, current_frame);
+        SDL_SetRenderDrawColor(renderer, 50, 50, 50, 255);
+        for (int p = 0; p < bodies.count; p++) {
+            int count = trail_build(&pyramid, p, trail_start, current_frame, scale, trail);
+            trail_append(trail, &count, live[p]);
+            if (count > 1) SDL_RenderDrawLines(renderer, trail, count);
         }
-        
+
         // Draw Sun
         SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
         SDL_Rect sun_rect = {SCREEN_WIDTH / 2 - 5, SCREEN_HEIGHT / 2 - 5, 10, 10};
         SDL_RenderFillRect(renderer, &sun_rect);
 
         // Draw Planets (the "live" dots)
-        double earth_x_now = (earth_idx != -1) ? frames[current_frame].x[earth_idx] : 0;
-        double earth_y_now = (earth_idx != -1) ? frames[current_frame].y[earth_idx] : 0;
-
-        for (int i = 0; i < num_planets; i++) {
-            double planet_x = frames[current_frame].x[i];
-            double planet_y = frames[current_frame].y[i];
-
-            if (i == moon_idx && earth_idx != -1) {
-                planet_x += earth_x_now;
-                planet_y += earth_y_now;
-            }
-
-            double screen_x = SCREEN_WIDTH / 2 + (planet_x * PIXELS_PER_AU * zoom_level);
-            double screen_y = SCREEN_HEIGHT / 2 + (planet_y * PIXELS_PER_AU * zoom_level);
-
-            SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
-            SDL_Rect planet_rect = {(int)screen_x - 2, (int)screen_y - 2, 5, 5};
-            SDL_RenderFillRect(renderer, &planet_rect);
-
-            if(font) {
-                SDL_Color white = {255, 255, 255, 255};
-                SDL_Surface* text_surface = TTF_RenderText_Solid(font, planet_names[i], white);
-                SDL_Texture* text_texture = SDL_CreateTextureFromSurface(renderer, text_surface);
-                SDL_Rect text_rect = {(int)screen_x + 5, (int)screen_y - 5, text_surface->w, text_surface->h};
-                SDL_RenderCopy(renderer, text_texture, NULL, &text_rect);
-                SDL_FreeSurface(text_surface);
-                SDL_DestroyTexture(text_texture);
-            }
+        for (int i = 0; i < bodies.count; i++) {
+            planet_rects[i] = (SDL_Rect){live[i].x - 2, live[i].y - 2, 5, 5};
+        }
+        SDL_SetRenderDrawColor(renderer, 200, 200, 200, 255);
+        SDL_RenderFillRects(renderer, planet_rects, bodies.count);
+        for (int i = 0; i < bodies.count; i++) {
+            text_texture_draw(&labels[i], renderer, live[i].x + 5, live[i].y - 5);
         }
-        
+
         // Render Info Text
         if(font) {
-            SDL_Color white = {255, 255, 255, 255};
-            char info_text[120], status_text[20] = "";
+            char info_text[TEXT_MAX], status_text[20] = "", date[DATASET_DATE_LEN];
+            frame_date(&bodies, current_frame, date);
 
-            if (is_paused && (current_frame >= frame_count - 1 || current_frame <= 0)) {
+            if (is_paused && (position >= frame_count - 1 || position <= 0)) {
                 snprintf(status_text, sizeof(status_text), "[ENDED]");
             } else if (is_paused) {
                 snprintf(status_text, sizeof(status_text), "[PAUSED]");
             }
 
-            snprintf(info_text, sizeof(info_text), "Date: %s | Zoom: %.1fx | Speed: %dx (%s) %s | %s", 
-                     frames[current_frame].date, zoom_level, frame_increment, 
+            snprintf(info_text, sizeof(info_text), "Date: %s | Zoom: %.1fx | Speed: %dx (%s) %s | %s",
+                     date, zoom_level, frame_increment,
                      direction == 1 ? "FWD" : "REV", status_text, VERSION);
-            SDL_Surface* info_surface = TTF_RenderText_Solid(font, info_text, white);
-            SDL_Texture* info_texture = SDL_CreateTextureFromSurface(renderer, info_surface);
-            SDL_Rect info_rect = {10, 10, info_surface->w, info_surface->h};
-            SDL_RenderCopy(renderer, info_texture, NULL, &info_rect);
-            SDL_FreeSurface(info_surface);
-            SDL_DestroyTexture(info_texture);
+            text_texture_set(&info, renderer, font, info_text);
+            text_texture_draw(&info, renderer, 10, 10);
         }
 
         SDL_RenderPresent(renderer);
-
-        // --- Update ---
-        if (!is_paused) {
-            current_frame += (frame_increment * direction);
-            if (current_frame >= frame_count) {
-                current_frame = frame_count - 1;
-                is_paused = 1;
-            }
-            if (current_frame < 0) {
-                current_frame = 0;
-                is_paused = 1;
-            }
+        STATS_STOP(frame_time, frame_start);
+        if (bench_frames) {
+            if (++frames_drawn == bench_frames) running = 0;
+            continue;
         }
-        SDL_Delay(50);
+
+        // Without vsync, present returns at once; cap the frame rate instead.
+        Uint32 frame_ms = (Uint32)((SDL_GetPerformanceCounter() - counter) * 1000 / ticks_per_second);
+        if (frame_ms < MIN_FRAME_MS) SDL_Delay(MIN_FRAME_MS - frame_ms);
+    }
+
+    if (bench_frames) {
+        double ns = (double)(SDL_GetPerformanceCounter() - bench_start) * 1e9 / (double)ticks_per_second;
+        printf("BenchmarkVisualizerFrame\t%ld\t%.2f ns/op\t%.0f frames/s\n", frames_drawn, ns / (double)frames_drawn,
+               (double)frames_drawn * 1e9 / ns);
     }
 
     // --- Cleanup ---
+    for (int i = 0; i < bodies.count; i++) text_texture_free(&labels[i]);
+    text_texture_free(&info);
+    trail_pyramid_free(&pyramid, bodies.count);
+    free(trail);
     if (font) TTF_CloseFont(font);
     SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    if (window) SDL_DestroyWindow(window);
+    if (canvas) SDL_FreeSurface(canvas);
     TTF_Quit();
     SDL_Quit();
     
-    for (int i = 0; i < num_planets; i++) free(planet_names[i]);
-    free(frames);
+    free(bodies.view.rows);
+    free(bodies.tail.rows);
+    if (live_mode) {
+        free(bodies.scratch);
+        kepler_batch_free(&batch);
+    } else {
+        dataset_close(&data);
+    }
 
     return 0;
 }